@@ -23,8 +23,10 @@
 
 #include <config.h>
 
+#include <algorithm>
 #include <cstdlib>
 #include <cmath>
+#include <vector>
 
 #include "arg.h"
 #include "gtype.h"
@@ -38,62 +40,179 @@
 #include "value.h"
 #include "gerror.h"
 #include "gjs/byteArray.h"
+#include "gjs/context-private.h"
 #include "gjs/jsapi-wrapper.h"
+#include <jsfriendapi.h>
 #include <util/log.h>
 
+static bool
+enum_validation_cache_enabled(JSContext *cx)
+{
+    return _gjs_context_optimization_enabled(cx, GJS_OPTIMIZATION_ENUM_CACHE);
+}
+
+/* The bits that flags values may use, computed once per GType. If every
+ * one of those bits is also a flag value on its own, a value is valid
+ * exactly when it has no other bits set; otherwise (flags that only come
+ * in multi-bit combinations) we have to fall back to peeling values off
+ * with g_flags_get_first_value(). */
+struct GjsFlagsMask {
+    guint32 valid_bits;
+    bool exact;
+};
+
+static GQuark
+gjs_flags_mask_quark(void)
+{
+    static GQuark val = 0;
+    if (!val)
+        val = g_quark_from_static_string("gjs::flags-mask");
+
+    return val;
+}
+
+static const GjsFlagsMask *
+flags_mask_for_gtype(GType gtype)
+{
+    auto mask = static_cast<GjsFlagsMask *>(g_type_get_qdata(gtype,
+        gjs_flags_mask_quark()));
+    if (mask != NULL)
+        return mask;
+
+    auto klass = static_cast<GFlagsClass *>(g_type_class_ref(gtype));
+    guint32 single_bits = 0;
+
+    mask = g_new0(GjsFlagsMask, 1);
+    for (guint i = 0; i < klass->n_values; i++) {
+        guint32 flag = klass->values[i].value;
+        mask->valid_bits |= flag;
+        if (flag != 0 && (flag & (flag - 1)) == 0)
+            single_bits |= flag;
+    }
+    mask->exact = single_bits == mask->valid_bits;
+    g_type_class_unref(klass);
+
+    g_type_set_qdata(gtype, gjs_flags_mask_quark(), mask);
+    return mask;
+}
+
+static bool
+flags_value_is_valid_slow(GType   gtype,
+                          guint32 value)
+{
+    auto klass = static_cast<GFlagsClass *>(g_type_class_ref(gtype));
+
+    /* check all bits are defined for flags.. not necessarily desired */
+    while (value) {
+        GFlagsValue *v = g_flags_get_first_value(klass, value);
+        if (!v)
+            break;
+
+        value &= ~v->value;
+    }
+    g_type_class_unref(klass);
+
+    return value == 0;
+}
+
 bool
 _gjs_flags_value_is_valid(JSContext   *context,
                           GType        gtype,
                           gint64       value)
 {
-    GFlagsValue *v;
     guint32 tmpval;
-    void *klass;
 
     /* FIXME: Do proper value check for flags with GType's */
     if (gtype == G_TYPE_NONE)
         return true;
 
-    klass = g_type_class_ref(gtype);
-
-    /* check all bits are defined for flags.. not necessarily desired */
     tmpval = (guint32)value;
     if (tmpval != value) { /* Not a guint32 */
         gjs_throw(context,
                   "0x%" G_GINT64_MODIFIER "x is not a valid value for flags %s",
-                  value, g_type_name(G_TYPE_FROM_CLASS(klass)));
+                  value, g_type_name(gtype));
         return false;
     }
 
-    while (tmpval) {
-        v = g_flags_get_first_value((GFlagsClass *) klass, tmpval);
-        if (!v) {
-            gjs_throw(context,
-                      "0x%x is not a valid value for flags %s",
-                      (guint32)value, g_type_name(G_TYPE_FROM_CLASS(klass)));
-            return false;
-        }
+    bool valid;
+    if (enum_validation_cache_enabled(context)) {
+        const GjsFlagsMask *mask = flags_mask_for_gtype(gtype);
+        if ((tmpval & ~mask->valid_bits) != 0)
+            valid = false;
+        else if (mask->exact)
+            valid = true;
+        else
+            valid = flags_value_is_valid_slow(gtype, tmpval);
+    } else {
+        valid = flags_value_is_valid_slow(gtype, tmpval);
+    }
 
-        tmpval &= ~v->value;
+    if (!valid) {
+        gjs_throw(context,
+                  "0x%x is not a valid value for flags %s",
+                  tmpval, g_type_name(gtype));
+        return false;
     }
-    g_type_class_unref(klass);
 
     return true;
 }
 
+/* The values of an enumeration, sorted, computed once per enum. When they
+ * form a contiguous range, which is the usual case, only the bounds need
+ * checking. */
+struct GjsEnumValues {
+    std::vector<int64_t> values;
+    bool contiguous;
+};
+
+/* Keyed by the enum's name as stored in its typelib. GIBaseInfos are
+ * allocated anew on every lookup, but the strings they point to are
+ * unique per typelib entry and live as long as the repository does, and
+ * two enumerations in one namespace can't share a name. */
+static GHashTable *enum_values_cache;
+
+static const GjsEnumValues *
+enum_values_for_info(GIEnumInfo *enum_info)
+{
+    const char *key = g_base_info_get_name(enum_info);
+
+    if (G_UNLIKELY(enum_values_cache == NULL))
+        enum_values_cache = g_hash_table_new(NULL, NULL);
+
+    auto cached = static_cast<GjsEnumValues *>(
+        g_hash_table_lookup(enum_values_cache, key));
+    if (cached != NULL)
+        return cached;
+
+    cached = new GjsEnumValues();
+
+    int n_values = g_enum_info_get_n_values(enum_info);
+    cached->values.reserve(n_values);
+    for (int i = 0; i < n_values; ++i) {
+        GIValueInfo *value_info = g_enum_info_get_value(enum_info, i);
+        cached->values.push_back(g_value_info_get_value(value_info));
+        g_base_info_unref((GIBaseInfo *)value_info);
+    }
+
+    std::sort(cached->values.begin(), cached->values.end());
+    cached->values.erase(std::unique(cached->values.begin(),
+                                     cached->values.end()),
+                         cached->values.end());
+    cached->contiguous = cached->values.empty() ||
+        uint64_t(cached->values.back() - cached->values.front()) ==
+            cached->values.size() - 1;
+
+    g_hash_table_insert(enum_values_cache, (void *) key, cached);
+    return cached;
+}
+
 static bool
-_gjs_enum_value_is_valid(JSContext  *context,
-                         GIEnumInfo *enum_info,
+enum_value_is_valid_slow(GIEnumInfo *enum_info,
                          gint64      value)
 {
-    bool found;
-    int n_values;
-    int i;
+    int n_values = g_enum_info_get_n_values(enum_info);
 
-    n_values = g_enum_info_get_n_values(enum_info);
-    found = false;
-
-    for (i = 0; i < n_values; ++i) {
+    for (int i = 0; i < n_values; ++i) {
         GIValueInfo *value_info;
         gint64 enum_value;
 
@@ -101,10 +220,32 @@ _gjs_enum_value_is_valid(JSContext  *context,
         enum_value = g_value_info_get_value(value_info);
         g_base_info_unref((GIBaseInfo *)value_info);
 
-        if (enum_value == value) {
+        if (enum_value == value)
+            return true;
+    }
+
+    return false;
+}
+
+static bool
+_gjs_enum_value_is_valid(JSContext  *context,
+                         GIEnumInfo *enum_info,
+                         gint64      value)
+{
+    bool found;
+
+    if (enum_validation_cache_enabled(context)) {
+        const GjsEnumValues *cached = enum_values_for_info(enum_info);
+        const std::vector<int64_t>& values = cached->values;
+
+        if (values.empty() || value < values.front() || value > values.back())
+            found = false;
+        else if (cached->contiguous)
             found = true;
-            break;
-        }
+        else
+            found = std::binary_search(values.begin(), values.end(), value);
+    } else {
+        found = enum_value_is_valid_slow(enum_info, value);
     }
 
     if (!found) {
@@ -1253,6 +1394,85 @@ throw_invalid_argument(JSContext      *context,
     g_free(display_name);
 }
 
+/* Fast path for passing a JS typed array whose element type matches a
+ * C array of fixed-width numbers: the contents are copied in one go
+ * instead of going through JS_GetElement() and a JS::Value per element.
+ * Returns false without throwing if @array_obj is not a typed array or
+ * its element type does not match, in which case the caller falls back
+ * to the generic conversion. */
+static bool
+gjs_typed_array_to_carray(JSContext       *context,
+                          JS::HandleObject array_obj,
+                          GITypeTag        element_type,
+                          void           **arr_p,
+                          gsize           *length_p)
+{
+    size_t element_size;
+    bool matches;
+
+    if (!JS_IsTypedArrayObject(array_obj))
+        return false;
+
+    js::Scalar::Type array_type = JS_GetArrayBufferViewType(array_obj);
+
+    switch (element_type) {
+    case GI_TYPE_TAG_INT8:
+        matches = array_type == js::Scalar::Int8;
+        element_size = sizeof(gint8);
+        break;
+    case GI_TYPE_TAG_UINT8:
+        matches = array_type == js::Scalar::Uint8 ||
+            array_type == js::Scalar::Uint8Clamped;
+        element_size = sizeof(guint8);
+        break;
+    case GI_TYPE_TAG_INT16:
+        matches = array_type == js::Scalar::Int16;
+        element_size = sizeof(gint16);
+        break;
+    case GI_TYPE_TAG_UINT16:
+        matches = array_type == js::Scalar::Uint16;
+        element_size = sizeof(guint16);
+        break;
+    case GI_TYPE_TAG_INT32:
+        matches = array_type == js::Scalar::Int32;
+        element_size = sizeof(gint32);
+        break;
+    case GI_TYPE_TAG_UINT32:
+        matches = array_type == js::Scalar::Uint32;
+        element_size = sizeof(guint32);
+        break;
+    case GI_TYPE_TAG_FLOAT:
+        matches = array_type == js::Scalar::Float32;
+        element_size = sizeof(float);
+        break;
+    case GI_TYPE_TAG_DOUBLE:
+        matches = array_type == js::Scalar::Float64;
+        element_size = sizeof(double);
+        break;
+    default:
+        return false;
+    }
+
+    if (!matches)
+        return false;
+
+    uint32_t length = JS_GetTypedArrayLength(array_obj);
+    /* add one so we're always zero terminated */
+    void *result = g_malloc0((length + 1) * element_size);
+
+    {
+        JS::AutoCheckCannotGC nogc;
+        bool is_shared;
+        void *data = JS_GetArrayBufferViewData(array_obj, &is_shared, nogc);
+        if (length > 0)
+            memcpy(result, data, length * element_size);
+    }
+
+    *arr_p = result;
+    *length_p = length;
+    return true;
+}
+
 static bool
 gjs_array_to_explicit_array_internal(JSContext       *context,
                                      JS::HandleValue  value,
@@ -1287,9 +1507,14 @@ gjs_array_to_explicit_array_internal(JSContext       *context,
             goto out;
     } else {
         JS::RootedObject array_obj(context, &value.toObject());
-        if (gjs_object_has_property(context, array_obj, GJS_STRING_LENGTH,
-                                    &found_length) &&
-            found_length) {
+        if (!g_type_info_is_pointer(param_info) &&
+            gjs_typed_array_to_carray(context, array_obj,
+                                      g_type_info_get_tag(param_info),
+                                      contents, length_p)) {
+            /* Typed array of the right element type, copied in bulk */
+        } else if (gjs_object_has_property(context, array_obj,
+                                           GJS_STRING_LENGTH, &found_length) &&
+                   found_length) {
             guint32 length;
 
             if (!gjs_object_require_converted_property(context, array_obj, NULL,
@@ -2135,21 +2360,20 @@ gjs_value_to_arg(JSContext      *context,
 bool
 gjs_value_to_explicit_array (JSContext      *context,
                              JS::HandleValue value,
-                             GIArgInfo      *arg_info,
+                             GITypeInfo     *type_info,
+                             const char     *arg_name,
+                             GITransfer      transfer,
+                             bool            may_be_null,
                              GIArgument     *arg,
                              size_t         *length_p)
 {
-    GITypeInfo type_info;
-
-    g_arg_info_load_type(arg_info, &type_info);
-
     return gjs_array_to_explicit_array_internal(context,
                                                 value,
-                                                &type_info,
-                                                g_base_info_get_name((GIBaseInfo*) arg_info),
+                                                type_info,
+                                                arg_name,
                                                 GJS_ARGUMENT_ARGUMENT,
-                                                g_arg_info_get_ownership_transfer(arg_info),
-                                                g_arg_info_may_be_null(arg_info),
+                                                transfer,
+                                                may_be_null,
                                                 &arg->v_pointer,
                                                 length_p);
 }
@@ -2244,6 +2468,12 @@ gjs_array_from_carray_internal (JSContext             *context,
             return false; \
     }
 
+/* Numbers that always fit in a JS::Value don't need the generic
+ * conversion, store them directly */
+#define ITERATE_NUMBER(type) \
+    for (i = 0; i < length; i++) \
+        elems[i].setNumber(double(*(((g##type*)array) + i)));
+
     switch (element_type) {
         /* Special cases handled above */
         case GI_TYPE_TAG_UINT8:
@@ -2253,19 +2483,19 @@ gjs_array_from_carray_internal (JSContext             *context,
             ITERATE(boolean);
             break;
         case GI_TYPE_TAG_INT8:
-          ITERATE(int8);
+          ITERATE_NUMBER(int8);
           break;
         case GI_TYPE_TAG_UINT16:
-          ITERATE(uint16);
+          ITERATE_NUMBER(uint16);
           break;
         case GI_TYPE_TAG_INT16:
-          ITERATE(int16);
+          ITERATE_NUMBER(int16);
           break;
         case GI_TYPE_TAG_UINT32:
-          ITERATE(uint32);
+          ITERATE_NUMBER(uint32);
           break;
         case GI_TYPE_TAG_INT32:
-          ITERATE(int32);
+          ITERATE_NUMBER(int32);
           break;
         case GI_TYPE_TAG_UINT64:
           ITERATE(uint64);
@@ -2274,10 +2504,10 @@ gjs_array_from_carray_internal (JSContext             *context,
           ITERATE(int64);
           break;
         case GI_TYPE_TAG_FLOAT:
-          ITERATE(float);
+          ITERATE_NUMBER(float);
           break;
         case GI_TYPE_TAG_DOUBLE:
-          ITERATE(double);
+          ITERATE_NUMBER(double);
           break;
         case GI_TYPE_TAG_INTERFACE: {
           GIBaseInfo *interface_info;
@@ -2325,6 +2555,7 @@ gjs_array_from_carray_internal (JSContext             *context,
           return false;
     }
 
+#undef ITERATE_NUMBER
 #undef ITERATE
 
     JS::RootedObject obj(context, JS_NewArrayObject(context, elems));
@@ -50,7 +50,10 @@ bool gjs_value_to_arg(JSContext      *context,
 
 bool gjs_value_to_explicit_array(JSContext       *context,
                                  JS::HandleValue  value,
-                                 GIArgInfo       *arg_info,
+                                 GITypeInfo      *type_info,
+                                 const char      *arg_name,
+                                 GITransfer       transfer,
+                                 bool             may_be_null,
                                  GIArgument      *arg,
                                  size_t          *length_p);
 
@@ -28,7 +28,9 @@
 #include "boxed.h"
 #include "arg.h"
 #include "object.h"
+#include "gjs/context-private.h"
 #include "gjs/jsapi-class.h"
+#include "gjs/gc-scheduler.h"
 #include "gjs/jsapi-wrapper.h"
 #include "gjs/mem.h"
 #include "repo.h"
@@ -58,22 +60,221 @@ struct Boxed {
     void *gboxed; /* NULL if we are the prototype and not an instance */
     GHashTable *field_map;
 
+    /* class of nursery-allocated wrappers, NULL if not allocated there */
+    const JSClass *simple_class;
+
     guint can_allocate_directly : 1;
     guint allocated_directly : 1;
+    guint gboxed_inline : 1; /* gboxed is allocated right after the Boxed */
     guint not_owning_gboxed : 1; /* if set, the JS wrapper does not own
                                     the reference to the C gboxed */
 };
 
 static bool struct_is_simple(GIStructInfo *info);
 
-static bool boxed_set_field_from_value(JSContext      *context,
-                                       Boxed          *priv,
-                                       GIFieldInfo    *field_info,
-                                       JS::HandleValue value);
+static bool boxed_set_field_from_value(JSContext       *context,
+                                       JS::HandleObject obj,
+                                       GIFieldInfo     *field_info,
+                                       JS::HandleValue  value);
 
 extern struct JSClass gjs_boxed_class;
 
-GJS_DEFINE_PRIV_FROM_JS(Boxed, gjs_boxed_class)
+/* Small simple structs are wrapped in objects of one of these classes
+ * instead. They have no private data and no finalizer, so that SpiderMonkey
+ * can allocate the wrappers in the nursery, and the struct's bytes are stored
+ * in the wrapper's reserved slots, one Int32 value per 32-bit word. A value
+ * then costs a single GC cell and no malloc, and short-lived values such as
+ * colors and rectangles die in minor GCs without ever reaching the tenured
+ * heap.
+ *
+ * The slots are not addressable, so fields are read and written through a
+ * copy on the stack. Anything that needs the struct's address, such as passing
+ * it to C, "pins" it first: the bytes are copied into an ordinary Boxed, whose
+ * object the wrapper keeps in its pinned slot, and which from then on is the
+ * only copy of the struct. */
+enum {
+    SIMPLE_SLOT_PROTO,   /* prototype, holding the type's Boxed */
+    SIMPLE_SLOT_PINNED,  /* gjs_boxed_class object once pinned, else undefined */
+    SIMPLE_SLOT_FIRST_WORD
+};
+
+#define SIMPLE_BOXED_CLASS(n_words)                                     \
+    {                                                                   \
+        "GObject_Boxed",                                                \
+        JSCLASS_HAS_RESERVED_SLOTS(SIMPLE_SLOT_FIRST_WORD + (n_words))  \
+    }
+
+/* One class per wrapper size, up to SpiderMonkey's 16 fixed slots; more
+ * slots than that would be malloc'ed */
+static const struct JSClass gjs_simple_boxed_classes[] = {
+    SIMPLE_BOXED_CLASS(2),
+    SIMPLE_BOXED_CLASS(4),
+    SIMPLE_BOXED_CLASS(8),
+    SIMPLE_BOXED_CLASS(14),
+};
+
+#define SIMPLE_BOXED_MAX_SIZE (14 * sizeof(uint32_t))
+
+/* Stack space for a copy of a struct of a simple wrapper */
+typedef uint64_t SimpleBoxedCopy[SIMPLE_BOXED_MAX_SIZE / sizeof(uint64_t)];
+
+static size_t
+simple_class_max_size(const JSClass *clasp)
+{
+    return (JSCLASS_RESERVED_SLOTS(clasp) - SIMPLE_SLOT_FIRST_WORD) *
+        sizeof(uint32_t);
+}
+
+static inline bool
+is_simple_boxed(JSObject *obj)
+{
+    const JSClass *clasp = JS_GetClass(obj);
+    return clasp >= gjs_simple_boxed_classes &&
+        clasp < gjs_simple_boxed_classes + G_N_ELEMENTS(gjs_simple_boxed_classes);
+}
+
+static Boxed *simple_boxed_pin(JSContext       *context,
+                               JS::HandleObject obj);
+
+GJS_ALWAYS_INLINE
+static inline bool
+do_base_typecheck(JSContext       *context,
+                  JS::HandleObject object,
+                  bool             throw_error)
+{
+    if (is_simple_boxed(object))
+        return true;
+    return gjs_typecheck_instance(context, object, &gjs_boxed_class,
+                                  throw_error);
+}
+
+/* Like GJS_DEFINE_PRIV_FROM_JS, but simple boxed are pinned so that the
+ * returned Boxed can be used like any other */
+static Boxed *
+priv_from_js(JSContext       *context,
+             JS::HandleObject object)
+{
+    Boxed *priv;
+
+    if (is_simple_boxed(object))
+        return simple_boxed_pin(context, object);
+
+    JS_BeginRequest(context);
+    priv = (Boxed *) JS_GetInstancePrivate(context, object, &gjs_boxed_class,
+                                           NULL);
+    JS_EndRequest(context);
+    return priv;
+}
+
+static bool
+priv_from_js_with_typecheck(JSContext       *context,
+                            JS::HandleObject object,
+                            Boxed          **out)
+{
+    if (!do_base_typecheck(context, object, false))
+        return false;
+    *out = priv_from_js(context, object);
+    return *out != NULL;
+}
+
+/* The Boxed with the type information of an object of either class, without
+ * pinning. For gjs_boxed_class objects it is their own. */
+static Boxed *
+boxed_type_priv(JSObject *obj)
+{
+    if (is_simple_boxed(obj))
+        obj = &JS_GetReservedSlot(obj, SIMPLE_SLOT_PROTO).toObject();
+    return (Boxed *) JS_GetPrivate(obj);
+}
+
+/* The struct's address, or NULL if it is stored in a simple wrapper's slots;
+ * see boxed_read_struct() */
+static void *
+boxed_struct_address(JSObject *obj)
+{
+    if (is_simple_boxed(obj)) {
+        JS::Value pinned = JS_GetReservedSlot(obj, SIMPLE_SLOT_PINNED);
+        if (pinned.isUndefined())
+            return NULL;
+        obj = &pinned.toObject();
+    }
+
+    return ((Boxed *) JS_GetPrivate(obj))->gboxed;
+}
+
+static void
+simple_boxed_read(JSObject *obj,
+                  void     *dest,
+                  size_t    size)
+{
+    auto bytes = static_cast<uint8_t *>(dest);
+    for (unsigned i = 0; i * sizeof(int32_t) < size; i++) {
+        int32_t word =
+            JS_GetReservedSlot(obj, SIMPLE_SLOT_FIRST_WORD + i).toInt32();
+        memcpy(bytes + i * sizeof(word), &word,
+               MIN(sizeof(word), size - i * sizeof(word)));
+    }
+}
+
+static void
+simple_boxed_write(JSObject   *obj,
+                   const void *src,
+                   size_t      size)
+{
+    auto bytes = static_cast<const uint8_t *>(src);
+    for (unsigned i = 0; i * sizeof(int32_t) < size; i++) {
+        int32_t word = 0;
+        memcpy(&word, bytes + i * sizeof(word),
+               MIN(sizeof(word), size - i * sizeof(word)));
+        JS_SetReservedSlot(obj, SIMPLE_SLOT_FIRST_WORD + i,
+                           JS::Int32Value(word));
+    }
+}
+
+/* Copies the struct out of a wrapper of either class */
+static void
+boxed_read_struct(JSObject *obj,
+                  void     *dest,
+                  size_t    size)
+{
+    void *data = boxed_struct_address(obj);
+    if (data)
+        memcpy(dest, data, size);
+    else
+        simple_boxed_read(obj, dest, size);
+}
+
+/* Copies @src into the struct of a wrapper of either class */
+static void
+boxed_write_struct(JSObject   *obj,
+                   const void *src,
+                   size_t      size)
+{
+    void *data = boxed_struct_address(obj);
+    if (data)
+        memcpy(data, src, size);
+    else
+        simple_boxed_write(obj, src, size);
+}
+
+/* A zero-filled simple wrapper */
+static JSObject *
+simple_boxed_new(JSContext       *context,
+                 JS::HandleObject proto,
+                 Boxed           *proto_priv)
+{
+    const JSClass *clasp = proto_priv->simple_class;
+    JSObject *obj = JS_NewObjectWithGivenProto(context, clasp, proto);
+    if (!obj)
+        return NULL;
+
+    JS_SetReservedSlot(obj, SIMPLE_SLOT_PROTO, JS::ObjectValue(*proto));
+    for (unsigned i = SIMPLE_SLOT_FIRST_WORD; i < JSCLASS_RESERVED_SLOTS(clasp);
+         i++)
+        JS_SetReservedSlot(obj, i, JS::Int32Value(0));
+    GJS_INC_STAT(boxed_nursery_alloc);
+    return obj;
+}
 
 static bool
 gjs_define_static_methods(JSContext       *context,
@@ -185,32 +386,67 @@ boxed_resolve(JSContext       *context,
     return true;
 }
 
-/* Check to see if JS::Value passed in is another Boxed object of the same,
- * and if so, retrieves the Boxed private structure for it.
+/* Check to see if JS::Value passed in is another Boxed instance of the same
+ * type, and if so, retrieves it; its struct can be read with boxed_read_struct().
  */
 static bool
-boxed_get_copy_source(JSContext *context,
-                      Boxed     *priv,
-                      JS::Value  value,
-                      Boxed    **source_priv_out)
+boxed_get_copy_source(JSContext              *context,
+                      Boxed                  *priv,
+                      JS::HandleValue         value,
+                      JS::MutableHandleObject source_out)
 {
-    Boxed *source_priv;
-
     if (!value.isObject())
         return false;
 
     JS::RootedObject object(context, &value.toObject());
-    if (!priv_from_js_with_typecheck(context, object, &source_priv))
+    if (!do_base_typecheck(context, object, false))
         return false;
 
+    Boxed *source_priv = boxed_type_priv(object);
+    if (!is_simple_boxed(object) && source_priv->gboxed == NULL)
+        return false;  /* a prototype */
+
     if (!g_base_info_equal((GIBaseInfo*) priv->info, (GIBaseInfo*) source_priv->info))
         return false;
 
-    *source_priv_out = source_priv;
-
+    source_out.set(object);
     return true;
 }
 
+/* A new instance Boxed for the type of @proto_priv. If @inline_size is not
+ * zero, it holds a zeroed, directly allocated struct of that size, which
+ * lives in the same allocation as the Boxed; otherwise no struct yet. */
+static Boxed *
+boxed_new_instance_priv(Boxed *proto_priv,
+                        size_t inline_size)
+{
+    GJS_INC_COUNTER(boxed);
+    Boxed *priv = (Boxed *) g_slice_alloc0(sizeof(Boxed) + inline_size);
+    new (priv) Boxed();
+
+    *priv = *proto_priv;
+    g_base_info_ref( (GIBaseInfo*) priv->info);
+    /* The field map belongs to the prototype */
+    priv->field_map = NULL;
+
+    if (inline_size > 0) {
+        g_assert(priv->can_allocate_directly);
+        priv->gboxed = priv + 1;
+        priv->allocated_directly = true;
+        priv->gboxed_inline = true;
+    }
+    return priv;
+}
+
+/* Lets the GC know about the struct memory that the wrapper keeps alive */
+static void
+boxed_note_native_alloc(JSContext *context,
+                        Boxed     *priv)
+{
+    if (priv->gboxed && !priv->not_owning_gboxed)
+        gjs_gc_note_native_alloc(context, g_struct_info_get_size(priv->info));
+}
+
 static void
 boxed_new_direct(Boxed       *priv)
 {
@@ -224,6 +460,33 @@ boxed_new_direct(Boxed       *priv)
                         g_base_info_get_name ((GIBaseInfo *)priv->info));
 }
 
+static Boxed *
+simple_boxed_pin(JSContext       *context,
+                 JS::HandleObject obj)
+{
+    JS::Value v_pinned = JS_GetReservedSlot(obj, SIMPLE_SLOT_PINNED);
+    if (v_pinned.isObject())
+        return (Boxed *) JS_GetPrivate(&v_pinned.toObject());
+
+    JS::RootedObject proto(context,
+                           &JS_GetReservedSlot(obj, SIMPLE_SLOT_PROTO).toObject());
+    JS::RootedObject pinned(context,
+        JS_NewObjectWithGivenProto(context, &gjs_boxed_class, proto));
+    if (!pinned)
+        return NULL;
+
+    Boxed *proto_priv = (Boxed *) JS_GetPrivate(proto);
+    size_t size = g_struct_info_get_size(proto_priv->info);
+    Boxed *priv = boxed_new_instance_priv(proto_priv, size);
+    JS_SetPrivate(pinned, priv);
+    simple_boxed_read(obj, priv->gboxed, size);
+    boxed_note_native_alloc(context, priv);
+
+    JS_SetReservedSlot(obj, SIMPLE_SLOT_PINNED, JS::ObjectValue(*pinned));
+    GJS_INC_STAT(boxed_nursery_pin);
+    return priv;
+}
+
 /* When initializing a boxed object from a hash of properties, we don't want
  * to do n O(n) lookups, so put put the fields into a hash table and store it on proto->priv
  * for fast lookup. 
@@ -249,13 +512,13 @@ get_field_map(GIStructInfo *struct_info)
 
 /* Initialize a newly created Boxed from an object that is a "hash" of
  * properties to set as fieds of the object. We don't require that every field
- * of the object be set.
+ * of the object be set. @priv is the prototype's, which keeps the field map.
  */
 static bool
-boxed_init_from_props(JSContext   *context,
-                      JSObject    *obj,
-                      Boxed       *priv,
-                      JS::Value    props_value)
+boxed_init_from_props(JSContext       *context,
+                      JS::HandleObject obj,
+                      Boxed           *priv,
+                      JS::HandleValue  props_value)
 {
     size_t ix, length;
 
@@ -297,7 +560,7 @@ boxed_init_from_props(JSContext   *context,
                                          prop_id, &value))
             return false;
 
-        if (!boxed_set_field_from_value(context, priv, field_info, value))
+        if (!boxed_set_field_from_value(context, obj, field_info, value))
             return false;
     }
 
@@ -326,9 +589,33 @@ boxed_invoke_constructor(JSContext             *context,
                                    args, args.rval());
 }
 
+static bool
+boxed_invoke_zero_args_constructor(JSContext *context,
+                                   Boxed     *priv,
+                                   void     **gboxed_out)
+{
+    GIFunctionInfo *func_info = g_struct_info_get_method (priv->info, priv->zero_args_constructor);
+
+    GIArgument rval_arg;
+    GError *error = NULL;
+
+    if (!g_function_info_invoke(func_info, NULL, 0, NULL, 0, &rval_arg, &error)) {
+        gjs_throw(context, "Failed to invoke boxed constructor: %s", error->message);
+        g_clear_error(&error);
+        g_base_info_unref((GIBaseInfo*) func_info);
+        return false;
+    }
+
+    g_base_info_unref((GIBaseInfo*) func_info);
+
+    *gboxed_out = rval_arg.v_pointer;
+    return true;
+}
+
 static bool
 boxed_new(JSContext             *context,
           JS::HandleObject       obj, /* "this" for constructor */
+          Boxed                 *proto_priv,
           Boxed                 *priv,
           JS::CallArgs&          args)
 {
@@ -350,21 +637,8 @@ boxed_new(JSContext             *context,
      * exists, otherwise we choose the internal slice allocator if possible;
      * finally, we fallback on the default constructor */
     if (priv->zero_args_constructor >= 0) {
-        GIFunctionInfo *func_info = g_struct_info_get_method (priv->info, priv->zero_args_constructor);
-
-        GIArgument rval_arg;
-        GError *error = NULL;
-
-        if (!g_function_info_invoke(func_info, NULL, 0, NULL, 0, &rval_arg, &error)) {
-            gjs_throw(context, "Failed to invoke boxed constructor: %s", error->message);
-            g_clear_error(&error);
-            g_base_info_unref((GIBaseInfo*) func_info);
+        if (!boxed_invoke_zero_args_constructor(context, priv, &priv->gboxed))
             return false;
-        }
-
-        g_base_info_unref((GIBaseInfo*) func_info);
-
-        priv->gboxed = rval_arg.v_pointer;
 
         gjs_debug_lifecycle(GJS_DEBUG_GBOXED,
                             "JSObject created with boxed instance %p type %s",
@@ -399,7 +673,52 @@ boxed_new(JSContext             *context,
         return false;
     }
 
-    return boxed_init_from_props(context, obj, priv, args[0]);
+    return boxed_init_from_props(context, obj, proto_priv, args[0]);
+}
+
+/* The equivalent of the constructor below for types that are allocated in
+ * the nursery; see gjs_simple_boxed_classes */
+static bool
+simple_boxed_construct(JSContext       *context,
+                       JS::HandleObject proto,
+                       Boxed           *proto_priv,
+                       JS::CallArgs&    args)
+{
+    size_t size = g_struct_info_get_size(proto_priv->info);
+    JS::RootedObject obj(context, simple_boxed_new(context, proto, proto_priv));
+    if (!obj)
+        return false;
+
+    JS::RootedObject source(context);
+    if (args.length() == 1 &&
+        boxed_get_copy_source(context, proto_priv, args[0], &source)) {
+        SimpleBoxedCopy copy;
+        boxed_read_struct(source, copy, size);
+        simple_boxed_write(obj, copy, size);
+        args.rval().setObject(*obj);
+        return true;
+    }
+
+    if (proto_priv->zero_args_constructor >= 0) {
+        void *gboxed;
+        if (!boxed_invoke_zero_args_constructor(context, proto_priv, &gboxed))
+            return false;
+        simple_boxed_write(obj, gboxed, size);
+        g_boxed_free(proto_priv->gtype, gboxed);
+    }
+
+    if (args.length() > 1) {
+        gjs_throw(context, "Constructor with multiple arguments not supported for %s",
+                  g_base_info_get_name((GIBaseInfo *)proto_priv->info));
+        return false;
+    }
+
+    if (args.length() == 1 &&
+        !boxed_init_from_props(context, obj, proto_priv, args[0]))
+        return false;
+
+    args.rval().setObject(*obj);
+    return true;
 }
 
 GJS_NATIVE_CONSTRUCTOR_DECLARE(boxed)
@@ -408,22 +727,32 @@ GJS_NATIVE_CONSTRUCTOR_DECLARE(boxed)
     Boxed *priv;
     Boxed *proto_priv;
     JS::RootedObject proto(context);
-    Boxed *source_priv;
+    JS::RootedObject source(context);
     bool retval;
 
-    GJS_NATIVE_CONSTRUCTOR_PRELUDE(boxed);
-
-    priv = g_slice_new0(Boxed);
-    new (priv) Boxed();
-
-    GJS_INC_COUNTER(boxed);
+    if (!argv.isConstructing()) {
+        gjs_throw_constructor_error(context);
+        return false;
+    }
 
-    g_assert(priv_from_js(context, object) == NULL);
-    JS_SetPrivate(object, priv);
+    /* Look at the prototype before creating the object, since simple structs
+     * get a wrapper of a different class */
+    JS::RootedObject new_target(context, &argv.newTarget().toObject());
+    JS::RootedValue v_proto(context);
+    if (!gjs_object_get_property(context, new_target, GJS_STRING_PROTOTYPE,
+                                 &v_proto))
+        return false;
+    if (v_proto.isObject()) {
+        proto = &v_proto.toObject();
+        proto_priv = priv_from_js(context, proto);
+        if (proto_priv && proto_priv->gboxed == NULL &&
+            proto_priv->simple_class)
+            return simple_boxed_construct(context, proto, proto_priv, argv);
+    }
 
-    gjs_debug_lifecycle(GJS_DEBUG_GBOXED,
-                        "boxed constructor, obj %p priv %p",
-                        object.get(), priv);
+    object = JS_NewObjectForConstructor(context, &gjs_boxed_class, argv);
+    if (object == NULL)
+        return false;
 
     JS_GetPrototype(context, object, &proto);
     gjs_debug_lifecycle(GJS_DEBUG_GBOXED, "boxed instance __proto__ is %p",
@@ -439,22 +768,31 @@ GJS_NATIVE_CONSTRUCTOR_DECLARE(boxed)
         return false;
     }
 
-    *priv = *proto_priv;
-    g_base_info_ref( (GIBaseInfo*) priv->info);
+    priv = boxed_new_instance_priv(proto_priv, 0);
+
+    g_assert(priv_from_js(context, object) == NULL);
+    JS_SetPrivate(object, priv);
+
+    gjs_debug_lifecycle(GJS_DEBUG_GBOXED,
+                        "boxed constructor, obj %p priv %p",
+                        object.get(), priv);
 
     /* Short-circuit copy-construction in the case where we can use g_boxed_copy or memcpy */
     if (argc == 1 &&
-        boxed_get_copy_source(context, priv, argv[0], &source_priv)) {
-
+        boxed_get_copy_source(context, priv, argv[0], &source)) {
         if (g_type_is_a (priv->gtype, G_TYPE_BOXED)) {
-            priv->gboxed = g_boxed_copy(priv->gtype, source_priv->gboxed);
+            /* Types with simple wrappers don't take this path */
+            priv->gboxed = g_boxed_copy(priv->gtype,
+                                        boxed_struct_address(source));
+            boxed_note_native_alloc(context, priv);
 
             GJS_NATIVE_CONSTRUCTOR_FINISH(boxed);
             return true;
         } else if (priv->can_allocate_directly) {
             boxed_new_direct (priv);
-            memcpy(priv->gboxed, source_priv->gboxed,
-                   g_struct_info_get_size (priv->info));
+            boxed_read_struct(source, priv->gboxed,
+                              g_struct_info_get_size (priv->info));
+            boxed_note_native_alloc(context, priv);
 
             GJS_NATIVE_CONSTRUCTOR_FINISH(boxed);
             return true;
@@ -466,7 +804,9 @@ GJS_NATIVE_CONSTRUCTOR_DECLARE(boxed)
     */
 
     argv.rval().setUndefined();
-    retval = boxed_new(context, object, priv, argv);
+    retval = boxed_new(context, object, proto_priv, priv, argv);
+    if (retval)
+        boxed_note_native_alloc(context, priv);
 
     if (argv.rval().isUndefined())
         GJS_NATIVE_CONSTRUCTOR_FINISH(boxed);
@@ -486,8 +826,14 @@ boxed_finalize(JSFreeOp *fop,
     if (priv == NULL)
         return; /* wrong class? */
 
+    size_t inline_size = 0;
+    if (priv->gboxed_inline)
+        inline_size = g_struct_info_get_size(priv->info);
+
     if (priv->gboxed && !priv->not_owning_gboxed) {
-        if (priv->allocated_directly) {
+        if (priv->gboxed_inline) {
+            /* freed along with priv */
+        } else if (priv->allocated_directly) {
             g_slice_free1(g_struct_info_get_size (priv->info), priv->gboxed);
         } else {
             if (g_type_is_a (priv->gtype, G_TYPE_BOXED))
@@ -512,7 +858,7 @@ boxed_finalize(JSFreeOp *fop,
 
     GJS_DEC_COUNTER(boxed);
     priv->~Boxed();
-    g_slice_free(Boxed, priv);
+    g_slice_free1(sizeof(Boxed) + inline_size, priv);
 }
 
 static GIFieldInfo *
@@ -616,10 +962,17 @@ boxed_field_getter(JSContext *context,
                    unsigned   argc,
                    JS::Value *vp)
 {
-    GJS_GET_PRIV(context, argc, vp, args, obj, Boxed, priv);
+    GJS_GET_THIS(context, argc, vp, args, obj);
+    if (!do_base_typecheck(context, obj, true))
+        return false;
+
+    Boxed *priv = boxed_type_priv(obj);
     GIFieldInfo *field_info;
     GITypeInfo *type_info;
     GArgument arg;
+    SimpleBoxedCopy copy;
+    void *data;
+    bool got_field;
     bool success = false;
 
     field_info = get_field_info(context, priv,
@@ -629,7 +982,7 @@ boxed_field_getter(JSContext *context,
 
     type_info = g_field_info_get_type (field_info);
 
-    if (priv->gboxed == NULL) { /* direct access to proto field */
+    if (!is_simple_boxed(obj) && priv->gboxed == NULL) { /* direct access to proto field */
         gjs_throw(context, "Can't get field %s.%s from a prototype",
                   g_base_info_get_name ((GIBaseInfo *)priv->info),
                   g_base_info_get_name ((GIBaseInfo *)field_info));
@@ -644,9 +997,12 @@ boxed_field_getter(JSContext *context,
         if (g_base_info_get_type (interface_info) == GI_INFO_TYPE_STRUCT ||
             g_base_info_get_type (interface_info) == GI_INFO_TYPE_BOXED) {
 
-            success = get_nested_interface_object (context, obj, priv,
-                                                   field_info, type_info, interface_info,
-                                                   args.rval());
+            /* The nested object points into our struct */
+            priv = priv_from_js(context, obj);
+            success = priv &&
+                get_nested_interface_object (context, obj, priv,
+                                             field_info, type_info, interface_info,
+                                             args.rval());
 
             g_base_info_unref ((GIBaseInfo *)interface_info);
 
@@ -656,7 +1012,20 @@ boxed_field_getter(JSContext *context,
         g_base_info_unref ((GIBaseInfo *)interface_info);
     }
 
-    if (!g_field_info_get_field (field_info, priv->gboxed, &arg)) {
+    /* Fixed-size arrays are read in place, during the conversion, so they
+     * can't be read from a copy */
+    if (g_type_info_get_tag(type_info) == GI_TYPE_TAG_ARRAY &&
+        is_simple_boxed(obj) && !priv_from_js(context, obj))
+        goto out;
+
+    data = boxed_struct_address(obj);
+    if (!data) {
+        simple_boxed_read(obj, copy, g_struct_info_get_size(priv->info));
+        data = copy;
+    }
+
+    got_field = g_field_info_get_field(field_info, data, &arg);
+    if (!got_field) {
         gjs_throw(context, "Reading field %s.%s is not supported",
                   g_base_info_get_name ((GIBaseInfo *)priv->info),
                   g_base_info_get_name ((GIBaseInfo *)field_info));
@@ -677,16 +1046,17 @@ out:
 }
 
 static bool
-set_nested_interface_object (JSContext      *context,
-                             Boxed          *parent_priv,
-                             GIFieldInfo    *field_info,
-                             GITypeInfo     *type_info,
-                             GIBaseInfo     *interface_info,
-                             JS::HandleValue value)
+set_nested_interface_object (JSContext       *context,
+                             JS::HandleObject parent_obj,
+                             GIFieldInfo     *field_info,
+                             GITypeInfo      *type_info,
+                             GIBaseInfo      *interface_info,
+                             JS::HandleValue  value)
 {
     int offset;
+    Boxed *parent_priv = boxed_type_priv(parent_obj);
     Boxed *proto_priv;
-    Boxed *source_priv;
+    JS::RootedObject source(context);
 
     if (!struct_is_simple ((GIStructInfo *)interface_info)) {
         gjs_throw(context, "Writing field %s.%s is not supported",
@@ -704,35 +1074,42 @@ set_nested_interface_object (JSContext      *context,
     /* If we can't directly copy from the source object we need
      * to construct a new temporary object.
      */
-    if (!boxed_get_copy_source(context, proto_priv, value, &source_priv)) {
+    if (!boxed_get_copy_source(context, proto_priv, value, &source)) {
         JS::AutoValueArray<1> args(context);
         args[0].set(value);
-        JS::RootedObject tmp_object(context,
-            gjs_construct_object_dynamic(context, proto, args));
-        if (!tmp_object)
-            return false;
-
-        source_priv = priv_from_js(context, tmp_object);
-        if (!source_priv)
+        source = gjs_construct_object_dynamic(context, proto, args);
+        if (!source || !do_base_typecheck(context, source, true))
             return false;
     }
 
     offset = g_field_info_get_offset (field_info);
-    memcpy(((char *)parent_priv->gboxed) + offset,
-           source_priv->gboxed,
-           g_struct_info_get_size (source_priv->info));
+    size_t size = g_struct_info_get_size ((GIStructInfo *)interface_info);
+    void *parent_data = boxed_struct_address(parent_obj);
+    if (parent_data) {
+        boxed_read_struct(source, ((char *) parent_data) + offset, size);
+        return true;
+    }
 
+    SimpleBoxedCopy copy;
+    size_t parent_size = g_struct_info_get_size(parent_priv->info);
+    simple_boxed_read(parent_obj, copy, parent_size);
+    boxed_read_struct(source, ((char *) copy) + offset, size);
+    simple_boxed_write(parent_obj, copy, parent_size);
     return true;
 }
 
 static bool
-boxed_set_field_from_value(JSContext      *context,
-                           Boxed          *priv,
-                           GIFieldInfo    *field_info,
-                           JS::HandleValue value)
+boxed_set_field_from_value(JSContext       *context,
+                           JS::HandleObject obj,
+                           GIFieldInfo     *field_info,
+                           JS::HandleValue  value)
 {
+    Boxed *priv = boxed_type_priv(obj);
     GITypeInfo *type_info;
     GArgument arg;
+    SimpleBoxedCopy copy;
+    void *data;
+    bool set_field;
     bool success = false;
     bool need_release = false;
 
@@ -746,7 +1123,7 @@ boxed_set_field_from_value(JSContext      *context,
         if (g_base_info_get_type (interface_info) == GI_INFO_TYPE_STRUCT ||
             g_base_info_get_type (interface_info) == GI_INFO_TYPE_BOXED) {
 
-            success = set_nested_interface_object (context, priv,
+            success = set_nested_interface_object (context, obj,
                                                    field_info, type_info,
                                                    interface_info, value);
 
@@ -769,7 +1146,17 @@ boxed_set_field_from_value(JSContext      *context,
 
     need_release = true;
 
-    if (!g_field_info_set_field (field_info, priv->gboxed, &arg)) {
+    /* Only now, since converting the value may have pinned our struct */
+    data = boxed_struct_address(obj);
+    if (!data) {
+        simple_boxed_read(obj, copy, g_struct_info_get_size(priv->info));
+        data = copy;
+    }
+
+    set_field = g_field_info_set_field(field_info, data, &arg);
+    if (set_field && data == copy)
+        simple_boxed_write(obj, copy, g_struct_info_get_size(priv->info));
+    if (!set_field) {
         gjs_throw(context, "Writing field %s.%s is not supported",
                   g_base_info_get_name ((GIBaseInfo *)priv->info),
                   g_base_info_get_name ((GIBaseInfo *)field_info));
@@ -794,7 +1181,11 @@ boxed_field_setter(JSContext *cx,
                    unsigned   argc,
                    JS::Value *vp)
 {
-    GJS_GET_PRIV(cx, argc, vp, args, obj, Boxed, priv);
+    GJS_GET_THIS(cx, argc, vp, args, obj);
+    if (!do_base_typecheck(cx, obj, true))
+        return false;
+
+    Boxed *priv = boxed_type_priv(obj);
     GIFieldInfo *field_info;
     bool success = false;
 
@@ -803,14 +1194,14 @@ boxed_field_setter(JSContext *cx,
     if (!field_info)
         return false;
 
-    if (priv->gboxed == NULL) { /* direct access to proto field */
+    if (!is_simple_boxed(obj) && priv->gboxed == NULL) { /* direct access to proto field */
         gjs_throw(cx, "Can't set field %s.%s on prototype",
                   g_base_info_get_name ((GIBaseInfo *)priv->info),
                   g_base_info_get_name ((GIBaseInfo *)field_info));
         goto out;
     }
 
-    if (!boxed_set_field_from_value(cx, priv, field_info, args[0]))
+    if (!boxed_set_field_from_value(cx, obj, field_info, args[0]))
         goto out;
 
     args.rval().setUndefined();  /* No stored value */
@@ -1185,6 +1576,17 @@ gjs_define_boxed_class(JSContext       *context,
               in_object.get());
 
     priv->can_allocate_directly = struct_is_simple (priv->info);
+    if (priv->can_allocate_directly &&
+        _gjs_context_optimization_enabled(context,
+                                          GJS_OPTIMIZATION_NURSERY_BOXED)) {
+        size_t size = g_struct_info_get_size(priv->info);
+        for (const JSClass& clasp : gjs_simple_boxed_classes) {
+            if (size <= simple_class_max_size(&clasp)) {
+                priv->simple_class = &clasp;
+                break;
+            }
+        }
+    }
 
     define_boxed_class_fields (context, priv, prototype);
     gjs_define_static_methods (context, constructor, priv->gtype, priv->info);
@@ -1215,15 +1617,18 @@ gjs_boxed_from_c_struct(JSContext             *context,
     JS::RootedObject proto(context, gjs_lookup_generic_prototype(context, info));
     proto_priv = priv_from_js(context, proto);
 
-    obj = JS_NewObjectWithGivenProto(context, JS_GetClass(proto), proto);
-
-    GJS_INC_COUNTER(boxed);
-    priv = g_slice_new0(Boxed);
-    new (priv) Boxed();
+    if (proto_priv->simple_class &&
+        (flags & GJS_BOXED_CREATION_NO_COPY) == 0) {
+        obj = simple_boxed_new(context, proto, proto_priv);
+        if (obj)
+            simple_boxed_write(obj, gboxed,
+                               g_struct_info_get_size(proto_priv->info));
+        return obj;
+    }
 
-    *priv = *proto_priv;
-    g_base_info_ref( (GIBaseInfo*) priv->info);
+    obj = JS_NewObjectWithGivenProto(context, JS_GetClass(proto), proto);
 
+    priv = boxed_new_instance_priv(proto_priv, 0);
     JS_SetPrivate(obj, priv);
 
     if ((flags & GJS_BOXED_CREATION_NO_COPY) != 0) {
@@ -1248,6 +1653,8 @@ gjs_boxed_from_c_struct(JSContext             *context,
         }
     }
 
+    boxed_note_native_alloc(context, priv);
+
     return obj;
 }
 
@@ -1280,9 +1687,9 @@ gjs_typecheck_boxed(JSContext       *context,
     if (!do_base_typecheck(context, object, throw_error))
         return false;
 
-    priv = priv_from_js(context, object);
+    priv = boxed_type_priv(object);
 
-    if (priv->gboxed == NULL) {
+    if (!is_simple_boxed(object) && priv->gboxed == NULL) {
         if (throw_error) {
             gjs_throw_custom(context, "TypeError", NULL,
                              "Object is %s.%s.prototype, not an object instance - cannot convert to a boxed instance",
@@ -41,6 +41,7 @@
 
 #include <util/log.h>
 
+#include <gio/gio.h>
 #include <girepository.h>
 
 #include <errno.h>
@@ -51,32 +52,231 @@
  */
 #define GJS_ARG_INDEX_INVALID G_MAXUINT8
 
+/* Everything gjs_invoke_c_function() needs to know about one argument,
+ * computed once from the typelib in init_cached_function_data().
+ * The GIArgInfo and GITypeInfo are stack-style infos, so they don't
+ * hold a reference and are only valid as long as Function::info is.
+ */
 typedef struct {
+    GIArgInfo arg_info;
+    GITypeInfo type_info;
+    const char *name;
+
+    GjsParamType param_type;
+    GIDirection direction;
+    GITypeTag type_tag;
+    GITransfer transfer;
+    GIScopeType scope;
+
+    bool may_be_null : 1;
+    bool is_return_value : 1;
+    bool is_caller_allocates : 1;
+
+    /* For (out caller-allocates) structs and unions, 0 if unsupported */
+    gsize caller_allocates_size;
+
+    /* Indices of related arguments, or GJS_ARG_INDEX_INVALID */
+    guint8 array_length_pos;
+    guint8 destroy_pos;
+    guint8 closure_pos;
+
+    /* Owned reference, only for PARAM_CALLBACK */
+    GICallableInfo *callback_info;
+} GjsArgCache;
+
+/* Maximum number of C arguments, including the instance parameter, for
+ * which we install a scalar invoker */
+#define GJS_SCALAR_INVOKER_MAX_ARGS 8
+
+struct Function;
+
+/* Invoker for functions that only take (in) numbers and booleans, and
+ * return a number, a boolean or nothing. */
+typedef bool (*GjsScalarInvoker)(JSContext                  *context,
+                                 Function                   *function,
+                                 JS::HandleObject            obj,
+                                 const JS::HandleValueArray& args,
+                                 JS::MutableHandleValue      rval);
+
+typedef struct Function {
     GIFunctionInfo *info;
 
-    GjsParamType *param_types;
+    GjsArgCache *args;
+    guint8 gi_argc;
+
+    GITypeInfo return_info;
+    GITypeTag return_tag;
+    GITransfer return_transfer;
+    guint8 return_array_length_pos;
+
+    bool is_method : 1;
+    bool can_throw_gerror : 1;
+
+    /* Only valid if is_method */
+    GIBaseInfo *container;
+    GIInfoType container_type;
+    GType container_gtype;
+    GITransfer instance_transfer;
+    bool container_is_gtype_struct : 1;
 
     guint8 expected_js_argc;
     guint8 js_out_argc;
     GIFunctionInvoker invoker;
+
+    /* NULL if the function must go through gjs_invoke_c_function() */
+    GjsScalarInvoker scalar_invoker;
+
+    /* For functions with a GAsyncReadyCallback and a matching *_finish
+     * function, which return a Promise if called without the callback; see
+     * gjs_invoke_async_c_function(). NULL if not such a function. */
+    GIFunctionInfo *finish_info;
+    struct Function *finish;  /* created on first use */
+    guint8 async_callback_pos;
+    guint8 async_callback_js_pos;
+
+    /* For *_finish functions, their GAsyncResult argument */
+    guint8 async_result_pos;
 } Function;
 
+/* A call to an async function that returns a Promise, from the call until
+ * the operation's GAsyncReadyCallback has run its *_finish function */
+struct GjsAsyncCall {
+    JSContext *context;
+    GjsMaybeOwned<JSObject *> callee;  /* keeps the Function alive */
+    GjsMaybeOwned<JSObject *> promise;
+    bool started : 1;    /* the async function has been called */
+    bool finishing : 1;  /* running the *_finish function */
+    GObject *source;
+    GAsyncResult *result;
+};
+
+static void async_call_ready(GObject      *source,
+                             GAsyncResult *result,
+                             void         *data);
+static bool init_cached_function_data(JSContext      *context,
+                                      Function       *function,
+                                      GType           gtype,
+                                      GICallableInfo *info);
+static void uninit_cached_function_data(Function *function);
+
 extern struct JSClass gjs_function_class;
 
 /* Because we can't free the mmap'd data for a callback
  * while it's in use, this list keeps track of ones that
- * will be freed the next time we invoke a C function.
+ * will be freed from an idle callback, once we are out
+ * of the closure. Trampolines that go back into their
+ * pool don't need this, since nothing is freed.
  */
 static GSList *completed_trampolines = NULL;  /* GjsCallbackTrampoline */
+static unsigned completed_trampolines_idle_id = 0;
+
+/* Released trampolines are kept in a pool per context and callback type, so
+ * that the ffi_closure, cif and parameter analysis can be reused by the next
+ * callback of the same type instead of being prepared again. */
+struct _GjsCallbackTrampolinePool {
+    JSContext *context;
+    GICallableInfo *info;
+    GjsCallbackTrampoline *free_list;
+    unsigned n_free;
+
+    /* Trampolines pointing to this pool, in use or free. Once the context is
+     * shut down, the pool is closed and freed with the last of them. */
+    unsigned n_trampolines;
+    bool closed : 1;
+};
+
+/* Maximum number of released trampolines kept per callback type */
+#define GJS_TRAMPOLINE_POOL_MAX_FREE 16
+
+static GHashTable *trampoline_pools = NULL;  /* set of open pools */
 
 GJS_DEFINE_PRIV_FROM_JS(Function, gjs_function_class)
 
+static unsigned
+trampoline_pool_hash(gconstpointer key)
+{
+    auto pool = static_cast<const GjsCallbackTrampolinePool *>(key);
+    return g_str_hash(g_base_info_get_namespace(pool->info)) ^
+        g_str_hash(g_base_info_get_name(pool->info)) ^
+        g_direct_hash(pool->context);
+}
+
+static gboolean
+trampoline_pool_equal(gconstpointer a,
+                      gconstpointer b)
+{
+    auto pool_a = static_cast<const GjsCallbackTrampolinePool *>(a);
+    auto pool_b = static_cast<const GjsCallbackTrampolinePool *>(b);
+    return pool_a->context == pool_b->context &&
+        g_base_info_equal(pool_a->info, pool_b->info);
+}
+
+static GjsCallbackTrampolinePool *
+trampoline_pool_for_info(JSContext      *context,
+                         GICallableInfo *info)
+{
+    GjsCallbackTrampolinePool key, *pool;
+
+    /* Anonymous callback types can't be looked up */
+    if (g_base_info_get_name(info) == NULL)
+        return NULL;
+
+    if (G_UNLIKELY(trampoline_pools == NULL))
+        trampoline_pools = g_hash_table_new(trampoline_pool_hash,
+                                            trampoline_pool_equal);
+
+    key.context = context;
+    key.info = info;
+    pool = static_cast<GjsCallbackTrampolinePool *>(g_hash_table_lookup(trampoline_pools, &key));
+    if (pool)
+        return pool;
+
+    pool = g_slice_new0(GjsCallbackTrampolinePool);
+    pool->context = context;
+    pool->info = info;
+    g_base_info_ref(pool->info);
+    g_hash_table_add(trampoline_pools, pool);
+    return pool;
+}
+
+static void
+trampoline_pool_free(GjsCallbackTrampolinePool *pool)
+{
+    g_base_info_unref(pool->info);
+    g_slice_free(GjsCallbackTrampolinePool, pool);
+}
+
 void
 gjs_callback_trampoline_ref(GjsCallbackTrampoline *trampoline)
 {
     trampoline->ref_count++;
 }
 
+static inline bool
+trampoline_can_be_recycled(GjsCallbackTrampoline *trampoline)
+{
+    return trampoline->pool && !trampoline->pool->closed &&
+        trampoline->pool->n_free < GJS_TRAMPOLINE_POOL_MAX_FREE;
+}
+
+static void
+trampoline_free(GjsCallbackTrampoline *trampoline)
+{
+    GjsCallbackTrampolinePool *pool = trampoline->pool;
+
+    g_callable_info_free_closure(trampoline->info, trampoline->closure);
+    g_base_info_unref( (GIBaseInfo*) trampoline->info);
+    g_free (trampoline->param_types);
+    trampoline->~GjsCallbackTrampoline();
+    g_slice_free(GjsCallbackTrampoline, trampoline);
+
+    if (pool) {
+        pool->n_trampolines--;
+        if (pool->closed && pool->n_trampolines == 0)
+            trampoline_pool_free(pool);
+    }
+}
+
 void
 gjs_callback_trampoline_unref(GjsCallbackTrampoline *trampoline)
 {
@@ -84,12 +284,91 @@ gjs_callback_trampoline_unref(GjsCallbackTrampoline *trampoline)
 
     trampoline->ref_count--;
     if (trampoline->ref_count == 0) {
-        g_callable_info_free_closure(trampoline->info, trampoline->closure);
-        g_base_info_unref( (GIBaseInfo*) trampoline->info);
-        g_free (trampoline->param_types);
-        trampoline->~GjsCallbackTrampoline();
-        g_slice_free(GjsCallbackTrampoline, trampoline);
+        if (trampoline_can_be_recycled(trampoline)) {
+            GjsCallbackTrampolinePool *pool = trampoline->pool;
+
+            trampoline->js_function.reset();
+            trampoline->next_free = pool->free_list;
+            pool->free_list = trampoline;
+            pool->n_free++;
+            return;
+        }
+
+        trampoline_free(trampoline);
+    }
+}
+
+static gboolean
+trampoline_pool_close_for_context(void *key,
+                                  void *value,
+                                  void *data)
+{
+    auto pool = static_cast<GjsCallbackTrampolinePool *>(key);
+    if (pool->context != data)
+        return false;
+
+    /* Trampolines still in use are freed when released, and the last one
+     * frees the pool */
+    pool->closed = true;
+    pool->n_trampolines++;
+    while (pool->free_list) {
+        GjsCallbackTrampoline *trampoline = pool->free_list;
+        pool->free_list = trampoline->next_free;
+        trampoline_free(trampoline);
+    }
+    pool->n_free = 0;
+    if (--pool->n_trampolines == 0)
+        trampoline_pool_free(pool);
+    return true;
+}
+
+/**
+ * gjs_function_shutdown:
+ * @context: the JS context that is being destroyed
+ *
+ * Frees the pooled callback trampolines of @context.
+ */
+void
+gjs_function_shutdown(JSContext *context)
+{
+    if (trampoline_pools)
+        g_hash_table_foreach_remove(trampoline_pools,
+                                    trampoline_pool_close_for_context,
+                                    context);
+}
+
+static gboolean
+release_completed_trampolines(void *unused)
+{
+    GSList *iter;
+
+    for (iter = completed_trampolines; iter; iter = iter->next) {
+        GjsCallbackTrampoline *trampoline = (GjsCallbackTrampoline *) iter->data;
+        gjs_callback_trampoline_unref(trampoline);
     }
+    g_slist_free(completed_trampolines);
+    completed_trampolines = NULL;
+    completed_trampolines_idle_id = 0;
+
+    return G_SOURCE_REMOVE;
+}
+
+/* Drops a reference to @trampoline from inside its own closure. If that
+ * would free the closure, which is still executing, it is deferred to an
+ * idle callback instead. Putting it back in its pool is fine, since the
+ * closure memory stays alive. */
+static void
+gjs_callback_trampoline_unref_in_closure(GjsCallbackTrampoline *trampoline)
+{
+    if (trampoline->ref_count > 1 || trampoline_can_be_recycled(trampoline)) {
+        gjs_callback_trampoline_unref(trampoline);
+        return;
+    }
+
+    completed_trampolines = g_slist_prepend(completed_trampolines, trampoline);
+    if (completed_trampolines_idle_id == 0)
+        completed_trampolines_idle_id =
+            g_idle_add(release_completed_trampolines, NULL);
 }
 
 static void
@@ -202,7 +481,7 @@ gjs_callback_closure(ffi_cif *cif,
            reading the stack property, which is the worst possible
            idea during a GC session.
         */
-        gjs_callback_trampoline_unref(trampoline);
+        gjs_callback_trampoline_unref_in_closure(trampoline);
         return;
     }
 
@@ -424,10 +703,12 @@ out:
     }
 
     if (trampoline->scope == GI_SCOPE_TYPE_ASYNC) {
-        completed_trampolines = g_slist_prepend(completed_trampolines, trampoline);
+        /* Drop the reference that was added for the async call; we still
+         * hold our own, so this can't free the closure */
+        gjs_callback_trampoline_unref(trampoline);
     }
 
-    gjs_callback_trampoline_unref(trampoline);
+    gjs_callback_trampoline_unref_in_closure(trampoline);
     gjs_schedule_gc_if_needed(context);
 
     JS_EndRequest(context);
@@ -461,11 +742,37 @@ gjs_callback_trampoline_new(JSContext      *context,
 
     g_assert(JS_TypeOfValue(context, function) == JSTYPE_FUNCTION);
 
+    /* vfunc trampolines live as long as their class, so don't pool them */
+    GjsCallbackTrampolinePool *pool = NULL;
+    if (!is_vfunc)
+        pool = trampoline_pool_for_info(context, callable_info);
+
+    if (pool && pool->free_list) {
+        GJS_INC_STAT(trampoline_pool_hit);
+
+        trampoline = pool->free_list;
+        pool->free_list = trampoline->next_free;
+        pool->n_free--;
+
+        trampoline->next_free = NULL;
+        trampoline->ref_count = 1;
+        trampoline->context = context;
+        trampoline->js_function.root(context, function);
+        trampoline->scope = scope;
+        return trampoline;
+    }
+
+    if (pool)
+        GJS_INC_STAT(trampoline_pool_miss);
+
     trampoline = g_slice_new(GjsCallbackTrampoline);
     new (trampoline) GjsCallbackTrampoline();
     trampoline->ref_count = 1;
     trampoline->context = context;
     trampoline->info = callable_info;
+    trampoline->pool = pool;
+    if (pool)
+        pool->n_trampolines++;
     g_base_info_ref((GIBaseInfo*)trampoline->info);
     if (is_vfunc)
         trampoline->js_function = function;
@@ -562,16 +869,32 @@ get_length_from_arg (GArgument *arg, GITypeTag tag)
     g_assert_not_reached();
 }
 
+static bool
+gjs_value_to_cached_arg(JSContext       *context,
+                        JS::HandleValue  value,
+                        GjsArgCache     *arg_cache,
+                        GIArgument      *arg)
+{
+    return gjs_value_to_g_argument(context, value,
+                                   &arg_cache->type_info,
+                                   arg_cache->name,
+                                   (arg_cache->is_return_value ?
+                                    GJS_ARGUMENT_RETURN_VALUE : GJS_ARGUMENT_ARGUMENT),
+                                   arg_cache->transfer,
+                                   arg_cache->may_be_null,
+                                   arg);
+}
+
 static bool
 gjs_fill_method_instance(JSContext       *context,
                          JS::HandleObject obj,
                          Function        *function,
                          GIArgument      *out_arg)
 {
-    GIBaseInfo *container = g_base_info_get_container((GIBaseInfo *) function->info);
-    GIInfoType type = g_base_info_get_type(container);
-    GType gtype = g_registered_type_info_get_g_type ((GIRegisteredTypeInfo *)container);
-    GITransfer transfer = g_callable_info_get_instance_ownership_transfer (function->info);
+    GIBaseInfo *container = function->container;
+    GIInfoType type = function->container_type;
+    GType gtype = function->container_gtype;
+    GITransfer transfer = function->instance_transfer;
 
     if (type == GI_INFO_TYPE_STRUCT || type == GI_INFO_TYPE_BOXED) {
         /* GError must be special cased */
@@ -583,7 +906,7 @@ gjs_fill_method_instance(JSContext       *context,
             if (transfer == GI_TRANSFER_EVERYTHING)
                 out_arg->v_pointer = g_error_copy ((GError*) out_arg->v_pointer);
         } else if (type == GI_INFO_TYPE_STRUCT &&
-                   g_struct_info_is_gtype_struct((GIStructInfo*) container)) {
+                   function->container_is_gtype_struct) {
             /* And so do GType structures */
             GType actual_gtype;
             gpointer klass;
@@ -699,6 +1022,10 @@ format_function_name(Function *function,
  * it to create javascript objects by providing a @js_rval argument or
  * you can decide to keep the return values in #GArgument format by
  * providing a @r_value argument.
+ *
+ * Everything we need to know about the arguments comes from the
+ * GjsArgCache array built by init_cached_function_data(), so this
+ * function doesn't need to query the typelib.
  */
 static bool
 gjs_invoke_c_function(JSContext                             *context,
@@ -706,7 +1033,8 @@ gjs_invoke_c_function(JSContext                             *context,
                       JS::HandleObject                       obj, /* "this" object */
                       const JS::HandleValueArray&            args,
                       mozilla::Maybe<JS::MutableHandleValue> js_rval,
-                      GIArgument                            *r_value)
+                      GIArgument                            *r_value,
+                      GjsAsyncCall                          *async_call = nullptr)
 {
     /* These first four are arrays which hold argument pointers.
      * @in_arg_cvalues: C values which are passed on input (in or inout)
@@ -737,30 +1065,16 @@ gjs_invoke_c_function(JSContext                             *context,
     bool failed, postinvoke_release_failed;
 
     bool is_method;
-    GITypeInfo return_info;
+    GITypeInfo *return_info;
     GITypeTag return_tag;
     JS::AutoValueVector return_values(context);
     guint8 next_rval = 0; /* index into return_values */
-    GSList *iter;
 
-    /* Because we can't free a closure while we're in it, we defer
-     * freeing until the next time a C function is invoked.  What
-     * we should really do instead is queue it for a GC thread.
-     */
-    if (completed_trampolines) {
-        for (iter = completed_trampolines; iter; iter = iter->next) {
-            GjsCallbackTrampoline *trampoline = (GjsCallbackTrampoline *) iter->data;
-            gjs_callback_trampoline_unref(trampoline);
-        }
-        g_slist_free(completed_trampolines);
-        completed_trampolines = NULL;
-    }
-
-    is_method = g_callable_info_is_method(function->info);
-    can_throw_gerror = g_callable_info_can_throw_gerror(function->info);
+    is_method = function->is_method;
+    can_throw_gerror = function->can_throw_gerror;
 
     c_argc = function->invoker.cif.nargs;
-    gi_argc = g_callable_info_get_n_args( (GICallableInfo*) function->info);
+    gi_argc = function->gi_argc;
 
     /* @c_argc is the number of arguments that the underlying C
      * function takes. @gi_argc is the number of arguments the
@@ -770,22 +1084,28 @@ gjs_invoke_c_function(JSContext                             *context,
      * include PARAM_SKIPPED args).
      *
      * @js_argc is the number of arguments that were actually passed.
+     * Promise-returning calls may leave out their callback, and *_finish
+     * functions get their GAsyncResult from C rather than from JS.
      */
-    if (args.length() > function->expected_js_argc) {
+    size_t js_argc = args.length();
+    if (async_call && js_argc < function->expected_js_argc)
+        js_argc++;
+
+    if (js_argc > function->expected_js_argc) {
         GjsAutoChar name = format_function_name(function, is_method);
         JS_ReportWarningUTF8(context, "Too many arguments to %s: expected %d, "
                              "got %" G_GSIZE_FORMAT, name.get(),
-                             function->expected_js_argc, args.length());
-    } else if (args.length() < function->expected_js_argc) {
+                             function->expected_js_argc, js_argc);
+    } else if (js_argc < function->expected_js_argc) {
         GjsAutoChar name = format_function_name(function, is_method);
         gjs_throw(context, "Too few arguments to %s: "
                   "expected %d, got %" G_GSIZE_FORMAT,
-                  name.get(), function->expected_js_argc, args.length());
+                  name.get(), function->expected_js_argc, js_argc);
         return false;
     }
 
-    g_callable_info_load_return_type( (GICallableInfo*) function->info, &return_info);
-    return_tag = g_type_info_get_tag(&return_info);
+    return_info = &function->return_info;
+    return_tag = function->return_tag;
 
     in_arg_cvalues = g_newa(GArgument, c_argc);
     ffi_arg_pointers = g_newa(gpointer, c_argc);
@@ -796,7 +1116,11 @@ gjs_invoke_c_function(JSContext                             *context,
     c_arg_pos = 0; /* index into in_arg_cvalues, etc */
     js_arg_pos = 0; /* index into argv */
 
-    if (is_method) {
+    if (is_method && async_call && async_call->finishing) {
+        in_arg_cvalues[0].v_pointer = async_call->source;
+        ffi_arg_pointers[0] = &in_arg_cvalues[0];
+        ++c_arg_pos;
+    } else if (is_method) {
         if (!gjs_fill_method_instance(context, obj,
                                       function, &in_arg_cvalues[0]))
             return false;
@@ -806,79 +1130,51 @@ gjs_invoke_c_function(JSContext                             *context,
 
     processed_c_args = c_arg_pos;
     for (gi_arg_pos = 0; gi_arg_pos < gi_argc; gi_arg_pos++, c_arg_pos++) {
-        GIDirection direction;
-        GIArgInfo arg_info;
+        GjsArgCache *arg_cache = &function->args[gi_arg_pos];
+        GIDirection direction = arg_cache->direction;
         bool arg_removed = false;
 
         /* gjs_debug(GJS_DEBUG_GFUNCTION, "gi_arg_pos: %d c_arg_pos: %d js_arg_pos: %d", gi_arg_pos, c_arg_pos, js_arg_pos); */
 
-        g_callable_info_load_arg( (GICallableInfo*) function->info, gi_arg_pos, &arg_info);
-        direction = g_arg_info_get_direction(&arg_info);
-
         g_assert_cmpuint(c_arg_pos, <, c_argc);
         ffi_arg_pointers[c_arg_pos] = &in_arg_cvalues[c_arg_pos];
 
         if (direction == GI_DIRECTION_OUT) {
-            if (g_arg_info_is_caller_allocates(&arg_info)) {
-                GITypeTag type_tag;
-                GITypeInfo ainfo;
-
-                g_arg_info_load_type(&arg_info, &ainfo);
-                type_tag = g_type_info_get_tag(&ainfo);
-
-                if (type_tag == GI_TYPE_TAG_INTERFACE) {
-                    GIBaseInfo* interface_info;
-                    GIInfoType interface_type;
-                    gsize size;
-
-                    interface_info = g_type_info_get_interface(&ainfo);
-                    g_assert(interface_info != NULL);
-
-                    interface_type = g_base_info_get_type(interface_info);
-
-                    if (interface_type == GI_INFO_TYPE_STRUCT) {
-                        size = g_struct_info_get_size((GIStructInfo*)interface_info);
-                    } else if (interface_type == GI_INFO_TYPE_UNION) {
-                        size = g_union_info_get_size((GIUnionInfo*)interface_info);
-                    } else {
-                        failed = true;
-                    }
-
-                    g_base_info_unref((GIBaseInfo*)interface_info);
-
-                    if (!failed) {
-                        in_arg_cvalues[c_arg_pos].v_pointer = g_slice_alloc0(size);
-                        out_arg_cvalues[c_arg_pos].v_pointer = in_arg_cvalues[c_arg_pos].v_pointer;
-                    }
+            if (arg_cache->is_caller_allocates) {
+                if (arg_cache->caller_allocates_size > 0) {
+                    in_arg_cvalues[c_arg_pos].v_pointer =
+                        g_slice_alloc0(arg_cache->caller_allocates_size);
+                    out_arg_cvalues[c_arg_pos].v_pointer = in_arg_cvalues[c_arg_pos].v_pointer;
                 } else {
                     failed = true;
+                    gjs_throw(context, "Unsupported type %s for (out caller-allocates)",
+                              g_type_tag_to_string(arg_cache->type_tag));
                 }
-                if (failed)
-                    gjs_throw(context, "Unsupported type %s for (out caller-allocates)", g_type_tag_to_string(type_tag));
             } else {
                 out_arg_cvalues[c_arg_pos].v_pointer = NULL;
                 in_arg_cvalues[c_arg_pos].v_pointer = &out_arg_cvalues[c_arg_pos];
             }
         } else {
             GArgument *in_value;
-            GITypeInfo ainfo;
-            GjsParamType param_type;
-
-            g_arg_info_load_type(&arg_info, &ainfo);
 
             in_value = &in_arg_cvalues[c_arg_pos];
 
-            param_type = function->param_types[gi_arg_pos];
-
-            switch (param_type) {
+            switch (arg_cache->param_type) {
             case PARAM_CALLBACK: {
-                GICallableInfo *callable_info;
-                GIScopeType scope = g_arg_info_get_scope(&arg_info);
+                if (async_call && gi_arg_pos == function->async_callback_pos) {
+                    /* Resolves the promise instead of calling back into JS */
+                    gint c_pos = is_method ? arg_cache->closure_pos + 1 : arg_cache->closure_pos;
+                    in_arg_cvalues[c_pos].v_pointer = async_call;
+                    in_value->v_pointer = (gpointer) async_call_ready;
+                    break;
+                }
+
+                GIScopeType scope = arg_cache->scope;
                 GjsCallbackTrampoline *trampoline;
                 ffi_closure *closure;
                 JS::HandleValue current_arg = args[js_arg_pos];
 
-                if (current_arg.isNull() && g_arg_info_may_be_null(&arg_info)) {
+                if (current_arg.isNull() && arg_cache->may_be_null) {
                     closure = NULL;
                     trampoline = NULL;
                 } else {
@@ -886,32 +1182,28 @@ gjs_invoke_c_function(JSContext                             *context,
                         gjs_throw(context, "Error invoking %s.%s: Expected function for callback argument %s, got %s",
                                   g_base_info_get_namespace( (GIBaseInfo*) function->info),
                                   g_base_info_get_name( (GIBaseInfo*) function->info),
-                                  g_base_info_get_name( (GIBaseInfo*) &arg_info),
+                                  arg_cache->name,
                                   gjs_get_type_name(current_arg));
                         failed = true;
                         break;
                     }
 
-                    callable_info = (GICallableInfo*) g_type_info_get_interface(&ainfo);
                     trampoline = gjs_callback_trampoline_new(context,
                                                              current_arg,
-                                                             callable_info,
+                                                             arg_cache->callback_info,
                                                              scope,
                                                              false);
                     closure = trampoline->closure;
-                    g_base_info_unref(callable_info);
                 }
 
-                gint destroy_pos = g_arg_info_get_destroy(&arg_info);
-                gint closure_pos = g_arg_info_get_closure(&arg_info);
-                if (destroy_pos >= 0) {
-                    gint c_pos = is_method ? destroy_pos + 1 : destroy_pos;
-                    g_assert (function->param_types[destroy_pos] == PARAM_SKIPPED);
+                if (arg_cache->destroy_pos != GJS_ARG_INDEX_INVALID) {
+                    gint c_pos = is_method ? arg_cache->destroy_pos + 1 : arg_cache->destroy_pos;
+                    g_assert (function->args[arg_cache->destroy_pos].param_type == PARAM_SKIPPED);
                     in_arg_cvalues[c_pos].v_pointer = trampoline ? (gpointer) gjs_destroy_notify_callback : NULL;
                 }
-                if (closure_pos >= 0) {
-                    gint c_pos = is_method ? closure_pos + 1 : closure_pos;
-                    g_assert (function->param_types[closure_pos] == PARAM_SKIPPED);
+                if (arg_cache->closure_pos != GJS_ARG_INDEX_INVALID) {
+                    gint c_pos = is_method ? arg_cache->closure_pos + 1 : arg_cache->closure_pos;
+                    g_assert (function->args[arg_cache->closure_pos].param_type == PARAM_SKIPPED);
                     in_arg_cvalues[c_pos].v_pointer = trampoline;
                 }
 
@@ -927,29 +1219,31 @@ gjs_invoke_c_function(JSContext                             *context,
                 arg_removed = true;
                 break;
             case PARAM_ARRAY: {
-                GIArgInfo array_length_arg;
-
-                gint array_length_pos = g_type_info_get_array_length(&ainfo);
+                guint8 array_length_pos = arg_cache->array_length_pos;
                 gsize length;
 
                 if (!gjs_value_to_explicit_array(context, args[js_arg_pos],
-                                                 &arg_info, in_value, &length)) {
+                                                 &arg_cache->type_info,
+                                                 arg_cache->name,
+                                                 arg_cache->transfer,
+                                                 arg_cache->may_be_null,
+                                                 in_value, &length)) {
                     failed = true;
                     break;
                 }
 
-                g_callable_info_load_arg(function->info, array_length_pos, &array_length_arg);
+                GjsArgCache *length_cache = &function->args[array_length_pos];
 
                 array_length_pos += is_method ? 1 : 0;
                 JS::RootedValue v_length(context, JS::Int32Value(length));
-                if (!gjs_value_to_arg(context, v_length, &array_length_arg,
-                                      in_arg_cvalues + array_length_pos)) {
+                if (!gjs_value_to_cached_arg(context, v_length, length_cache,
+                                             in_arg_cvalues + array_length_pos)) {
                     failed = true;
                     break;
                 }
                 /* Also handle the INOUT for the length here */
                 if (direction == GI_DIRECTION_INOUT) {
-                    if (in_value->v_pointer == NULL) { 
+                    if (in_value->v_pointer == NULL) {
                         /* Special case where we were given JS null to
                          * also pass null for length, and not a
                          * pointer to an integer that derefs to 0.
@@ -965,10 +1259,16 @@ gjs_invoke_c_function(JSContext                             *context,
                 break;
             }
             case PARAM_NORMAL: {
+                if (async_call && async_call->finishing &&
+                    gi_arg_pos == function->async_result_pos) {
+                    in_value->v_pointer = async_call->result;
+                    break;
+                }
+
                 /* Ok, now just convert argument normally */
                 g_assert_cmpuint(js_arg_pos, <, args.length());
-                if (!gjs_value_to_arg(context, args[js_arg_pos], &arg_info,
-                                      in_value))
+                if (!gjs_value_to_cached_arg(context, args[js_arg_pos],
+                                             arg_cache, in_value))
                     failed = true;
 
                 break;
@@ -1027,6 +1327,8 @@ gjs_invoke_c_function(JSContext                             *context,
         return_value_p = &return_value.v_uint64;
     else
         return_value_p = &return_value.v_long;
+    if (async_call)
+        async_call->started = true;
     ffi_call(&(function->invoker.cif), FFI_FN(function->invoker.native_address), return_value_p, ffi_arg_pointers);
 
     /* Return value and out arguments are valid only if invocation doesn't
@@ -1047,31 +1349,28 @@ gjs_invoke_c_function(JSContext                             *context,
             return_values.append(JS::UndefinedValue());
 
         if (return_tag != GI_TYPE_TAG_VOID) {
-            GITransfer transfer = g_callable_info_get_caller_owns((GICallableInfo*) function->info);
+            GITransfer transfer = function->return_transfer;
             bool arg_failed = false;
-            gint array_length_pos;
+            guint8 array_length_pos;
 
             g_assert_cmpuint(next_rval, <, function->js_out_argc);
 
-            gi_type_info_extract_ffi_return_value(&return_info, &return_value, &return_gargument);
+            gi_type_info_extract_ffi_return_value(return_info, &return_value, &return_gargument);
 
-            array_length_pos = g_type_info_get_array_length(&return_info);
-            if (array_length_pos >= 0) {
-                GIArgInfo array_length_arg;
-                GITypeInfo arg_type_info;
+            array_length_pos = function->return_array_length_pos;
+            if (array_length_pos != GJS_ARG_INDEX_INVALID) {
+                GjsArgCache *length_cache = &function->args[array_length_pos];
                 JS::RootedValue length(context);
 
-                g_callable_info_load_arg(function->info, array_length_pos, &array_length_arg);
-                g_arg_info_load_type(&array_length_arg, &arg_type_info);
                 array_length_pos += is_method ? 1 : 0;
                 arg_failed = !gjs_value_from_g_argument(context, &length,
-                                                        &arg_type_info,
+                                                        &length_cache->type_info,
                                                         &out_arg_cvalues[array_length_pos],
                                                         true);
                 if (!arg_failed && js_rval) {
                     arg_failed = !gjs_value_from_explicit_array(context,
                                                                 return_values[next_rval],
-                                                                &return_info,
+                                                                return_info,
                                                                 &return_gargument,
                                                                 length.toInt32());
                 }
@@ -1079,7 +1378,7 @@ gjs_invoke_c_function(JSContext                             *context,
                     !r_value &&
                     !gjs_g_argument_release_out_array(context,
                                                       transfer,
-                                                      &return_info,
+                                                      return_info,
                                                       length.toInt32(),
                                                       &return_gargument))
                     failed = true;
@@ -1087,14 +1386,14 @@ gjs_invoke_c_function(JSContext                             *context,
                 if (js_rval)
                     arg_failed = !gjs_value_from_g_argument(context,
                                                             return_values[next_rval],
-                                                            &return_info, &return_gargument,
+                                                            return_info, &return_gargument,
                                                             true);
                 /* Free GArgument, the JS::Value should have ref'd or copied it */
                 if (!arg_failed &&
                     !r_value &&
                     !gjs_g_argument_release(context,
                                             transfer,
-                                            &return_info,
+                                            return_info,
                                             &return_gargument))
                     failed = true;
             }
@@ -1112,16 +1411,10 @@ release:
     c_arg_pos = is_method ? 1 : 0;
     postinvoke_release_failed = false;
     for (gi_arg_pos = 0; gi_arg_pos < gi_argc && c_arg_pos < processed_c_args; gi_arg_pos++, c_arg_pos++) {
-        GIDirection direction;
-        GIArgInfo arg_info;
-        GITypeInfo arg_type_info;
-        GjsParamType param_type;
-
-        g_callable_info_load_arg( (GICallableInfo*) function->info, gi_arg_pos, &arg_info);
-        direction = g_arg_info_get_direction(&arg_info);
-
-        g_arg_info_load_type(&arg_info, &arg_type_info);
-        param_type = function->param_types[gi_arg_pos];
+        GjsArgCache *arg_cache = &function->args[gi_arg_pos];
+        GIDirection direction = arg_cache->direction;
+        GITypeInfo *arg_type_info = &arg_cache->type_info;
+        GjsParamType param_type = arg_cache->param_type;
 
         if (direction == GI_DIRECTION_IN || direction == GI_DIRECTION_INOUT) {
             GArgument *arg;
@@ -1129,7 +1422,7 @@ release:
 
             if (direction == GI_DIRECTION_IN) {
                 arg = &in_arg_cvalues[c_arg_pos];
-                transfer = g_arg_info_get_ownership_transfer(&arg_info);
+                transfer = arg_cache->transfer;
             } else {
                 arg = &inout_original_arg_cvalues[c_arg_pos];
                 /* For inout, transfer refers to what we get back from the function; for
@@ -1140,7 +1433,9 @@ release:
             }
             if (param_type == PARAM_CALLBACK) {
                 ffi_closure *closure = (ffi_closure *) arg->v_pointer;
-                if (closure) {
+                if (async_call && gi_arg_pos == function->async_callback_pos) {
+                    /* async_call_ready(), not a trampoline */
+                } else if (closure) {
                     GjsCallbackTrampoline *trampoline = (GjsCallbackTrampoline *) closure->user_data;
                     /* CallbackTrampolines are refcounted because for notified/async closures
                        it is possible to destroy it while in call, and therefore we cannot check
@@ -1150,23 +1445,20 @@ release:
                 }
             } else if (param_type == PARAM_ARRAY) {
                 gsize length;
-                GIArgInfo array_length_arg;
-                GITypeInfo array_length_type;
-                gint array_length_pos = g_type_info_get_array_length(&arg_type_info);
+                guint8 array_length_pos = arg_cache->array_length_pos;
 
-                g_assert(array_length_pos >= 0);
+                g_assert(array_length_pos != GJS_ARG_INDEX_INVALID);
 
-                g_callable_info_load_arg(function->info, array_length_pos, &array_length_arg);
-                g_arg_info_load_type(&array_length_arg, &array_length_type);
+                GITypeTag length_tag = function->args[array_length_pos].type_tag;
 
                 array_length_pos += is_method ? 1 : 0;
 
                 length = get_length_from_arg(in_arg_cvalues + array_length_pos,
-                                             g_type_info_get_tag(&array_length_type));
+                                             length_tag);
 
                 if (!gjs_g_argument_release_in_array(context,
                                                      transfer,
-                                                     &arg_type_info,
+                                                     arg_type_info,
                                                      length,
                                                      arg)) {
                     postinvoke_release_failed = true;
@@ -1174,7 +1466,7 @@ release:
             } else if (param_type == PARAM_NORMAL) {
                 if (!gjs_g_argument_release_in_arg(context,
                                                    transfer,
-                                                   &arg_type_info,
+                                                   arg_type_info,
                                                    arg)) {
                     postinvoke_release_failed = true;
                 }
@@ -1191,39 +1483,35 @@ release:
         if ((direction == GI_DIRECTION_OUT || direction == GI_DIRECTION_INOUT) && param_type != PARAM_SKIPPED) {
             GArgument *arg;
             bool arg_failed = false;
-            gint array_length_pos;
+            guint8 array_length_pos;
             JS::RootedValue array_length(context, JS::Int32Value(0));
-            GITransfer transfer;
 
             g_assert(next_rval < function->js_out_argc);
 
             arg = &out_arg_cvalues[c_arg_pos];
 
-            array_length_pos = g_type_info_get_array_length(&arg_type_info);
+            array_length_pos = arg_cache->array_length_pos;
 
             if (js_rval) {
-                if (array_length_pos >= 0) {
-                    GIArgInfo array_length_arg;
-                    GITypeInfo array_length_type_info;
+                if (array_length_pos != GJS_ARG_INDEX_INVALID) {
+                    GjsArgCache *length_cache = &function->args[array_length_pos];
 
-                    g_callable_info_load_arg(function->info, array_length_pos, &array_length_arg);
-                    g_arg_info_load_type(&array_length_arg, &array_length_type_info);
                     array_length_pos += is_method ? 1 : 0;
                     arg_failed = !gjs_value_from_g_argument(context, &array_length,
-                                                            &array_length_type_info,
+                                                            &length_cache->type_info,
                                                             &out_arg_cvalues[array_length_pos],
                                                             true);
                     if (!arg_failed) {
                         arg_failed = !gjs_value_from_explicit_array(context,
                                                                     return_values[next_rval],
-                                                                    &arg_type_info,
+                                                                    arg_type_info,
                                                                     arg,
                                                                     array_length.toInt32());
                     }
                 } else {
                     arg_failed = !gjs_value_from_g_argument(context,
                                                             return_values[next_rval],
-                                                            &arg_type_info,
+                                                            arg_type_info,
                                                             arg,
                                                             true);
                 }
@@ -1233,18 +1521,17 @@ release:
                 postinvoke_release_failed = true;
 
             /* Free GArgument, the JS::Value should have ref'd or copied it */
-            transfer = g_arg_info_get_ownership_transfer(&arg_info);
             if (!arg_failed) {
-                if (array_length_pos >= 0) {
+                if (arg_cache->array_length_pos != GJS_ARG_INDEX_INVALID) {
                     gjs_g_argument_release_out_array(context,
-                                                     transfer,
-                                                     &arg_type_info,
+                                                     arg_cache->transfer,
+                                                     arg_type_info,
                                                      array_length.toInt32(),
                                                      arg);
                 } else {
                     gjs_g_argument_release(context,
-                                           transfer,
-                                           &arg_type_info,
+                                           arg_cache->transfer,
+                                           arg_type_info,
                                            arg);
                 }
             }
@@ -1258,26 +1545,10 @@ release:
              * this works OK.  We could also alloca() the structure instead
              * of slice allocating.
              */
-            if (g_arg_info_is_caller_allocates(&arg_info)) {
-                GITypeTag type_tag;
-                GIBaseInfo* interface_info;
-                GIInfoType interface_type;
-                gsize size;
-
-                type_tag = g_type_info_get_tag(&arg_type_info);
-                g_assert(type_tag == GI_TYPE_TAG_INTERFACE);
-                interface_info = g_type_info_get_interface(&arg_type_info);
-                interface_type = g_base_info_get_type(interface_info);
-                if (interface_type == GI_INFO_TYPE_STRUCT) {
-                    size = g_struct_info_get_size((GIStructInfo*)interface_info);
-                } else if (interface_type == GI_INFO_TYPE_UNION) {
-                    size = g_union_info_get_size((GIUnionInfo*)interface_info);
-                } else {
-                    g_assert_not_reached();
-                }
-
-                g_slice_free1(size, out_arg_cvalues[c_arg_pos].v_pointer);
-                g_base_info_unref((GIBaseInfo*)interface_info);
+            if (arg_cache->is_caller_allocates) {
+                g_assert(arg_cache->caller_allocates_size > 0);
+                g_slice_free1(arg_cache->caller_allocates_size,
+                              out_arg_cvalues[c_arg_pos].v_pointer);
             }
 
             ++next_rval;
@@ -1324,6 +1595,356 @@ release:
     }
 }
 
+/* JS::NewPromiseObject() needs an executor, but the promises of async calls
+ * are settled from async_call_ready() */
+static bool
+async_call_executor(JSContext *context,
+                    unsigned   argc,
+                    JS::Value *vp)
+{
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    args.rval().setUndefined();
+    return true;
+}
+
+/* Runs the *_finish function of an async call in place of a JS callback, and
+ * settles the call's promise with its return value and out arguments, or
+ * with the error that it threw */
+static void
+async_call_ready(GObject      *source,
+                 GAsyncResult *result,
+                 void         *data)
+{
+    auto call = static_cast<GjsAsyncCall *>(data);
+
+    /* The context was destroyed while the operation was running */
+    if (call->promise == nullptr) {
+        delete call;
+        return;
+    }
+
+    JSContext *context = call->context;
+    JSAutoRequest ar(context);
+    JS::RootedObject promise(context, call->promise);
+    JSAutoCompartment ac(context, promise);
+
+    Function *function = (Function *) JS_GetPrivate(call->callee);
+    JS::RootedValue retval(context);
+    call->finishing = true;
+    call->source = source;
+    call->result = result;
+
+    bool ok = gjs_invoke_c_function(context, function->finish, nullptr,
+                                    JS::HandleValueArray::empty(),
+                                    mozilla::Some<JS::MutableHandleValue>(&retval),
+                                    NULL, call);
+    if (ok)
+        ok = JS::ResolvePromise(context, promise, retval);
+
+    /* Reject the promise on every failure, so that it never stays pending,
+     * even if the finish function hit an uncatchable exception */
+    if (!ok) {
+        if (!JS_IsExceptionPending(context)) {
+            GjsAutoChar name = format_function_name(function,
+                                                    function->is_method);
+            gjs_throw(context, "%s was interrupted", name.get());
+        }
+        retval.setUndefined();
+        JS_GetPendingException(context, &retval);
+        JS_ClearPendingException(context);
+        if (!JS::RejectPromise(context, promise, retval))
+            gjs_log_exception(context);
+    }
+
+    delete call;
+}
+
+/* Loads the *_finish function of an async function, the first time that it
+ * is called without a callback */
+static bool
+async_function_ensure_finish(JSContext *context,
+                             Function  *function)
+{
+    if (function->finish)
+        return true;
+
+    Function *finish = g_slice_new0(Function);
+    if (!init_cached_function_data(context, finish, 0, function->finish_info)) {
+        uninit_cached_function_data(finish);
+        g_slice_free(Function, finish);
+        return false;
+    }
+
+    if (finish->async_result_pos == GJS_ARG_INDEX_INVALID ||
+        finish->expected_js_argc != 1) {
+        GjsAutoChar name = format_function_name(function, function->is_method);
+        gjs_throw(context, "%s can't return a Promise, because its finish "
+                  "function takes arguments other than the GAsyncResult",
+                  name.get());
+        uninit_cached_function_data(finish);
+        g_slice_free(Function, finish);
+        return false;
+    }
+
+    function->finish = finish;
+    return true;
+}
+
+/* Whether a call to an async function leaves out its callback, which has to
+ * be its last argument. Passing undefined for the callback still throws, as
+ * it did before async functions could return a Promise. */
+static bool
+async_call_wants_promise(Function                   *function,
+                         const JS::HandleValueArray& args)
+{
+    guint8 pos = function->async_callback_js_pos;
+    return args.length() == pos && pos + 1 == function->expected_js_argc;
+}
+
+/* Calls an async function with a GAsyncReadyCallback that runs its *_finish
+ * function from C, and returns a Promise for the result. This doesn't need a
+ * callback trampoline, a JS callback function, or a JS frame to call the
+ * finish function from. */
+static bool
+gjs_invoke_async_c_function(JSContext                  *context,
+                            Function                   *function,
+                            JS::HandleObject            callee,
+                            JS::HandleObject            obj,
+                            const JS::HandleValueArray& args,
+                            JS::MutableHandleValue      rval)
+{
+    if (!async_function_ensure_finish(context, function))
+        return false;
+
+    JSFunction *executor = JS_NewFunction(context, async_call_executor, 2, 0,
+                                          "executor");
+    if (!executor)
+        return false;
+    JS::RootedObject executor_obj(context, JS_GetFunctionObject(executor));
+    JS::RootedObject promise(context,
+                             JS::NewPromiseObject(context, executor_obj));
+    if (!promise)
+        return false;
+
+    auto call = new GjsAsyncCall();
+    call->context = context;
+    call->callee.root(context, callee);
+    call->promise.root(context, promise);
+
+    JS::RootedValue ignored(context);
+    if (!gjs_invoke_c_function(context, function, obj, args,
+                               mozilla::Some<JS::MutableHandleValue>(&ignored),
+                               NULL, call)) {
+        /* Otherwise async_call_ready() will still run and free it */
+        if (!call->started)
+            delete call;
+        return false;
+    }
+
+    rval.setObject(*promise);
+    return true;
+}
+
+/* Converts a JS value to a number or boolean GArgument. The common cases
+ * where no coercion or range check is needed are handled inline, anything
+ * else goes through the generic conversion so that coercion and error
+ * reporting stay the same. */
+static inline bool
+gjs_value_to_scalar_arg(JSContext       *context,
+                        JS::HandleValue  value,
+                        GjsArgCache     *arg_cache,
+                        GIArgument      *arg)
+{
+    switch (arg_cache->type_tag) {
+    case GI_TYPE_TAG_BOOLEAN:
+        if (value.isBoolean()) {
+            arg->v_boolean = value.toBoolean();
+            return true;
+        }
+        break;
+    case GI_TYPE_TAG_INT8:
+        if (value.isInt32() && value.toInt32() >= G_MININT8 &&
+            value.toInt32() <= G_MAXINT8) {
+            arg->v_int8 = value.toInt32();
+            return true;
+        }
+        break;
+    case GI_TYPE_TAG_UINT8:
+        if (value.isInt32() && value.toInt32() >= 0 &&
+            value.toInt32() <= G_MAXUINT8) {
+            arg->v_uint8 = value.toInt32();
+            return true;
+        }
+        break;
+    case GI_TYPE_TAG_INT16:
+        if (value.isInt32() && value.toInt32() >= G_MININT16 &&
+            value.toInt32() <= G_MAXINT16) {
+            arg->v_int16 = value.toInt32();
+            return true;
+        }
+        break;
+    case GI_TYPE_TAG_UINT16:
+        if (value.isInt32() && value.toInt32() >= 0 &&
+            value.toInt32() <= G_MAXUINT16) {
+            arg->v_uint16 = value.toInt32();
+            return true;
+        }
+        break;
+    case GI_TYPE_TAG_INT32:
+        if (value.isInt32()) {
+            arg->v_int32 = value.toInt32();
+            return true;
+        }
+        break;
+    case GI_TYPE_TAG_UINT32:
+        if (value.isInt32() && value.toInt32() >= 0) {
+            arg->v_uint32 = value.toInt32();
+            return true;
+        }
+        break;
+    case GI_TYPE_TAG_INT64:
+        if (value.isInt32()) {
+            arg->v_int64 = value.toInt32();
+            return true;
+        }
+        break;
+    case GI_TYPE_TAG_UINT64:
+        if (value.isInt32() && value.toInt32() >= 0) {
+            arg->v_uint64 = value.toInt32();
+            return true;
+        }
+        break;
+    case GI_TYPE_TAG_FLOAT:
+        if (value.isNumber() && value.toNumber() <= G_MAXFLOAT &&
+            value.toNumber() >= -G_MAXFLOAT) {
+            arg->v_float = value.toNumber();
+            return true;
+        }
+        break;
+    case GI_TYPE_TAG_DOUBLE:
+        if (value.isNumber()) {
+            arg->v_double = value.toNumber();
+            return true;
+        }
+        break;
+    default:
+        g_assert_not_reached();
+    }
+
+    return gjs_value_to_cached_arg(context, value, arg_cache, arg);
+}
+
+template<GITypeTag RETURN_TAG>
+static inline gpointer
+scalar_return_value_pointer(GIFFIReturnValue *return_value)
+{
+    /* See comment for GjsFFIReturnValue above */
+    if (RETURN_TAG == GI_TYPE_TAG_FLOAT)
+        return &return_value->v_float;
+    if (RETURN_TAG == GI_TYPE_TAG_DOUBLE)
+        return &return_value->v_double;
+    if (RETURN_TAG == GI_TYPE_TAG_INT64 || RETURN_TAG == GI_TYPE_TAG_UINT64)
+        return &return_value->v_uint64;
+    return &return_value->v_long;
+}
+
+template<GITypeTag RETURN_TAG>
+static inline bool
+scalar_value_from_return_value(JSContext             *context,
+                               Function              *function,
+                               GIFFIReturnValue      *return_value,
+                               JS::MutableHandleValue rval)
+{
+    switch (RETURN_TAG) {
+    case GI_TYPE_TAG_VOID:
+        rval.setUndefined();
+        return true;
+    case GI_TYPE_TAG_BOOLEAN:
+        rval.setBoolean(!!(gboolean) return_value->v_long);
+        return true;
+    case GI_TYPE_TAG_INT8:
+        rval.setInt32((gint8) return_value->v_long);
+        return true;
+    case GI_TYPE_TAG_UINT8:
+        rval.setInt32((guint8) return_value->v_long);
+        return true;
+    case GI_TYPE_TAG_INT16:
+        rval.setInt32((gint16) return_value->v_long);
+        return true;
+    case GI_TYPE_TAG_UINT16:
+        rval.setInt32((guint16) return_value->v_long);
+        return true;
+    case GI_TYPE_TAG_INT32:
+        rval.setInt32((gint32) return_value->v_long);
+        return true;
+    case GI_TYPE_TAG_UINT32:
+        rval.setNumber((guint32) return_value->v_long);
+        return true;
+    case GI_TYPE_TAG_FLOAT:
+        rval.setNumber(return_value->v_float);
+        return true;
+    case GI_TYPE_TAG_DOUBLE:
+        rval.setNumber(return_value->v_double);
+        return true;
+    case GI_TYPE_TAG_INT64:
+    case GI_TYPE_TAG_UINT64: {
+        /* Let the generic code warn about values that don't fit */
+        GIArgument return_gargument;
+        return_gargument.v_uint64 = return_value->v_uint64;
+        return gjs_value_from_g_argument(context, rval,
+                                         &function->return_info,
+                                         &return_gargument, true);
+    }
+    default:
+        g_assert_not_reached();
+    }
+}
+
+/* Fast path for functions made only of scalar (in) arguments and a scalar
+ * or void return value, as determined by function_is_scalar_only().
+ * Such arguments never need releasing and there are no out arguments, so
+ * all of that processing is skipped. Anything unusual, such as a wrong
+ * number of arguments, is handed to gjs_invoke_c_function() to report. */
+template<GITypeTag RETURN_TAG>
+static bool
+gjs_invoke_scalar_c_function(JSContext                  *context,
+                             Function                   *function,
+                             JS::HandleObject            obj,
+                             const JS::HandleValueArray& args,
+                             JS::MutableHandleValue      rval)
+{
+    GIArgument in_arg_cvalues[GJS_SCALAR_INVOKER_MAX_ARGS];
+    gpointer ffi_arg_pointers[GJS_SCALAR_INVOKER_MAX_ARGS];
+    GIFFIReturnValue return_value;
+    guint8 c_arg_pos = 0;
+
+    if (G_UNLIKELY(args.length() != function->expected_js_argc))
+        return gjs_invoke_c_function(context, function, obj, args,
+                                     mozilla::Some(rval), NULL);
+
+    if (function->is_method) {
+        if (!gjs_fill_method_instance(context, obj, function,
+                                      &in_arg_cvalues[0]))
+            return false;
+        ffi_arg_pointers[0] = &in_arg_cvalues[0];
+        c_arg_pos++;
+    }
+
+    for (guint8 i = 0; i < function->gi_argc; i++, c_arg_pos++) {
+        if (!gjs_value_to_scalar_arg(context, args[i], &function->args[i],
+                                     &in_arg_cvalues[c_arg_pos]))
+            return false;
+        ffi_arg_pointers[c_arg_pos] = &in_arg_cvalues[c_arg_pos];
+    }
+
+    ffi_call(&(function->invoker.cif), FFI_FN(function->invoker.native_address),
+             scalar_return_value_pointer<RETURN_TAG>(&return_value),
+             ffi_arg_pointers);
+
+    return scalar_value_from_return_value<RETURN_TAG>(context, function,
+                                                      &return_value, rval);
+}
+
 static bool
 function_call(JSContext *context,
               unsigned   js_argc,
@@ -1344,9 +1965,15 @@ function_call(JSContext *context,
     if (priv == NULL)
         return true; /* we are the prototype, or have the wrong class */
 
-    success = gjs_invoke_c_function(context, priv, object, js_argv,
-                                    mozilla::Some<JS::MutableHandleValue>(&retval),
-                                    NULL);
+    if (priv->scalar_invoker)
+        success = priv->scalar_invoker(context, priv, object, js_argv, &retval);
+    else if (priv->finish_info && async_call_wants_promise(priv, js_argv))
+        success = gjs_invoke_async_c_function(context, priv, callee, object,
+                                              js_argv, &retval);
+    else
+        success = gjs_invoke_c_function(context, priv, object, js_argv,
+                                        mozilla::Some<JS::MutableHandleValue>(&retval),
+                                        NULL);
     if (success)
         js_argv.rval().set(retval);
 
@@ -1363,8 +1990,19 @@ uninit_cached_function_data (Function *function)
 {
     if (function->info)
         g_base_info_unref( (GIBaseInfo*) function->info);
-    if (function->param_types)
-        g_free(function->param_types);
+    if (function->args) {
+        for (guint8 i = 0; i < function->gi_argc; i++) {
+            if (function->args[i].callback_info)
+                g_base_info_unref(function->args[i].callback_info);
+        }
+        g_free(function->args);
+    }
+    if (function->finish_info)
+        g_base_info_unref(function->finish_info);
+    if (function->finish) {
+        uninit_cached_function_data(function->finish);
+        g_slice_free(Function, function->finish);
+    }
 
     g_function_invoker_destroy(&function->invoker);
 }
@@ -1398,17 +2036,13 @@ get_num_arguments (JSContext *context,
     if (priv == NULL)
         return false;
 
-    n_args = g_callable_info_get_n_args(priv->info);
+    n_args = priv->gi_argc;
     n_jsargs = 0;
     for (i = 0; i < n_args; i++) {
-        GIArgInfo arg_info;
-
-        if (priv->param_types[i] == PARAM_SKIPPED)
+        if (priv->args[i].param_type == PARAM_SKIPPED)
             continue;
 
-        g_callable_info_load_arg(priv->info, i, &arg_info);
-
-        if (g_arg_info_get_direction(&arg_info) == GI_DIRECTION_OUT)
+        if (priv->args[i].direction == GI_DIRECTION_OUT)
             continue;
 
         n_jsargs++;
@@ -1439,25 +2073,21 @@ function_to_string (JSContext *context,
 
     free = true;
 
-    n_args = g_callable_info_get_n_args(priv->info);
+    n_args = priv->gi_argc;
     n_jsargs = 0;
     arg_names_str = g_string_new("");
     for (i = 0; i < n_args; i++) {
-        GIArgInfo arg_info;
-
-        if (priv->param_types[i] == PARAM_SKIPPED)
+        if (priv->args[i].param_type == PARAM_SKIPPED)
             continue;
 
-        g_callable_info_load_arg(priv->info, i, &arg_info);
-
-        if (g_arg_info_get_direction(&arg_info) == GI_DIRECTION_OUT)
+        if (priv->args[i].direction == GI_DIRECTION_OUT)
             continue;
 
         if (n_jsargs > 0)
             g_string_append(arg_names_str, ", ");
 
         n_jsargs++;
-        g_string_append(arg_names_str, g_base_info_get_name(&arg_info));
+        g_string_append(arg_names_str, priv->args[i].name);
     }
     arg_names = g_string_free(arg_names_str, false);
 
@@ -1519,6 +2149,225 @@ static JSFunctionSpec gjs_function_proto_funcs[] = {
 
 static JSFunctionSpec *gjs_function_static_funcs = nullptr;
 
+static bool
+type_tag_is_scalar(GITypeTag tag)
+{
+    switch (tag) {
+    case GI_TYPE_TAG_BOOLEAN:
+    case GI_TYPE_TAG_INT8:
+    case GI_TYPE_TAG_UINT8:
+    case GI_TYPE_TAG_INT16:
+    case GI_TYPE_TAG_UINT16:
+    case GI_TYPE_TAG_INT32:
+    case GI_TYPE_TAG_UINT32:
+    case GI_TYPE_TAG_INT64:
+    case GI_TYPE_TAG_UINT64:
+    case GI_TYPE_TAG_FLOAT:
+    case GI_TYPE_TAG_DOUBLE:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/* Whether @function can be called through gjs_invoke_scalar_c_function() */
+static bool
+function_is_scalar_only(Function *function)
+{
+    if (function->can_throw_gerror)
+        return false;
+
+    /* The instance parameter is fine, as long as we only borrow it */
+    if (function->is_method &&
+        function->instance_transfer != GI_TRANSFER_NOTHING)
+        return false;
+
+    if (function->invoker.cif.nargs > GJS_SCALAR_INVOKER_MAX_ARGS)
+        return false;
+
+    if (function->return_tag != GI_TYPE_TAG_VOID &&
+        !type_tag_is_scalar(function->return_tag))
+        return false;
+
+    for (guint8 i = 0; i < function->gi_argc; i++) {
+        GjsArgCache *arg_cache = &function->args[i];
+
+        if (arg_cache->direction != GI_DIRECTION_IN ||
+            arg_cache->param_type != PARAM_NORMAL ||
+            !type_tag_is_scalar(arg_cache->type_tag))
+            return false;
+    }
+
+    return true;
+}
+
+static GjsScalarInvoker
+scalar_invoker_for_return_tag(GITypeTag return_tag)
+{
+    switch (return_tag) {
+    case GI_TYPE_TAG_VOID:
+        return gjs_invoke_scalar_c_function<GI_TYPE_TAG_VOID>;
+    case GI_TYPE_TAG_BOOLEAN:
+        return gjs_invoke_scalar_c_function<GI_TYPE_TAG_BOOLEAN>;
+    case GI_TYPE_TAG_INT8:
+        return gjs_invoke_scalar_c_function<GI_TYPE_TAG_INT8>;
+    case GI_TYPE_TAG_UINT8:
+        return gjs_invoke_scalar_c_function<GI_TYPE_TAG_UINT8>;
+    case GI_TYPE_TAG_INT16:
+        return gjs_invoke_scalar_c_function<GI_TYPE_TAG_INT16>;
+    case GI_TYPE_TAG_UINT16:
+        return gjs_invoke_scalar_c_function<GI_TYPE_TAG_UINT16>;
+    case GI_TYPE_TAG_INT32:
+        return gjs_invoke_scalar_c_function<GI_TYPE_TAG_INT32>;
+    case GI_TYPE_TAG_UINT32:
+        return gjs_invoke_scalar_c_function<GI_TYPE_TAG_UINT32>;
+    case GI_TYPE_TAG_INT64:
+        return gjs_invoke_scalar_c_function<GI_TYPE_TAG_INT64>;
+    case GI_TYPE_TAG_UINT64:
+        return gjs_invoke_scalar_c_function<GI_TYPE_TAG_UINT64>;
+    case GI_TYPE_TAG_FLOAT:
+        return gjs_invoke_scalar_c_function<GI_TYPE_TAG_FLOAT>;
+    case GI_TYPE_TAG_DOUBLE:
+        return gjs_invoke_scalar_c_function<GI_TYPE_TAG_DOUBLE>;
+    default:
+        g_assert_not_reached();
+    }
+}
+
+/* Loads everything the invoker needs to know about argument @i into
+ * @function->args[@i], not taking into account the other arguments */
+static void
+init_cached_arg_data(Function       *function,
+                     GICallableInfo *info,
+                     guint8          i)
+{
+    GjsArgCache *arg_cache = &function->args[i];
+
+    g_callable_info_load_arg(info, i, &arg_cache->arg_info);
+    g_arg_info_load_type(&arg_cache->arg_info, &arg_cache->type_info);
+
+    arg_cache->name = g_base_info_get_name((GIBaseInfo *) &arg_cache->arg_info);
+    arg_cache->param_type = PARAM_NORMAL;
+    arg_cache->direction = g_arg_info_get_direction(&arg_cache->arg_info);
+    arg_cache->type_tag = g_type_info_get_tag(&arg_cache->type_info);
+    arg_cache->transfer = g_arg_info_get_ownership_transfer(&arg_cache->arg_info);
+    arg_cache->scope = g_arg_info_get_scope(&arg_cache->arg_info);
+    arg_cache->may_be_null = g_arg_info_may_be_null(&arg_cache->arg_info);
+    arg_cache->is_return_value = g_arg_info_is_return_value(&arg_cache->arg_info);
+    arg_cache->array_length_pos = GJS_ARG_INDEX_INVALID;
+    arg_cache->destroy_pos = GJS_ARG_INDEX_INVALID;
+    arg_cache->closure_pos = GJS_ARG_INDEX_INVALID;
+
+    if (arg_cache->type_tag == GI_TYPE_TAG_ARRAY) {
+        int array_length_pos = g_type_info_get_array_length(&arg_cache->type_info);
+        if (array_length_pos >= 0 && array_length_pos < function->gi_argc)
+            arg_cache->array_length_pos = array_length_pos;
+    }
+
+    if (arg_cache->direction == GI_DIRECTION_OUT &&
+        g_arg_info_is_caller_allocates(&arg_cache->arg_info)) {
+        arg_cache->is_caller_allocates = true;
+
+        /* Anything other than a struct or union is an error that we
+         * report when the function is invoked */
+        if (arg_cache->type_tag == GI_TYPE_TAG_INTERFACE) {
+            GIBaseInfo *interface_info = g_type_info_get_interface(&arg_cache->type_info);
+            g_assert(interface_info != NULL);
+
+            GIInfoType interface_type = g_base_info_get_type(interface_info);
+            if (interface_type == GI_INFO_TYPE_STRUCT)
+                arg_cache->caller_allocates_size = g_struct_info_get_size((GIStructInfo*)interface_info);
+            else if (interface_type == GI_INFO_TYPE_UNION)
+                arg_cache->caller_allocates_size = g_union_info_get_size((GIUnionInfo*)interface_info);
+
+            g_base_info_unref(interface_info);
+        }
+    }
+}
+
+static bool
+is_gio_info(GIBaseInfo *info,
+            const char *name)
+{
+    return strcmp(g_base_info_get_namespace(info), "Gio") == 0 &&
+        strcmp(g_base_info_get_name(info), name) == 0;
+}
+
+/* Looks up foo_finish() for foo_async() or foo(), next to the function */
+static GIFunctionInfo *
+find_finish_function(GICallableInfo *info)
+{
+    const char *name = g_base_info_get_name(info);
+    GjsAutoChar finish_name;
+    if (g_str_has_suffix(name, "_async"))
+        finish_name = g_strdup_printf("%.*s_finish",
+                                      int(strlen(name) - strlen("_async")),
+                                      name);
+    else
+        finish_name = g_strconcat(name, "_finish", NULL);
+
+    GIBaseInfo *container = g_base_info_get_container(info);
+    GIBaseInfo *finish = NULL;
+    switch (container ? g_base_info_get_type(container) : GI_INFO_TYPE_INVALID) {
+    case GI_INFO_TYPE_OBJECT:
+        finish = g_object_info_find_method((GIObjectInfo *) container,
+                                           finish_name);
+        break;
+    case GI_INFO_TYPE_INTERFACE:
+        finish = g_interface_info_find_method((GIInterfaceInfo *) container,
+                                              finish_name);
+        break;
+    case GI_INFO_TYPE_STRUCT:
+    case GI_INFO_TYPE_BOXED:
+        finish = g_struct_info_find_method((GIStructInfo *) container,
+                                           finish_name);
+        break;
+    case GI_INFO_TYPE_UNION:
+        finish = g_union_info_find_method((GIUnionInfo *) container,
+                                          finish_name);
+        break;
+    default:
+        finish = g_irepository_find_by_name(NULL,
+                                            g_base_info_get_namespace(info),
+                                            finish_name);
+        if (finish && g_base_info_get_type(finish) != GI_INFO_TYPE_FUNCTION) {
+            g_base_info_unref(finish);
+            finish = NULL;
+        }
+    }
+
+    return (GIFunctionInfo *) finish;
+}
+
+/* Sets up an async function to be able to return a Promise; see
+ * gjs_invoke_async_c_function() */
+static void
+init_async_function_data(Function       *function,
+                         GICallableInfo *info)
+{
+    function->finish_info = find_finish_function(info);
+    if (!function->finish_info)
+        return;
+
+    guint8 js_pos = 0;
+    for (guint8 i = 0; i < function->async_callback_pos; i++) {
+        GjsArgCache *arg_cache = &function->args[i];
+        if (arg_cache->param_type == PARAM_CALLBACK ||
+            ((arg_cache->param_type == PARAM_NORMAL ||
+              arg_cache->param_type == PARAM_ARRAY) &&
+             arg_cache->direction != GI_DIRECTION_OUT))
+            js_pos++;
+    }
+
+    /* Only a callback that JS passes can be left out */
+    if (js_pos >= function->expected_js_argc) {
+        g_base_info_unref(function->finish_info);
+        function->finish_info = NULL;
+        return;
+    }
+    function->async_callback_js_pos = js_pos;
+}
+
 static bool
 init_cached_function_data (JSContext      *context,
                            Function       *function,
@@ -1528,10 +2377,11 @@ init_cached_function_data (JSContext      *context,
     guint8 i, n_args;
     int array_length_pos;
     GError *error = NULL;
-    GITypeInfo return_type;
     GIInfoType info_type;
 
     info_type = g_base_info_get_type((GIBaseInfo *)info);
+    function->async_callback_pos = GJS_ARG_INDEX_INVALID;
+    function->async_result_pos = GJS_ARG_INDEX_INVALID;
 
     if (info_type == GI_INFO_TYPE_FUNCTION) {
         if (!g_function_info_prep_invoker((GIFunctionInfo *)info,
@@ -1560,57 +2410,86 @@ init_cached_function_data (JSContext      *context,
         }
     }
 
-    g_callable_info_load_return_type((GICallableInfo*)info, &return_type);
-    if (g_type_info_get_tag(&return_type) != GI_TYPE_TAG_VOID)
+    function->is_method = g_callable_info_is_method(info);
+    function->can_throw_gerror = g_callable_info_can_throw_gerror(info);
+
+    if (function->is_method) {
+        GIBaseInfo *container = g_base_info_get_container((GIBaseInfo *) info);
+
+        function->container = container;
+        function->container_type = g_base_info_get_type(container);
+        function->container_gtype =
+            g_registered_type_info_get_g_type((GIRegisteredTypeInfo *) container);
+        function->instance_transfer =
+            g_callable_info_get_instance_ownership_transfer(info);
+        function->container_is_gtype_struct =
+            function->container_type == GI_INFO_TYPE_STRUCT &&
+            g_struct_info_is_gtype_struct((GIStructInfo *) container);
+    }
+
+    g_callable_info_load_return_type(info, &function->return_info);
+    function->return_tag = g_type_info_get_tag(&function->return_info);
+    function->return_transfer = g_callable_info_get_caller_owns(info);
+    if (function->return_tag != GI_TYPE_TAG_VOID)
         function->js_out_argc += 1;
 
-    n_args = g_callable_info_get_n_args((GICallableInfo*) info);
-    function->param_types = g_new0(GjsParamType, n_args);
+    n_args = g_callable_info_get_n_args(info);
+    function->gi_argc = n_args;
+    function->args = g_new0(GjsArgCache, n_args);
 
-    array_length_pos = g_type_info_get_array_length(&return_type);
-    if (array_length_pos >= 0 && array_length_pos < n_args)
-        function->param_types[array_length_pos] = PARAM_SKIPPED;
+    for (i = 0; i < n_args; i++)
+        init_cached_arg_data(function, info, i);
+
+    function->return_array_length_pos = GJS_ARG_INDEX_INVALID;
+    array_length_pos = g_type_info_get_array_length(&function->return_info);
+    if (array_length_pos >= 0 && array_length_pos < n_args) {
+        function->args[array_length_pos].param_type = PARAM_SKIPPED;
+        function->return_array_length_pos = array_length_pos;
+    }
 
     for (i = 0; i < n_args; i++) {
+        GjsArgCache *arg_cache = &function->args[i];
         GIDirection direction;
-        GIArgInfo arg_info;
-        GITypeInfo type_info;
-        int destroy = -1;
-        int closure = -1;
         GITypeTag type_tag;
 
-        if (function->param_types[i] == PARAM_SKIPPED)
+        if (arg_cache->param_type == PARAM_SKIPPED)
             continue;
 
-        g_callable_info_load_arg((GICallableInfo*) info, i, &arg_info);
-        g_arg_info_load_type(&arg_info, &type_info);
-
-        direction = g_arg_info_get_direction(&arg_info);
-        type_tag = g_type_info_get_tag(&type_info);
+        direction = arg_cache->direction;
+        type_tag = arg_cache->type_tag;
 
         if (type_tag == GI_TYPE_TAG_INTERFACE) {
             GIBaseInfo* interface_info;
             GIInfoType interface_type;
 
-            interface_info = g_type_info_get_interface(&type_info);
+            interface_info = g_type_info_get_interface(&arg_cache->type_info);
             interface_type = g_base_info_get_type(interface_info);
             if (interface_type == GI_INFO_TYPE_CALLBACK) {
                 if (strcmp(g_base_info_get_name(interface_info), "DestroyNotify") == 0 &&
                     strcmp(g_base_info_get_namespace(interface_info), "GLib") == 0) {
                     /* Skip GDestroyNotify if they appear before the respective callback */
-                    function->param_types[i] = PARAM_SKIPPED;
+                    arg_cache->param_type = PARAM_SKIPPED;
                 } else {
-                    function->param_types[i] = PARAM_CALLBACK;
+                    int destroy = g_arg_info_get_destroy(&arg_cache->arg_info);
+                    int closure = g_arg_info_get_closure(&arg_cache->arg_info);
+
+                    arg_cache->param_type = PARAM_CALLBACK;
                     function->expected_js_argc += 1;
 
-                    destroy = g_arg_info_get_destroy(&arg_info);
-                    closure = g_arg_info_get_closure(&arg_info);
+                    if (destroy >= 0 && destroy < n_args) {
+                        function->args[destroy].param_type = PARAM_SKIPPED;
+                        arg_cache->destroy_pos = destroy;
+                    }
 
-                    if (destroy >= 0 && destroy < n_args)
-                        function->param_types[destroy] = PARAM_SKIPPED;
+                    if (closure >= 0 && closure < n_args) {
+                        function->args[closure].param_type = PARAM_SKIPPED;
+                        arg_cache->closure_pos = closure;
+                    }
 
-                    if (closure >= 0 && closure < n_args)
-                        function->param_types[closure] = PARAM_SKIPPED;
+                    if (closure >= 0 && closure < n_args &&
+                        arg_cache->scope == GI_SCOPE_TYPE_ASYNC &&
+                        is_gio_info(interface_info, "AsyncReadyCallback"))
+                        function->async_callback_pos = i;
 
                     if (destroy >= 0 && closure < 0) {
                         gjs_throw(context, "Function %s.%s has a GDestroyNotify but no user_data, not supported",
@@ -1619,26 +2498,33 @@ init_cached_function_data (JSContext      *context,
                         g_base_info_unref(interface_info);
                         return false;
                     }
+
+                    /* Keep the reference, the invoker needs it to create
+                     * the trampoline */
+                    arg_cache->callback_info = (GICallableInfo *) interface_info;
+                    interface_info = NULL;
                 }
+            } else if (interface_type == GI_INFO_TYPE_INTERFACE &&
+                       direction == GI_DIRECTION_IN &&
+                       is_gio_info(interface_info, "AsyncResult")) {
+                function->async_result_pos = i;
             }
-            g_base_info_unref(interface_info);
+            if (interface_info)
+                g_base_info_unref(interface_info);
         } else if (type_tag == GI_TYPE_TAG_ARRAY) {
-            if (g_type_info_get_array_type(&type_info) == GI_ARRAY_TYPE_C) {
-                array_length_pos = g_type_info_get_array_length(&type_info);
+            if (g_type_info_get_array_type(&arg_cache->type_info) == GI_ARRAY_TYPE_C) {
+                array_length_pos = arg_cache->array_length_pos;
 
-                if (array_length_pos >= 0 && array_length_pos < n_args) {
-                    GIArgInfo length_arg_info;
-
-                    g_callable_info_load_arg((GICallableInfo*) info, array_length_pos, &length_arg_info);
-                    if (g_arg_info_get_direction(&length_arg_info) != direction) {
+                if (array_length_pos != GJS_ARG_INDEX_INVALID) {
+                    if (function->args[array_length_pos].direction != direction) {
                         gjs_throw(context, "Function %s.%s has an array with different-direction length arg, not supported",
                                   g_base_info_get_namespace( (GIBaseInfo*) info),
                                   g_base_info_get_name( (GIBaseInfo*) info));
                         return false;
                     }
 
-                    function->param_types[array_length_pos] = PARAM_SKIPPED;
-                    function->param_types[i] = PARAM_ARRAY;
+                    function->args[array_length_pos].param_type = PARAM_SKIPPED;
+                    arg_cache->param_type = PARAM_ARRAY;
 
                     if (array_length_pos < i) {
                         /* we already collected array_length_pos, remove it */
@@ -1651,8 +2537,8 @@ init_cached_function_data (JSContext      *context,
             }
         }
 
-        if (function->param_types[i] == PARAM_NORMAL ||
-            function->param_types[i] == PARAM_ARRAY) {
+        if (arg_cache->param_type == PARAM_NORMAL ||
+            arg_cache->param_type == PARAM_ARRAY) {
             if (direction == GI_DIRECTION_IN || direction == GI_DIRECTION_INOUT)
                 function->expected_js_argc += 1;
             if (direction == GI_DIRECTION_OUT || direction == GI_DIRECTION_INOUT)
@@ -1660,10 +2546,20 @@ init_cached_function_data (JSContext      *context,
         }
     }
 
+    if (info_type == GI_INFO_TYPE_FUNCTION &&
+        function->async_callback_pos != GJS_ARG_INDEX_INVALID)
+        init_async_function_data(function, info);
+
     function->info = info;
 
     g_base_info_ref((GIBaseInfo*) function->info);
 
+    if (function_is_scalar_only(function) &&
+        _gjs_context_optimization_enabled(context,
+                                          GJS_OPTIMIZATION_SCALAR_INVOKERS))
+        function->scalar_invoker =
+            scalar_invoker_for_return_tag(function->return_tag);
+
     return true;
 }
 
@@ -1763,8 +2659,10 @@ gjs_invoke_c_function_uncached(JSContext                  *context,
   bool result;
 
   memset (&function, 0, sizeof (Function));
-  if (!init_cached_function_data (context, &function, 0, info))
+  if (!init_cached_function_data (context, &function, 0, info)) {
+      uninit_cached_function_data (&function);
       return false;
+  }
 
   result = gjs_invoke_c_function(context, &function, obj, args,
                                  mozilla::Some(rval), NULL);
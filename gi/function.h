@@ -42,6 +42,8 @@ typedef enum {
     PARAM_CALLBACK
 } GjsParamType;
 
+typedef struct _GjsCallbackTrampolinePool GjsCallbackTrampolinePool;
+
 struct GjsCallbackTrampoline {
     gint ref_count;
     JSContext *context;
@@ -54,6 +56,10 @@ struct GjsCallbackTrampoline {
     GIScopeType scope;
     bool is_vfunc;
     GjsParamType *param_types;
+
+    /* Pool that the trampoline goes back to when released, if any */
+    GjsCallbackTrampolinePool *pool;
+    GjsCallbackTrampoline *next_free;
 };
 
 GjsCallbackTrampoline* gjs_callback_trampoline_new(JSContext      *context,
@@ -65,6 +71,8 @@ GjsCallbackTrampoline* gjs_callback_trampoline_new(JSContext      *context,
 void gjs_callback_trampoline_unref(GjsCallbackTrampoline *trampoline);
 void gjs_callback_trampoline_ref(GjsCallbackTrampoline *trampoline);
 
+void gjs_function_shutdown(JSContext *context);
+
 JSObject *gjs_define_function(JSContext       *context,
                               JS::HandleObject in_object,
                               GType            gtype,
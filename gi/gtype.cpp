@@ -135,7 +135,8 @@ get_name_func (JSContext *context,
         rec.rval().setNull();
         return true;
     }
-    return gjs_string_from_utf8(context, g_type_name(gtype), -1, rec.rval());
+    return gjs_string_from_borrowed_utf8(context, g_type_name(gtype),
+                                         rec.rval());
 }
 
 /* Properties */
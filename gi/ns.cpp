@@ -43,6 +43,206 @@ extern struct JSClass gjs_ns_class;
 
 GJS_DEFINE_PRIV_FROM_JS(Ns, gjs_ns_class)
 
+/* Startup snapshot: with GJS_GI_SNAPSHOT set to a file name, a run where
+ * that file doesn't exist yet records which infos get defined in each
+ * namespace, and writes them to the file when the context is torn down.
+ * Later runs read the file, and as soon as a namespace is imported, define
+ * the recorded infos in it in small batches from a low-priority idle, so
+ * that resolving them later on is a plain property lookup. */
+
+#define SNAPSHOT_VERSION_KEY "Version"
+#define SNAPSHOT_INFOS_KEY "Infos"
+/* Microseconds to spend defining infos per idle callback */
+#define SNAPSHOT_IDLE_BUDGET 2000
+
+typedef struct {
+    JSContext *cx;
+    JS::PersistentRootedObject *ns;
+    char **names;
+    unsigned next_name;
+    unsigned idle_id;
+} SnapshotPredefine;
+
+/* Replaying: the snapshot loaded from the file */
+static GKeyFile *snapshot;
+/* Recording: namespace -> GPtrArray of info names, in the order defined */
+static GHashTable *snapshot_recorded;
+static GList *snapshot_predefines;
+
+static void
+snapshot_init(void)
+{
+    static bool initialized = false;
+    if (initialized)
+        return;
+    initialized = true;
+
+    const char *path = g_getenv("GJS_GI_SNAPSHOT");
+    if (!path)
+        return;
+
+    snapshot = g_key_file_new();
+    if (g_key_file_load_from_file(snapshot, path, G_KEY_FILE_NONE, NULL))
+        return;
+
+    g_clear_pointer(&snapshot, g_key_file_free);
+    snapshot_recorded = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                                              (GDestroyNotify) g_ptr_array_unref);
+}
+
+static void
+snapshot_record(const char *ns_name,
+                const char *name)
+{
+    auto names = static_cast<GPtrArray *>(
+        g_hash_table_lookup(snapshot_recorded, ns_name));
+    if (!names) {
+        names = g_ptr_array_new_with_free_func(g_free);
+        g_hash_table_insert(snapshot_recorded, g_strdup(ns_name), names);
+    }
+    g_ptr_array_add(names, g_strdup(name));
+}
+
+static void
+snapshot_predefine_free(SnapshotPredefine *predefine)
+{
+    snapshot_predefines = g_list_remove(snapshot_predefines, predefine);
+    delete predefine->ns;
+    g_strfreev(predefine->names);
+    g_slice_free(SnapshotPredefine, predefine);
+}
+
+static gboolean
+snapshot_predefine_idle(void *data)
+{
+    auto predefine = static_cast<SnapshotPredefine *>(data);
+    JSContext *cx = predefine->cx;
+    GIRepository *repo = g_irepository_get_default();
+    int64_t deadline = g_get_monotonic_time() + SNAPSHOT_IDLE_BUDGET;
+
+    JSAutoRequest ar(cx);
+    JS::RootedObject ns(cx, *predefine->ns);
+    JSAutoCompartment ac(cx, ns);
+    Ns *priv = priv_from_js(cx, ns);
+
+    while (predefine->names[predefine->next_name] &&
+           g_get_monotonic_time() < deadline) {
+        const char *name = predefine->names[predefine->next_name++];
+        bool found, defined;
+
+        if (!JS_AlreadyHasOwnProperty(cx, ns, name, &found)) {
+            gjs_log_exception(cx);
+            continue;
+        }
+        if (found)
+            continue;
+
+        GIBaseInfo *info = g_irepository_find_by_name(repo, priv->gi_namespace,
+                                                      name);
+        if (!info)
+            continue;  /* stale snapshot */
+
+        if (!gjs_define_info(cx, ns, info, &defined))
+            gjs_log_exception(cx);
+        g_base_info_unref(info);
+    }
+
+    if (predefine->names[predefine->next_name])
+        return G_SOURCE_CONTINUE;
+
+    gjs_debug(GJS_DEBUG_GNAMESPACE, "Predefined %u infos in namespace '%s'",
+              predefine->next_name, priv->gi_namespace);
+    predefine->idle_id = 0;
+    snapshot_predefine_free(predefine);
+    return G_SOURCE_REMOVE;
+}
+
+static void
+snapshot_schedule_predefine(JSContext       *cx,
+                            JS::HandleObject ns,
+                            const char      *ns_name)
+{
+    if (!snapshot || !g_key_file_has_group(snapshot, ns_name))
+        return;
+
+    /* The infos are only valid for the version they were recorded with */
+    GjsAutoChar version = g_key_file_get_string(snapshot, ns_name,
+                                                SNAPSHOT_VERSION_KEY, NULL);
+    if (g_strcmp0(version, g_irepository_get_version(g_irepository_get_default(),
+                                                     ns_name)) != 0)
+        return;
+
+    char **names = g_key_file_get_string_list(snapshot, ns_name,
+                                              SNAPSHOT_INFOS_KEY, NULL, NULL);
+    if (!names)
+        return;
+
+    SnapshotPredefine *predefine = g_slice_new0(SnapshotPredefine);
+    predefine->cx = cx;
+    predefine->ns = new JS::PersistentRootedObject(cx, ns);
+    predefine->names = names;
+    predefine->idle_id = g_idle_add_full(G_PRIORITY_LOW,
+                                         snapshot_predefine_idle, predefine,
+                                         NULL);
+    snapshot_predefines = g_list_prepend(snapshot_predefines, predefine);
+}
+
+/**
+ * gjs_ns_snapshot_shutdown:
+ * @cx: the JS context that is being destroyed
+ *
+ * Stops predefining infos in @cx, and if recording a snapshot, writes it
+ * out.
+ */
+void
+gjs_ns_snapshot_shutdown(JSContext *cx)
+{
+    GList *l, *next;
+    for (l = snapshot_predefines; l; l = next) {
+        auto predefine = static_cast<SnapshotPredefine *>(l->data);
+        next = l->next;
+        if (predefine->cx != cx)
+            continue;
+        g_source_remove(predefine->idle_id);
+        snapshot_predefine_free(predefine);
+    }
+
+    if (!snapshot_recorded || g_hash_table_size(snapshot_recorded) == 0)
+        return;
+
+    GKeyFile *key_file = g_key_file_new();
+    GIRepository *repo = g_irepository_get_default();
+    GHashTableIter iter;
+    void *key, *value;
+    g_hash_table_iter_init(&iter, snapshot_recorded);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        auto ns_name = static_cast<const char *>(key);
+        auto names = static_cast<GPtrArray *>(value);
+        const char *version = g_irepository_get_version(repo, ns_name);
+        if (!version)
+            continue;
+
+        g_key_file_set_string(key_file, ns_name, SNAPSHOT_VERSION_KEY, version);
+        g_key_file_set_string_list(key_file, ns_name, SNAPSHOT_INFOS_KEY,
+                                   (const char * const *) names->pdata,
+                                   names->len);
+    }
+
+    GError *error = NULL;
+    const char *path = g_getenv("GJS_GI_SNAPSHOT");
+    if (!path || !g_key_file_save_to_file(key_file, path, &error)) {
+        g_warning("Could not write GI snapshot %s: %s", path,
+                  error ? error->message : "GJS_GI_SNAPSHOT was unset");
+        g_clear_error(&error);
+    } else {
+        gjs_debug(GJS_DEBUG_GNAMESPACE, "Wrote GI snapshot %s", path);
+    }
+    g_key_file_free(key_file);
+
+    /* Record only the first context's startup */
+    g_clear_pointer(&snapshot_recorded, g_hash_table_unref);
+}
+
 /*
  * The *objp out parameter, on success, should be null to indicate that id
  * was not resolved; and non-null, referring to obj or one of its prototypes,
@@ -107,6 +307,9 @@ ns_resolve(JSContext       *context,
         return false;
     }
 
+    if (defined && snapshot_recorded)
+        snapshot_record(priv->gi_namespace, name);
+
     /* we defined the property in this object? */
     g_base_info_unref(info);
     *resolved = defined;
@@ -123,7 +326,8 @@ get_name (JSContext *context,
     if (priv == NULL)
         return false;
 
-    return gjs_string_from_utf8(context, priv->gi_namespace, -1, args.rval());
+    return gjs_string_from_borrowed_utf8(context, priv->gi_namespace,
+                                         args.rval());
 }
 
 GJS_NATIVE_CONSTRUCTOR_DEFINE_ABSTRACT(ns)
@@ -205,6 +409,10 @@ ns_new(JSContext    *context,
 
     priv = priv_from_js(context, ns);
     priv->gi_namespace = g_strdup(ns_name);
+
+    snapshot_init();
+    snapshot_schedule_predefine(context, ns, ns_name);
+
     return ns;
 }
 
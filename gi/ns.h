@@ -33,6 +33,8 @@ G_BEGIN_DECLS
 JSObject* gjs_create_ns(JSContext    *context,
                         const char   *ns_name);
 
+void gjs_ns_snapshot_shutdown(JSContext *cx);
+
 G_END_DECLS
 
 #endif  /* __GJS_NS_H__ */
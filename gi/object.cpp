@@ -23,8 +23,6 @@
 
 #include <config.h>
 
-#include <deque>
-#include <map>
 #include <memory>
 #include <set>
 #include <stack>
@@ -50,6 +48,7 @@
 #include "gjs/jsapi-util-root.h"
 #include "gjs/jsapi-wrapper.h"
 #include "gjs/context-private.h"
+#include "gjs/gc-scheduler.h"
 #include "gjs/mem.h"
 
 #include <util/log.h>
@@ -64,16 +63,17 @@ struct ObjectInstance {
     GjsMaybeOwned<JSObject *> keep_alive;
     GType gtype;
 
-    /* a list of all signal connections, used when tracing */
-    std::set<ConnectData *> signals;
-    std::map<ConnectData *, unsigned> pending_invalidations;
+    /* a list of all signal connections, used when tracing; NULL if there
+     * are none, so objects without connections pay nothing for it */
+    ConnectData *signals;
 
     /* the GObjectClass wrapped by this JS Object (only used for
        prototypes) */
     GTypeClass *klass;
 
-    /* A list of all vfunc trampolines, used when tracing */
-    std::deque<GjsCallbackTrampoline *> vfuncs;
+    /* An array of all vfunc trampolines, used when tracing; only allocated
+     * for prototypes that override vfuncs */
+    GPtrArray *vfuncs;
 
     unsigned js_object_finalized : 1;
 };
@@ -81,6 +81,14 @@ struct ObjectInstance {
 struct _ConnectData {
     ObjectInstance *obj;
     GClosure *closure;
+    /* Links in ObjectInstance::signals */
+    ConnectData *prev;
+    ConnectData *next;
+    /* Idle that frees this after the closure was invalidated, or 0 */
+    unsigned idle_id;
+    /* Cleared when the object invalidates all its signals at once, after
+     * which the closure is no longer traced */
+    unsigned traced : 1;
 };
 
 static std::stack<JS::PersistentRootedObject> object_init_list;
@@ -113,6 +121,16 @@ gjs_is_custom_type_quark (void)
     return val;
 }
 
+static GQuark
+gjs_method_index_quark (void)
+{
+    static GQuark val = 0;
+    if (!val)
+        val = g_quark_from_static_string ("gjs::method-index");
+
+    return val;
+}
+
 static GQuark
 gjs_is_custom_property_quark (void)
 {
@@ -261,6 +279,24 @@ proto_priv_from_js(JSContext       *context,
     return priv_from_js(context, proto);
 }
 
+static bool
+property_accessors_enabled(JSContext *cx)
+{
+    return _gjs_context_optimization_enabled(cx,
+        GJS_OPTIMIZATION_PROPERTY_ACCESSORS);
+}
+
+/* Whether object_instance_resolve() has already turned every non-custom
+ * GObject property of @priv's class into an accessor on the prototype, in
+ * which case the getProperty and setProperty hooks only see other names */
+static bool
+g_params_have_accessors(JSContext      *cx,
+                        ObjectInstance *priv)
+{
+    return property_accessors_enabled(cx) &&
+        G_OBJECT_TYPE(priv->gobj) == priv->gtype;
+}
+
 static bool
 get_prop_from_g_param(JSContext             *context,
                       JS::HandleObject       obj,
@@ -412,7 +448,8 @@ object_instance_get_prop(JSContext              *context,
     if (priv->gobj == NULL) /* prototype, not an instance. */
         return true;
 
-    if (!get_prop_from_g_param(context, obj, priv, name, value_p))
+    if (!g_params_have_accessors(context, priv) &&
+        !get_prop_from_g_param(context, obj, priv, name, value_p))
         return false;
 
     if (!value_p.isUndefined())
@@ -522,9 +559,12 @@ object_instance_set_prop(JSContext              *context,
     if (priv->gobj == NULL) /* prototype, not an instance. */
         return result.succeed();
 
-    ret = set_g_param_from_prop(context, priv, name, g_param_was_set, value_p, result);
-    if (g_param_was_set || !ret)
-        return ret;
+    if (!g_params_have_accessors(context, priv)) {
+        ret = set_g_param_from_prop(context, priv, name, g_param_was_set,
+                                    value_p, result);
+        if (g_param_was_set || !ret)
+            return ret;
+    }
 
     /* note that the prop will also have been set in JS, which I think
      * is OK, since we hook get and set so will always override that
@@ -650,6 +690,308 @@ object_instance_resolve_no_info(JSContext       *context,
     return true;
 }
 
+/* Adds the methods of @container, an object or interface info, to @index,
+ * unless a method of the same name is already there */
+static void
+method_index_add_methods(GHashTable *index,
+                         GIBaseInfo *container,
+                         bool        only_methods)
+{
+    bool is_object = g_base_info_get_type(container) == GI_INFO_TYPE_OBJECT;
+    int n_methods = is_object ?
+        g_object_info_get_n_methods((GIObjectInfo *) container) :
+        g_interface_info_get_n_methods((GIInterfaceInfo *) container);
+
+    for (int i = 0; i < n_methods; i++) {
+        GIFunctionInfo *method_info = is_object ?
+            g_object_info_get_method((GIObjectInfo *) container, i) :
+            g_interface_info_get_method((GIInterfaceInfo *) container, i);
+        GQuark name = g_quark_from_string(g_base_info_get_name(method_info));
+
+        if ((only_methods &&
+             !(g_function_info_get_flags(method_info) & GI_FUNCTION_IS_METHOD)) ||
+            g_hash_table_contains(index, GUINT_TO_POINTER(name))) {
+            g_base_info_unref(method_info);
+            continue;
+        }
+
+        g_hash_table_insert(index, GUINT_TO_POINTER(name), method_info);
+    }
+}
+
+/* Returns a table of method name quark -> GIFunctionInfo holding everything
+ * that object_instance_resolve() would otherwise look up one name at a time
+ * with g_object_info_find_method_using_interfaces() and
+ * object_instance_resolve_no_info(). It is built in one pass the first
+ * time it is needed, and shared by all contexts through the GType's qdata. */
+static GHashTable *
+method_index_for_gtype(GType         gtype,
+                       GIObjectInfo *info)
+{
+    auto index = static_cast<GHashTable *>(g_type_get_qdata(gtype,
+        gjs_method_index_quark()));
+    if (index != NULL)
+        return index;
+
+    index = g_hash_table_new_full(NULL, NULL, NULL,
+                                  (GDestroyNotify) g_base_info_unref);
+
+    if (info != NULL) {
+        int n_interfaces = g_object_info_get_n_interfaces(info);
+
+        method_index_add_methods(index, info, false);
+        for (int i = 0; i < n_interfaces; i++) {
+            GIInterfaceInfo *iface_info = g_object_info_get_interface(info, i);
+            method_index_add_methods(index, iface_info, false);
+            g_base_info_unref(iface_info);
+        }
+    }
+
+    /* Methods of interfaces that the GType implements but the info doesn't
+     * mention, which is always the case for JS subclasses without info */
+    guint n_interfaces;
+    GType *interfaces = g_type_interfaces(gtype, &n_interfaces);
+    for (guint i = 0; i < n_interfaces; i++) {
+        GIBaseInfo *base_info =
+            g_irepository_find_by_gtype(g_irepository_get_default(),
+                                        interfaces[i]);
+        if (base_info == NULL)
+            continue;
+
+        /* An interface GType ought to have interface introspection info */
+        g_assert (g_base_info_get_type(base_info) == GI_INFO_TYPE_INTERFACE);
+
+        method_index_add_methods(index, base_info, true);
+        g_base_info_unref(base_info);
+    }
+    g_free(interfaces);
+
+    g_type_set_qdata(gtype, gjs_method_index_quark(), index);
+    return index;
+}
+
+static bool
+method_index_enabled(JSContext *cx)
+{
+    return _gjs_context_optimization_enabled(cx, GJS_OPTIMIZATION_METHOD_INDEX);
+}
+
+static bool
+object_instance_resolve_method(JSContext       *context,
+                               JS::HandleObject obj,
+                               bool            *resolved,
+                               ObjectInstance  *priv,
+                               const char      *name)
+{
+    GHashTable *index = method_index_for_gtype(priv->gtype, priv->info);
+    GIFunctionInfo *method_info = NULL;
+
+    /* Every method name in the index is a quark already, so if @name isn't
+     * one it can't be a method */
+    GQuark name_quark = g_quark_try_string(name);
+    if (name_quark != 0)
+        method_info = static_cast<GIFunctionInfo *>(g_hash_table_lookup(index,
+            GUINT_TO_POINTER(name_quark)));
+
+    if (method_info == NULL ||
+        !(g_function_info_get_flags(method_info) & GI_FUNCTION_IS_METHOD)) {
+        *resolved = false;
+        return true;
+    }
+
+#if GJS_VERBOSE_ENABLE_GI_USAGE
+    _gjs_log_info_usage((GIBaseInfo*) method_info);
+#endif
+
+    gjs_debug(GJS_DEBUG_GOBJECT,
+              "Defining method %s in prototype for %s",
+              g_base_info_get_name( (GIBaseInfo*) method_info),
+              g_type_name(priv->gtype));
+
+    if (gjs_define_function(context, obj, priv->gtype, method_info) == NULL)
+        return false;
+
+    *resolved = true; /* we defined the prop in obj */
+    return true;
+}
+
+/* Reserved slots of JSNative property accessors */
+enum {
+    SLOT_PARAM_SPEC,
+};
+
+static GParamSpec *
+accessor_param_spec(JSObject *func_obj)
+{
+    return static_cast<GParamSpec *>(
+        js::GetFunctionNativeReserved(func_obj, SLOT_PARAM_SPEC).toPrivate());
+}
+
+/* What g_object_get_property() does once it has found @pspec by name */
+static void
+object_get_param_value(GObject    *gobj,
+                       GParamSpec *pspec,
+                       GValue     *value)
+{
+    if (!G_TYPE_IS_OBJECT(pspec->owner_type)) {
+        g_object_get_property(gobj, pspec->name, value);
+        return;
+    }
+
+    auto klass = static_cast<GObjectClass *>(
+        g_type_class_peek(pspec->owner_type));
+    GParamSpec *redirect = g_param_spec_get_redirect_target(pspec);
+
+    g_object_ref(gobj);
+    klass->get_property(gobj, pspec->param_id, value,
+                        redirect ? redirect : pspec);
+    g_object_unref(gobj);
+}
+
+static ObjectInstance *
+accessor_instance_priv(JSContext       *cx,
+                       JS::HandleObject obj,
+                       GParamSpec      *pspec)
+{
+    ObjectInstance *priv = priv_from_js(cx, obj);
+
+    /* prototype, or not a GObject at all; behave like a missing property */
+    if (priv == NULL || priv->gobj == NULL)
+        return NULL;
+
+    if (!g_type_is_a(G_OBJECT_TYPE(priv->gobj), pspec->owner_type))
+        return NULL;
+
+    return priv;
+}
+
+static bool
+object_property_getter(JSContext *cx,
+                       unsigned   argc,
+                       JS::Value *vp)
+{
+    GJS_GET_THIS(cx, argc, vp, args, obj);
+    GParamSpec *pspec = accessor_param_spec(&args.callee());
+    ObjectInstance *priv = accessor_instance_priv(cx, obj, pspec);
+
+    args.rval().setUndefined();
+    if (priv == NULL || (pspec->flags & G_PARAM_READABLE) == 0)
+        return true;
+
+    GValue gvalue = G_VALUE_INIT;
+    g_value_init(&gvalue, G_PARAM_SPEC_VALUE_TYPE(pspec));
+    object_get_param_value(priv->gobj, pspec, &gvalue);
+
+    bool retval = gjs_value_from_g_value(cx, args.rval(), &gvalue);
+    g_value_unset(&gvalue);
+    return retval;
+}
+
+static bool
+object_property_setter(JSContext *cx,
+                       unsigned   argc,
+                       JS::Value *vp)
+{
+    GJS_GET_THIS(cx, argc, vp, args, obj);
+    GParamSpec *pspec = accessor_param_spec(&args.callee());
+    ObjectInstance *priv = accessor_instance_priv(cx, obj, pspec);
+
+    args.rval().setUndefined();  /* No stored value */
+    if (priv == NULL)
+        return true;
+
+    if ((pspec->flags & G_PARAM_WRITABLE) == 0) {
+        gjs_throw(cx, "Property %s (GObject %s) is not writable",
+                  pspec->name, g_type_name(G_OBJECT_TYPE(priv->gobj)));
+        return false;
+    }
+
+    GValue gvalue = G_VALUE_INIT;
+    g_value_init(&gvalue, G_PARAM_SPEC_VALUE_TYPE(pspec));
+    if (!gjs_value_to_g_value(cx, args.get(0), &gvalue)) {
+        g_value_unset(&gvalue);
+        return false;
+    }
+
+    /* pspec->name is canonical, so this is a single hash lookup */
+    g_object_set_property(priv->gobj, pspec->name, &gvalue);
+    g_value_unset(&gvalue);
+    return true;
+}
+
+static JSObject *
+define_property_accessor(JSContext  *cx,
+                         JSNative    call,
+                         unsigned    nargs,
+                         const char *func_name,
+                         GParamSpec *pspec)
+{
+    JSFunction *func = js::NewFunctionWithReserved(cx, call, nargs, 0,
+                                                   func_name);
+    if (!func)
+        return NULL;
+
+    /* The class owns the pspec, and GObject classes are never freed */
+    JSObject *func_obj = JS_GetFunctionObject(func);
+    js::SetFunctionNativeReserved(func_obj, SLOT_PARAM_SPEC,
+                                  JS::PrivateValue(pspec));
+    return func_obj;
+}
+
+/* Defines a GObject property as a JS accessor on the prototype, so that
+ * reading and writing it later doesn't have to map @name to a GParamSpec
+ * again in object_instance_get_prop() and object_instance_set_prop(). */
+static bool
+object_instance_resolve_property(JSContext       *context,
+                                 JS::HandleObject obj,
+                                 bool            *resolved,
+                                 ObjectInstance  *priv,
+                                 const char      *name)
+{
+    GjsAutoChar gname = gjs_hyphen_from_camel(name);
+    void *klass = g_type_class_ref(priv->gtype);
+    GParamSpec *pspec = g_object_class_find_property(G_OBJECT_CLASS(klass),
+                                                     gname);
+    g_type_class_unref(klass);
+
+    /* JS overridden properties are left to the JS class to define */
+    if (pspec == NULL ||
+        g_param_spec_get_qdata(pspec, gjs_is_custom_property_quark())) {
+        *resolved = false;
+        return true;
+    }
+
+    gjs_debug_jsprop(GJS_DEBUG_GOBJECT,
+                     "Defining accessor %s for GObject prop %s on %s",
+                     name, pspec->name, g_type_name(priv->gtype));
+
+    GjsAutoChar getter_name = g_strconcat("gobject_property_get::", name,
+                                          NULL);
+    GjsAutoChar setter_name = g_strconcat("gobject_property_set::", name,
+                                          NULL);
+
+    JS::RootedObject getter(context,
+        define_property_accessor(context, object_property_getter, 0,
+                                 getter_name, pspec));
+    if (!getter)
+        return false;
+
+    JS::RootedObject setter(context,
+        define_property_accessor(context, object_property_setter, 1,
+                                 setter_name, pspec));
+    if (!setter)
+        return false;
+
+    if (!JS_DefineProperty(context, obj, name, JS::UndefinedHandleValue,
+                           JSPROP_PERMANENT | JSPROP_SHARED | JSPROP_GETTER | JSPROP_SETTER,
+                           JS_DATA_TO_FUNC_PTR(JSNative, getter.get()),
+                           JS_DATA_TO_FUNC_PTR(JSNative, setter.get())))
+        return false;
+
+    *resolved = true;
+    return true;
+}
+
 /*
  * The *objp out parameter, on success, should be null to indicate that id
  * was not resolved; and non-null, referring to obj or one of its prototypes,
@@ -700,10 +1042,24 @@ object_instance_resolve(JSContext       *context,
         return true;
     }
 
+    /* Properties first, since the getProperty hook used to let them shadow
+     * methods of the same name */
+    if (property_accessors_enabled(context)) {
+        if (!object_instance_resolve_property(context, obj, resolved, priv,
+                                              name))
+            return false;
+        if (*resolved)
+            return true;
+    }
+
     /* If we have no GIRepository information (we're a JS GObject subclass),
      * we need to look at exposing interfaces. Look up our interfaces through
      * GType data, and then hope that *those* are introspectable. */
     if (priv->info == NULL) {
+        if (method_index_enabled(context))
+            return object_instance_resolve_method(context, obj, resolved,
+                                                  priv, name);
+
         bool status = object_instance_resolve_no_info(context, obj, resolved, priv, name);
         return status;
     }
@@ -759,6 +1115,10 @@ object_instance_resolve(JSContext       *context,
      * introduces the iface)
      */
 
+    if (method_index_enabled(context))
+        return object_instance_resolve_method(context, obj, resolved, priv,
+                                              name);
+
     method_info = g_object_info_find_method_using_interfaces(priv->info,
                                                              name,
                                                              NULL);
@@ -1185,6 +1545,10 @@ associate_js_gobject (JSContext       *context,
 
     g_object_weak_ref(gobj, wrapped_gobj_dispose_notify, priv);
 
+    GTypeQuery query;
+    g_type_query(G_OBJECT_TYPE(gobj), &query);
+    gjs_gc_note_native_alloc(context, sizeof(ObjectInstance) + query.instance_size);
+
     /* OK, here is where things get complicated. We want the
      * wrapped gobj to keep the JSObject* wrapper alive, because
      * people might set properties on the JSObject* that they care
@@ -1201,18 +1565,46 @@ associate_js_gobject (JSContext       *context,
     g_object_add_toggle_ref(gobj, wrapped_gobj_toggle_notify, NULL);
 }
 
+static void
+connect_data_link(ObjectInstance *priv,
+                  ConnectData    *cd)
+{
+    cd->obj = priv;
+    cd->prev = NULL;
+    cd->next = priv->signals;
+    if (priv->signals)
+        priv->signals->prev = cd;
+    priv->signals = cd;
+}
+
+static void
+connect_data_unlink(ObjectInstance *priv,
+                    ConnectData    *cd)
+{
+    if (cd->prev)
+        cd->prev->next = cd->next;
+    else
+        priv->signals = cd->next;
+    if (cd->next)
+        cd->next->prev = cd->prev;
+    cd->prev = cd->next = NULL;
+}
+
 static void
 invalidate_all_signals(ObjectInstance *priv)
 {
-    /* Can't loop directly through the items, since invalidating an item's
-     * closure might have the effect of removing the item from the set in the
-     * invalidate notifier */
-    while (!priv->signals.empty()) {
+    /* The invalidate notifier doesn't remove the item from the list, it
+     * defers that to an idle, so we can walk the list directly. */
+    ConnectData *cd, *next;
+    for (cd = priv->signals; cd != NULL; cd = next) {
+        next = cd->next;
+        if (!cd->traced)
+            continue;
+
         /* This will also free cd, through the closure invalidation mechanism */
-        ConnectData *cd = *priv->signals.begin();
-        g_closure_invalidate(cd->closure);
-        /* Erase element if not already erased */
-        priv->signals.erase(cd);
+        if (cd->idle_id == 0)
+            g_closure_invalidate(cd->closure);
+        cd->traced = false;
     }
 }
 
@@ -1375,11 +1767,17 @@ object_instance_trace(JSTracer *tracer,
     if (priv == NULL)
         return;
 
-    for (ConnectData *cd : priv->signals)
-        gjs_closure_trace(cd->closure, tracer);
+    for (ConnectData *cd = priv->signals; cd != NULL; cd = cd->next) {
+        if (cd->traced)
+            gjs_closure_trace(cd->closure, tracer);
+    }
 
-    for (auto vfunc : priv->vfuncs)
-        vfunc->js_function.trace(tracer, "ObjectInstance::vfunc");
+    if (priv->vfuncs != NULL) {
+        for (unsigned i = 0; i < priv->vfuncs->len; i++) {
+            auto vfunc = static_cast<GjsCallbackTrampoline *>(priv->vfuncs->pdata[i]);
+            vfunc->js_function.trace(tracer, "ObjectInstance::vfunc");
+        }
+    }
 }
 
 /* Removing the signal connection data from the list means that the object stops
@@ -1391,8 +1789,7 @@ static gboolean
 signal_connection_invalidate_idle(void *user_data)
 {
     auto cd = static_cast<ConnectData *>(user_data);
-    cd->obj->pending_invalidations.erase(cd);
-    cd->obj->signals.erase(cd);
+    connect_data_unlink(cd->obj, cd);
     g_slice_free(ConnectData, cd);
     return G_SOURCE_REMOVE;
 }
@@ -1402,9 +1799,8 @@ signal_connection_invalidated(void     *data,
                               GClosure *closure)
 {
     auto cd = static_cast<ConnectData *>(data);
-    std::map<ConnectData *, unsigned>& pending = cd->obj->pending_invalidations;
-    g_assert(pending.count(cd) == 0);
-    pending[cd] = g_idle_add(signal_connection_invalidate_idle, cd);
+    g_assert(cd->idle_id == 0);
+    cd->idle_id = g_idle_add(signal_connection_invalidate_idle, cd);
 }
 
 /* This is basically the same as invalidate_all_signals(), but does not defer
@@ -1412,31 +1808,23 @@ signal_connection_invalidated(void     *data,
 static void
 invalidate_all_signals_now(ObjectInstance *priv)
 {
-    for (auto& iter : priv->pending_invalidations) {
-        ConnectData *cd = iter.first;
-        g_source_remove(iter.second);
-        g_slice_free(ConnectData, cd);
-        /* Erase element if not already erased */
-        priv->signals.erase(cd);
-    }
-    priv->pending_invalidations.clear();
-
-    /* Can't loop directly through the items, since invalidating an item's
-     * closure might have the effect of removing the item from the set in the
-     * invalidate notifier. */
-    while (!priv->signals.empty()) {
-        ConnectData *cd = *priv->signals.begin();
+    ConnectData *cd, *next;
+    for (cd = priv->signals; cd != NULL; cd = next) {
+        next = cd->next;
 
-        /* We have to remove the invalidate notifier, which would
-         * otherwise schedule a new pending invalidation. */
-        g_closure_remove_invalidate_notifier(cd->closure, cd,
-                                             signal_connection_invalidated);
-        g_closure_invalidate(cd->closure);
+        if (cd->idle_id != 0) {
+            g_source_remove(cd->idle_id);
+        } else {
+            /* We have to remove the invalidate notifier, which would
+             * otherwise schedule a new pending invalidation. */
+            g_closure_remove_invalidate_notifier(cd->closure, cd,
+                                                 signal_connection_invalidated);
+            g_closure_invalidate(cd->closure);
+        }
 
         g_slice_free(ConnectData, cd);
-        /* Erase element if not already erased */
-        priv->signals.erase(cd);
     }
+    priv->signals = NULL;
 }
 
 static void
@@ -1494,9 +1882,14 @@ object_instance_finalize(JSFreeOp  *fop,
 
     /* We have to leak the trampolines, since the GType's vtable still refers
      * to them */
-    for (auto iter : priv->vfuncs)
-        iter->js_function.reset();
-    priv->vfuncs.clear();
+    if (priv->vfuncs != NULL) {
+        for (unsigned i = 0; i < priv->vfuncs->len; i++) {
+            auto vfunc = static_cast<GjsCallbackTrampoline *>(priv->vfuncs->pdata[i]);
+            vfunc->js_function.reset();
+        }
+        g_ptr_array_free(priv->vfuncs, true);
+        priv->vfuncs = NULL;
+    }
 
     if (priv->keep_alive.rooted()) {
         /* This happens when the refcount on the object is still >1,
@@ -1591,6 +1984,58 @@ gjs_lookup_object_prototype_from_info(JSContext    *context,
     return value.toObjectOrNull();
 }
 
+/* Finds the context's cached constructor and prototype for @gtype, looking
+ * them up through the namespace the first time. *entry_out is set to NULL if
+ * there is no cache to use, in which case the caller has to do the lookup
+ * itself. */
+static bool
+class_cache_lookup(JSContext                 *context,
+                   GType                      gtype,
+                   const GjsClassCacheEntry **entry_out)
+{
+    *entry_out = NULL;
+
+    auto gjs_context = static_cast<GjsContext *>(JS_GetContextPrivate(context));
+    GjsClassCache *cache = _gjs_context_get_class_cache(gjs_context);
+    if (cache == NULL)
+        return true;
+
+    auto iter = cache->find(gtype);
+    if (iter != cache->end()) {
+        GJS_INC_STAT(class_cache_hit);
+        *entry_out = &iter->second;
+        return true;
+    }
+
+    GJS_INC_STAT(class_cache_miss);
+
+    GIObjectInfo *info = (GIObjectInfo *)
+        g_irepository_find_by_gtype(g_irepository_get_default(), gtype);
+    JS::RootedObject constructor(context,
+        gjs_lookup_object_constructor_from_info(context, info, gtype));
+    if (info)
+        g_base_info_unref((GIBaseInfo *)info);
+    if (G_UNLIKELY(!constructor))
+        return false;
+
+    JS::RootedValue value(context);
+    if (!gjs_object_get_property(context, constructor,
+                                 GJS_STRING_PROTOTYPE, &value))
+        return false;
+    if (G_UNLIKELY(!value.isObject())) {
+        gjs_throw(context, "Prototype of %s is not an object",
+                  g_type_name(gtype));
+        return false;
+    }
+
+    /* Defining the class may have cached its parents, but not @gtype */
+    GjsClassCacheEntry& entry = (*cache)[gtype];
+    entry.constructor = constructor;
+    entry.prototype = &value.toObject();
+    *entry_out = &entry;
+    return true;
+}
+
 static JSObject *
 gjs_lookup_object_prototype(JSContext *context,
                             GType      gtype)
@@ -1598,6 +2043,12 @@ gjs_lookup_object_prototype(JSContext *context,
     GIObjectInfo *info;
     JSObject *proto;
 
+    const GjsClassCacheEntry *cached;
+    if (!class_cache_lookup(context, gtype, &cached))
+        return NULL;
+    if (cached)
+        return cached->prototype.get();
+
     info = (GIObjectInfo*)g_irepository_find_by_gtype(g_irepository_get_default(), gtype);
     proto = gjs_lookup_object_prototype_from_info(context, info, gtype);
     if (info)
@@ -1658,8 +2109,8 @@ real_connect_func(JSContext *context,
         return false;
 
     connect_data = g_slice_new0(ConnectData);
-    priv->signals.insert(connect_data);
-    connect_data->obj = priv;
+    connect_data_link(priv, connect_data);
+    connect_data->traced = true;
     /* This is a weak reference, and will be cleared when the closure is invalidated */
     connect_data->closure = closure;
     g_closure_add_invalidate_notifier(closure, connect_data, signal_connection_invalidated);
@@ -1691,6 +2142,69 @@ connect_func(JSContext *context,
     return real_connect_func(context, argc, vp, false);
 }
 
+/* Cached per signal ID: the signal's query, and GValues already initialized
+ * to its parameter types that are reused by every emission. The instance
+ * slot is initialized for each emission, since it depends on the instance's
+ * type. All are reset after each emission, so they don't keep any
+ * arguments alive. */
+typedef struct {
+    GSignalQuery signal_query;
+    GValue *instance_and_args;
+    bool in_use;
+} SignalEmitter;
+
+static GHashTable *signal_emitters;
+
+static SignalEmitter *
+signal_emitter_for_id(guint signal_id)
+{
+    SignalEmitter *emitter;
+
+    if (signal_emitters == NULL)
+        signal_emitters = g_hash_table_new(NULL, NULL);
+
+    emitter = (SignalEmitter *) g_hash_table_lookup(signal_emitters,
+                                                    GUINT_TO_POINTER(signal_id));
+    if (emitter != NULL)
+        return emitter;
+
+    emitter = g_new0(SignalEmitter, 1);
+    g_signal_query(signal_id, &emitter->signal_query);
+    emitter->instance_and_args = g_new0(GValue,
+                                        emitter->signal_query.n_params + 1);
+    for (guint i = 0; i < emitter->signal_query.n_params; i++)
+        g_value_init(&emitter->instance_and_args[i + 1],
+                     emitter->signal_query.param_types[i] & ~G_SIGNAL_TYPE_STATIC_SCOPE);
+
+    g_hash_table_insert(signal_emitters, GUINT_TO_POINTER(signal_id), emitter);
+    return emitter;
+}
+
+/* Like gjs_value_to_g_value(), but takes a shortcut for the common case of
+ * passing a wrapped GObject to a GObject parameter */
+static bool
+emit_arg_to_g_value(JSContext      *context,
+                    JS::HandleValue value,
+                    GType           param_type,
+                    GValue         *gvalue)
+{
+    if (value.isObject() && g_type_is_a(G_VALUE_TYPE(gvalue), G_TYPE_OBJECT)) {
+        JS::RootedObject arg_obj(context, &value.toObject());
+        ObjectInstance *arg_priv = priv_from_js(context, arg_obj);
+
+        if (arg_priv != NULL && arg_priv->gobj != NULL &&
+            g_type_is_a(G_OBJECT_TYPE(arg_priv->gobj),
+                        G_VALUE_TYPE(gvalue))) {
+            g_value_set_object(gvalue, arg_priv->gobj);
+            return true;
+        }
+    }
+
+    if ((param_type & G_SIGNAL_TYPE_STATIC_SCOPE) != 0)
+        return gjs_value_to_g_value_no_copy(context, value, gvalue);
+    return gjs_value_to_g_value(context, value, gvalue);
+}
+
 static bool
 emit_func(JSContext *context,
           unsigned   argc,
@@ -1699,12 +2213,15 @@ emit_func(JSContext *context,
     GJS_GET_PRIV(context, argc, vp, argv, obj, ObjectInstance, priv);
     guint signal_id;
     GQuark signal_detail;
-    GSignalQuery signal_query;
+    SignalEmitter *emitter;
+    const GSignalQuery *signal_query;
     GjsAutoJSChar signal_name(context);
     GValue *instance_and_args;
+    GValue *args;
     GValue rvalue = G_VALUE_INIT;
     unsigned int i;
     bool failed;
+    bool reuse_args;
 
     gjs_debug_gsignal("emit obj %p priv %p argc %d", obj.get(), priv, argc);
 
@@ -1740,38 +2257,44 @@ emit_func(JSContext *context,
         return false;
     }
 
-    g_signal_query(signal_id, &signal_query);
+    emitter = signal_emitter_for_id(signal_id);
+    signal_query = &emitter->signal_query;
 
-    if ((argc - 1) != signal_query.n_params) {
+    if ((argc - 1) != signal_query->n_params) {
         gjs_throw(context, "Signal '%s' on %s requires %d args got %d",
                   signal_name.get(),
                   g_type_name(G_OBJECT_TYPE(priv->gobj)),
-                  signal_query.n_params,
+                  signal_query->n_params,
                   argc - 1);
         return false;
     }
 
-    if (signal_query.return_type != G_TYPE_NONE) {
-        g_value_init(&rvalue, signal_query.return_type & ~G_SIGNAL_TYPE_STATIC_SCOPE);
+    if (signal_query->return_type != G_TYPE_NONE) {
+        g_value_init(&rvalue, signal_query->return_type & ~G_SIGNAL_TYPE_STATIC_SCOPE);
     }
 
-    instance_and_args = g_newa(GValue, signal_query.n_params + 1);
-    memset(instance_and_args, 0, sizeof(GValue) * (signal_query.n_params + 1));
+    /* If a handler emits the same signal again, the cached GValues are busy
+     * and we use fresh ones */
+    reuse_args = !emitter->in_use;
+    if (reuse_args) {
+        emitter->in_use = true;
+        instance_and_args = emitter->instance_and_args;
+    } else {
+        instance_and_args = g_newa(GValue, signal_query->n_params + 1);
+        memset(instance_and_args, 0, sizeof(GValue) * (signal_query->n_params + 1));
+        for (i = 0; i < signal_query->n_params; ++i)
+            g_value_init(&instance_and_args[i + 1],
+                         signal_query->param_types[i] & ~G_SIGNAL_TYPE_STATIC_SCOPE);
+    }
+    args = &instance_and_args[1];
 
     g_value_init(&instance_and_args[0], G_TYPE_FROM_INSTANCE(priv->gobj));
     g_value_set_instance(&instance_and_args[0], priv->gobj);
 
     failed = false;
-    for (i = 0; i < signal_query.n_params; ++i) {
-        GValue *value;
-        value = &instance_and_args[i + 1];
-
-        g_value_init(value, signal_query.param_types[i] & ~G_SIGNAL_TYPE_STATIC_SCOPE);
-        if ((signal_query.param_types[i] & G_SIGNAL_TYPE_STATIC_SCOPE) != 0)
-            failed = !gjs_value_to_g_value_no_copy(context, argv[i + 1], value);
-        else
-            failed = !gjs_value_to_g_value(context, argv[i + 1], value);
-
+    for (i = 0; i < signal_query->n_params; ++i) {
+        failed = !emit_arg_to_g_value(context, argv[i + 1],
+                                      signal_query->param_types[i], &args[i]);
         if (failed)
             break;
     }
@@ -1781,7 +2304,7 @@ emit_func(JSContext *context,
                        &rvalue);
     }
 
-    if (signal_query.return_type != G_TYPE_NONE) {
+    if (signal_query->return_type != G_TYPE_NONE) {
         if (!gjs_value_from_g_value(context, argv.rval(), &rvalue))
             failed = true;
 
@@ -1790,8 +2313,14 @@ emit_func(JSContext *context,
         argv.rval().setUndefined();
     }
 
-    for (i = 0; i < (signal_query.n_params + 1); ++i) {
-        g_value_unset(&instance_and_args[i]);
+    g_value_unset(&instance_and_args[0]);
+    if (reuse_args) {
+        for (i = 0; i < signal_query->n_params; ++i)
+            g_value_reset(&args[i]);
+        emitter->in_use = false;
+    } else {
+        for (i = 0; i < signal_query->n_params; ++i)
+            g_value_unset(&args[i]);
     }
 
     return !failed;
@@ -2327,7 +2856,9 @@ gjs_hook_up_vfunc(JSContext *cx,
                                                  GI_SCOPE_TYPE_NOTIFIED, true);
 
         *((ffi_closure **)method_ptr) = trampoline->closure;
-        priv->vfuncs.push_back(trampoline);
+        if (priv->vfuncs == NULL)
+            priv->vfuncs = g_ptr_array_new();
+        g_ptr_array_add(priv->vfuncs, trampoline);
 
         g_base_info_unref(interface_info);
         g_base_info_unref(type_info);
@@ -3005,6 +3536,14 @@ gjs_lookup_object_constructor(JSContext             *context,
     JSObject *constructor;
     GIObjectInfo *object_info;
 
+    const GjsClassCacheEntry *cached;
+    if (!class_cache_lookup(context, gtype, &cached))
+        return false;
+    if (cached) {
+        value_p.setObject(*cached->constructor.get());
+        return true;
+    }
+
     object_info = (GIObjectInfo*)g_irepository_find_by_gtype(NULL, gtype);
 
     g_assert(object_info == NULL ||
@@ -159,7 +159,27 @@ struct JSClass gjs_param_class = {
     &gjs_param_class_ops
 };
 
+/* Property names stay at the same address for as long as the ParamSpec, so
+ * they go through the borrowed string cache */
+static bool
+param_get_name(JSContext *context,
+               unsigned   argc,
+               JS::Value *vp)
+{
+    GJS_GET_PRIV(context, argc, vp, args, obj, Param, priv);
+
+    if (!priv || !priv->gparam) {
+        args.rval().setUndefined();
+        return true;
+    }
+
+    return gjs_string_from_borrowed_utf8(context,
+                                         g_param_spec_get_name(priv->gparam),
+                                         args.rval());
+}
+
 JSPropertySpec gjs_param_proto_props[] = {
+    JS_PSG("name", param_get_name, JSPROP_PERMANENT),
     JS_PS_END
 };
 
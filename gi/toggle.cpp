@@ -23,68 +23,91 @@
  * Authored by: Philip Chimento <philip@endlessm.com>, <philip.chimento@gmail.com>
  */
 
-#include <algorithm>
 #include <deque>
 #include <mutex>
+#include <unordered_map>
 #include <glib-object.h>
 
 #include "toggle.h"
 
-std::deque<ToggleQueue::Item>::iterator
-ToggleQueue::find_operation_locked(GObject               *gobj,
-                                   ToggleQueue::Direction direction)
+bool
+ToggleQueue::is_pending_locked(const Item& item)
 {
-    return std::find_if(q.begin(), q.end(),
-        [gobj, direction](const Item& item)->bool {
-            return item.gobj == gobj && item.direction == direction;
-        });
+    auto pos = pending.find(item.gobj);
+    return pos != pending.end() &&
+        pos->second.serial[item.direction] == item.serial;
 }
 
 bool
-ToggleQueue::find_and_erase_operation_locked(GObject               *gobj,
-                                             ToggleQueue::Direction direction)
+ToggleQueue::erase_pending_locked(GObject               *gobj,
+                                  ToggleQueue::Direction direction)
 {
-    auto pos = find_operation_locked(gobj, direction);
-    bool had_toggle = (pos != q.end());
-    if (had_toggle)
-        q.erase(pos);
-    return had_toggle;
+    auto pos = pending.find(gobj);
+    if (pos == pending.end() || pos->second.serial[direction] == 0)
+        return false;
+
+    pos->second.serial[direction] = 0;
+    if (pos->second.serial[DOWN] == 0 && pos->second.serial[UP] == 0)
+        pending.erase(pos);
+    return true;
 }
 
-gboolean
-ToggleQueue::idle_handle_toggle(void *data)
+/* Pops the oldest item that is still pending, dropping cancelled ones on
+ * the way. Returns false if there is none. */
+bool
+ToggleQueue::pop_locked(Item *item)
 {
-    auto self = static_cast<ToggleQueue *>(data);
-    while (self->handle_toggle(self->m_toggle_handler))
-        ;
+    while (!q.empty()) {
+        Item front = q.front();
+        q.pop_front();
 
-    return G_SOURCE_REMOVE;
+        if (is_pending_locked(front)) {
+            erase_pending_locked(front.gobj, front.direction);
+            *item = front;
+            return true;
+        }
+    }
+    return false;
 }
 
-void
-ToggleQueue::idle_destroy_notify(void *data)
+gboolean
+ToggleQueue::idle_handle_toggle(void *data)
 {
     auto self = static_cast<ToggleQueue *>(data);
+    for (unsigned i = 0; i < MAX_BATCH; i++) {
+        if (!self->handle_toggle(self->m_toggle_handler))
+            break;
+    }
+
+    /* Decide under the lock whether we're done, so that a toggle enqueued
+     * from another thread in the meantime always either sees the idle
+     * still installed or installs a new one */
     std::lock_guard<std::mutex> hold(self->lock);
+    if (!self->pending.empty())
+        return G_SOURCE_CONTINUE;
+
+    self->q.clear();  /* only cancelled items are left */
     self->m_idle_id = 0;
     self->m_toggle_handler = nullptr;
+    return G_SOURCE_REMOVE;
 }
 
 std::pair<bool, bool>
 ToggleQueue::is_queued(GObject *gobj)
 {
     std::lock_guard<std::mutex> hold(lock);
-    bool has_toggle_down = find_operation_locked(gobj, DOWN) != q.end();
-    bool has_toggle_up = find_operation_locked(gobj, UP) != q.end();
-    return {has_toggle_down, has_toggle_up};
+    auto pos = pending.find(gobj);
+    if (pos == pending.end())
+        return {false, false};
+    return {pos->second.serial[DOWN] != 0, pos->second.serial[UP] != 0};
 }
 
 std::pair<bool, bool>
 ToggleQueue::cancel(GObject *gobj)
 {
     std::lock_guard<std::mutex> hold(lock);
-    bool had_toggle_down = find_and_erase_operation_locked(gobj, DOWN);
-    bool had_toggle_up = find_and_erase_operation_locked(gobj, UP);
+    bool had_toggle_down = erase_pending_locked(gobj, DOWN);
+    bool had_toggle_up = erase_pending_locked(gobj, UP);
     return {had_toggle_down, had_toggle_up};
 }
 
@@ -94,12 +117,10 @@ ToggleQueue::handle_toggle(Handler handler)
     Item item;
     {
         std::lock_guard<std::mutex> hold(lock);
-        if (q.empty())
+        if (!pop_locked(&item))
             return false;
 
-        item = q.front();
         handler(item.gobj, item.direction);
-        q.pop_front();
     }
     
     if (item.needs_unref)
@@ -114,6 +135,7 @@ ToggleQueue::enqueue(GObject               *gobj,
                      ToggleQueue::Handler   handler)
 {
     Item item{gobj, direction};
+    bool coalesced = false;
     /* If we're toggling up we take a reference to the object now,
      * so it won't toggle down before we process it. This ensures we
      * only ever have at most two toggle notifications queued.
@@ -132,16 +154,33 @@ ToggleQueue::enqueue(GObject               *gobj,
      * the object to toggle back up again.
      */   
 
-    std::lock_guard<std::mutex> hold(lock);
-    q.push_back(item);
-    
-    if (m_idle_id) {
-        g_assert(((void) "Should always enqueue with the same handler",
-                  m_toggle_handler == handler));
-        return;
+    {
+        std::lock_guard<std::mutex> hold(lock);
+
+        /* A down-up pair leaves the JSObject rooted, as it still is now,
+         * so neither toggle needs to be handled */
+        if (direction == UP && erase_pending_locked(gobj, DOWN)) {
+            coalesced = true;
+        } else {
+            item.serial = m_next_serial++;
+            if (G_UNLIKELY(m_next_serial == 0))
+                m_next_serial = 1;
+            pending[gobj].serial[direction] = item.serial;
+            q.push_back(item);
+
+            if (m_idle_id) {
+                g_assert(((void) "Should always enqueue with the same handler",
+                          m_toggle_handler == handler));
+            } else {
+                m_toggle_handler = handler;
+                m_idle_id = g_idle_add_full(G_PRIORITY_HIGH, idle_handle_toggle,
+                                            this, nullptr);
+            }
+        }
     }
 
-    m_toggle_handler = handler;
-    m_idle_id = g_idle_add_full(G_PRIORITY_HIGH, idle_handle_toggle, this,
-                                idle_destroy_notify);
+    /* We still hold the reference that caused the toggle up, so this
+     * doesn't cause a toggle notification */
+    if (coalesced)
+        g_object_unref(gobj);
 }
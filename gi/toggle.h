@@ -28,6 +28,7 @@
 
 #include <deque>
 #include <mutex>
+#include <unordered_map>
 #include <glib-object.h>
 
 /* Thread-safe queue for enqueueing toggle-up or toggle-down events on GObjects
@@ -42,24 +43,38 @@ public:
 
     typedef void (*Handler)(GObject *, Direction);
 
+    /* Maximum number of toggles handled in one main loop iteration; the
+     * rest are left for the next iteration */
+    static const unsigned MAX_BATCH = 1024;
+
 private:
     struct Item {
         GObject *gobj;
         ToggleQueue::Direction direction;
         unsigned needs_unref : 1;
+        /* Matches the serial in the pending set if the item is still
+         * queued; cancelled items stay in the deque and are skipped */
+        unsigned serial;
+    };
+
+    /* Queued directions of an object, indexed by Direction. 0 means not
+     * queued, otherwise it's the serial of the queued item. */
+    struct Pending {
+        unsigned serial[2];
     };
 
     std::mutex lock;
     std::deque<Item> q;
-    unsigned m_idle_id;
-    Handler m_toggle_handler;
+    std::unordered_map<GObject *, Pending> pending;
+    unsigned m_next_serial = 1;
+    unsigned m_idle_id = 0;
+    Handler m_toggle_handler = nullptr;
 
-    std::deque<Item>::iterator find_operation_locked(GObject  *gobj,
-                                                     Direction direction);
-    bool find_and_erase_operation_locked(GObject *gobj, Direction direction);
+    bool is_pending_locked(const Item& item);
+    bool erase_pending_locked(GObject *gobj, Direction direction);
+    bool pop_locked(Item *item);
 
     static gboolean idle_handle_toggle(void *data);
-    static void idle_destroy_notify(void *data);
 
 public:
     /* These two functions return a pair DOWN, UP signifying whether toggles
@@ -73,7 +88,9 @@ public:
      * is empty. */
     bool handle_toggle(Handler handler);
     
-    /* Queues a toggle to be processed in idle time. */
+    /* Queues a toggle to be processed in idle time. A toggle up for an
+     * object that still has a toggle down queued cancels both, since the
+     * object stays rooted either way. */
     void enqueue(GObject  *gobj,
                  Direction direction,
                  Handler   handler);
@@ -79,6 +79,88 @@ get_signal_info_if_available(GSignalQuery *signal_query)
     return signal_info;
 }
 
+/* Everything closure_marshal() needs to know about the parameters of a
+ * signal, worked out once per signal and shared by all its handlers. The
+ * arrays are indexed by position in the param_values passed to the
+ * marshaller, where 0 is the instance. */
+typedef struct {
+    GSignalQuery signal_query;
+    /* Array lengths, which are passed to JS as part of the array */
+    bool *skip;
+    /* Position of the length of an array parameter, or -1 */
+    int *array_len_indices_for;
+    GITypeInfo **type_info_for;
+} SignalMarshalInfo;
+
+/* signal ID -> SignalMarshalInfo; the entries live as long as the process,
+ * like the signals themselves */
+static GHashTable *signal_marshal_infos;
+
+/* Fills in @signal_query, and returns the marshalling info if the signal is
+ * introspectable. Signals without introspection info get NULL, and aren't
+ * remembered, since the typelib that describes them may be loaded later. */
+static const SignalMarshalInfo *
+signal_marshal_info_for_id(guint         signal_id,
+                           GSignalQuery *signal_query)
+{
+    SignalMarshalInfo *info;
+    GISignalInfo *signal_info;
+    guint i, n_param_values, n_args;
+
+    if (signal_marshal_infos == NULL)
+        signal_marshal_infos = g_hash_table_new(NULL, NULL);
+
+    info = (SignalMarshalInfo *) g_hash_table_lookup(signal_marshal_infos,
+                                                     GUINT_TO_POINTER(signal_id));
+    if (info != NULL) {
+        *signal_query = info->signal_query;
+        return info;
+    }
+
+    g_signal_query(signal_id, signal_query);
+    if (!signal_query->signal_id)
+        return NULL;
+
+    signal_info = get_signal_info_if_available(signal_query);
+    if (!signal_info)
+        return NULL;
+
+    info = g_new0(SignalMarshalInfo, 1);
+    info->signal_query = *signal_query;
+
+    n_param_values = info->signal_query.n_params + 1;
+    info->skip = g_new0(bool, n_param_values);
+    info->array_len_indices_for = g_new(int, n_param_values);
+    for (i = 0; i < n_param_values; i++)
+        info->array_len_indices_for[i] = -1;
+    info->type_info_for = g_new0(GITypeInfo *, n_param_values);
+
+    n_args = g_callable_info_get_n_args(signal_info);
+
+    /* Start at argument 1, skip the instance parameter */
+    for (i = 1; i < n_param_values && i <= n_args; ++i) {
+        GIArgInfo *arg_info;
+        int array_len_pos;
+
+        arg_info = g_callable_info_get_arg(signal_info, i - 1);
+        info->type_info_for[i] = g_arg_info_get_type(arg_info);
+
+        array_len_pos = g_type_info_get_array_length(info->type_info_for[i]);
+        if (array_len_pos != -1 &&
+            guint(array_len_pos) + 1 < n_param_values) {
+            info->skip[array_len_pos + 1] = true;
+            info->array_len_indices_for[i] = array_len_pos + 1;
+        }
+
+        g_base_info_unref((GIBaseInfo *)arg_info);
+    }
+
+    g_base_info_unref((GIBaseInfo *)signal_info);
+
+    g_hash_table_insert(signal_marshal_infos, GUINT_TO_POINTER(signal_id), info);
+    return info;
+}
+
 /*
  * Fill in value_p with a JS array, converted from a C array stored as a pointer
  * in array_value, with its length stored in array_length_value.
@@ -122,10 +204,7 @@ closure_marshal(GClosure        *closure,
     JSObject *obj;
     unsigned i;
     GSignalQuery signal_query = { 0, };
-    GISignalInfo *signal_info;
-    bool *skip;
-    int *array_len_indices_for;
-    GITypeInfo **type_info_for;
+    const SignalMarshalInfo *marshal_info = NULL;
 
     gjs_debug_marshal(GJS_DEBUG_GCLOSURE,
                       "Marshal closure %p",
@@ -172,7 +251,7 @@ closure_marshal(GClosure        *closure,
 
         signal_id = GPOINTER_TO_UINT(marshal_data);
 
-        g_signal_query(signal_id, &signal_query);
+        marshal_info = signal_marshal_info_for_id(signal_id, &signal_query);
 
         if (!signal_query.signal_id) {
             gjs_debug(GJS_DEBUG_GCLOSURE,
@@ -187,39 +266,6 @@ closure_marshal(GClosure        *closure,
         }
     }
 
-    /* Check if any parameters, such as array lengths, need to be eliminated
-     * before we invoke the closure.
-     */
-    skip = g_newa(bool, n_param_values);
-    memset(skip, 0, sizeof (bool) * n_param_values);
-    array_len_indices_for = g_newa(int, n_param_values);
-    for(i = 0; i < n_param_values; i++)
-        array_len_indices_for[i] = -1;
-    type_info_for = g_newa(GITypeInfo *, n_param_values);
-    memset(type_info_for, 0, sizeof (gpointer) * n_param_values);
-
-    signal_info = get_signal_info_if_available(&signal_query);
-    if (signal_info) {
-        /* Start at argument 1, skip the instance parameter */
-        for (i = 1; i < n_param_values; ++i) {
-            GIArgInfo *arg_info;
-            int array_len_pos;
-
-            arg_info = g_callable_info_get_arg(signal_info, i - 1);
-            type_info_for[i] = g_arg_info_get_type(arg_info);
-
-            array_len_pos = g_type_info_get_array_length(type_info_for[i]);
-            if (array_len_pos != -1) {
-                skip[array_len_pos + 1] = true;
-                array_len_indices_for[i] = array_len_pos + 1;
-            }
-
-            g_base_info_unref((GIBaseInfo *)arg_info);
-        }
-
-        g_base_info_unref((GIBaseInfo *)signal_info);
-    }
-
     JS::AutoValueVector argv(context);
     argv.reserve(n_param_values);  /* May end up being less */
     JS::RootedValue argv_to_append(context);
@@ -229,7 +275,7 @@ closure_marshal(GClosure        *closure,
         int array_len_index;
         bool res;
 
-        if (skip[i])
+        if (marshal_info && marshal_info->skip[i])
             continue;
 
         no_copy = false;
@@ -238,15 +284,24 @@ closure_marshal(GClosure        *closure,
             no_copy = (signal_query.param_types[i - 1] & G_SIGNAL_TYPE_STATIC_SCOPE) != 0;
         }
 
-        array_len_index = array_len_indices_for[i];
+        array_len_index = marshal_info ? marshal_info->array_len_indices_for[i] : -1;
         if (array_len_index != -1) {
             const GValue *array_len_gval = &param_values[array_len_index];
             res = gjs_value_from_array_and_length_values(context,
                                                          &argv_to_append,
-                                                         type_info_for[i],
+                                                         marshal_info->type_info_for[i],
                                                          gval, array_len_gval,
                                                          no_copy, &signal_query,
                                                          array_len_index);
+        } else if (marshal_info && marshal_info->type_info_for[i] &&
+                   G_VALUE_TYPE(gval) == G_TYPE_POINTER) {
+            /* Already have the type info that
+             * gjs_value_from_g_value_internal() would look up */
+            GArgument arg;
+            arg.v_pointer = g_value_get_pointer(gval);
+            res = gjs_value_from_g_argument(context, &argv_to_append,
+                                            marshal_info->type_info_for[i],
+                                            &arg, true);
         } else {
             res = gjs_value_from_g_value_internal(context,
                                                   &argv_to_append,
@@ -265,10 +320,6 @@ closure_marshal(GClosure        *closure,
         argv.append(argv_to_append);
     }
 
-    for (i = 1; i < n_param_values; i++)
-        if (type_info_for[i])
-            g_base_info_unref((GIBaseInfo *)type_info_for[i]);
-
     JS::RootedValue rval(context);
     gjs_closure_invoke(closure, argv, &rval);
 
@@ -56,6 +56,8 @@ gjs_srcs =				\
 	gjs/coverage.cpp 		\
 	gjs/engine.cpp			\
 	gjs/engine.h			\
+	gjs/gc-scheduler.cpp		\
+	gjs/gc-scheduler.h		\
 	gjs/global.cpp			\
 	gjs/global.h			\
 	gjs/importer.cpp		\
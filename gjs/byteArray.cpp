@@ -23,20 +23,44 @@
 
 #include <config.h>
 #include <string.h>
+#include <list>
+#include <unordered_map>
 #include <glib.h>
 #include "byteArray.h"
 #include "gi/boxed.h"
 #include "jsapi-class.h"
 #include "jsapi-wrapper.h"
 #include "jsapi-util-args.h"
+#include <jsfriendapi.h>
 #include <girepository.h>
 #include <util/log.h>
 
 typedef struct {
     GByteArray *array;
     GBytes     *bytes;
+    /* false if @bytes came from outside, or has been handed to C code, and
+     * may not be written to */
+    bool        bytes_writable;
 } ByteArrayInstance;
 
+/* Reserved slot holding the ArrayBuffer returned by ByteArray.buffer, if
+ * any; it shares its contents with the GBytes of the ByteArray */
+#define BYTE_ARRAY_SLOT_BUFFER 0
+
+/* SpiderMonkey doesn't tell us when an ArrayBuffer with external contents
+ * dies, so each one holds a reference to the GBytes its contents point
+ * into. The reference is dropped from a weak pointer callback once the
+ * ArrayBuffer has been collected. Weak pointer callbacks belong to one
+ * context, so the buffers are kept per context. */
+typedef struct {
+    JS::Heap<JSObject *> buffer;
+    GBytes *bytes;
+} ExternalBuffer;
+
+typedef std::list<ExternalBuffer> ExternalBufferList;
+
+static std::unordered_map<JSContext *, ExternalBufferList> external_buffers;
+
 extern struct JSClass gjs_byte_array_class;
 GJS_DEFINE_PRIV_FROM_JS(ByteArrayInstance, gjs_byte_array_class)
 
@@ -68,7 +92,8 @@ static const struct JSClassOps gjs_byte_array_class_ops = {
 
 struct JSClass gjs_byte_array_class = {
     "ByteArray",
-    JSCLASS_HAS_PRIVATE | JSCLASS_BACKGROUND_FINALIZE,
+    JSCLASS_HAS_PRIVATE | JSCLASS_HAS_RESERVED_SLOTS(1) |
+    JSCLASS_BACKGROUND_FINALIZE,
     &gjs_byte_array_class_ops
 };
 
@@ -89,12 +114,17 @@ gjs_value_from_gsize(gsize v)
     return JS::NumberValue(v);
 }
 
+/* If there is an ArrayBuffer sharing the GBytes, it keeps its own
+ * reference, so g_bytes_unref_to_array() copies the data and the buffer
+ * stays valid; it just doesn't follow the ByteArray anymore. */
 static void
-byte_array_ensure_array (ByteArrayInstance  *priv)
+byte_array_ensure_array (JSObject           *obj,
+                         ByteArrayInstance  *priv)
 {
     if (priv->bytes) {
         priv->array = g_bytes_unref_to_array(priv->bytes);
         priv->bytes = NULL;
+        JS_SetReservedSlot(obj, BYTE_ARRAY_SLOT_BUFFER, JS::UndefinedValue());
     } else {
         g_assert(priv->array);
     }
@@ -105,12 +135,91 @@ byte_array_ensure_gbytes (ByteArrayInstance  *priv)
 {
     if (priv->array) {
         priv->bytes = g_byte_array_free_to_bytes(priv->array);
+        priv->bytes_writable = true;
         priv->array = NULL;
     } else {
         g_assert(priv->bytes);
     }
 }
 
+/* Hands out a new reference to the contents as a GBytes for C code to keep.
+ * Once ByteArray.buffer exists, JS can write to the ByteArray's own GBytes
+ * through it, so C gets a copy. Otherwise the GBytes is shared and marked
+ * read-only, and ByteArray.buffer copies it before exposing it. */
+static GBytes *
+byte_array_share_gbytes(JSObject          *obj,
+                        ByteArrayInstance *priv)
+{
+    byte_array_ensure_gbytes(priv);
+
+    if (JS_GetReservedSlot(obj, BYTE_ARRAY_SLOT_BUFFER).isObject()) {
+        gsize len;
+        const void *data = g_bytes_get_data(priv->bytes, &len);
+        return g_bytes_new(data, len);
+    }
+
+    priv->bytes_writable = false;
+    return g_bytes_ref(priv->bytes);
+}
+
+static void
+update_external_buffer_weak_pointers(JSContext     *cx,
+                                     JSCompartment *compartment,
+                                     void          *data)
+{
+    auto buffers = static_cast<ExternalBufferList *>(data);
+
+    for (auto iter = buffers->begin(); iter != buffers->end(); ) {
+        JS_UpdateWeakPointerAfterGC(&iter->buffer);
+
+        /* No read barriers are needed if the only thing we are doing with the
+         * pointer is comparing it to nullptr. */
+        if (iter->buffer.unbarrieredGet() == nullptr) {
+            g_bytes_unref(iter->bytes);
+            iter = buffers->erase(iter);
+        } else {
+            iter++;
+        }
+    }
+}
+
+static ExternalBufferList&
+external_buffers_for_context(JSContext *cx)
+{
+    auto iter = external_buffers.find(cx);
+    if (iter != external_buffers.end())
+        return iter->second;
+
+    /* Elements of an unordered_map don't move, so the callback can keep a
+     * pointer to the list */
+    ExternalBufferList& buffers = external_buffers[cx];
+    JS_AddWeakPointerCompartmentCallback(cx,
+                                         update_external_buffer_weak_pointers,
+                                         &buffers);
+    return buffers;
+}
+
+/**
+ * gjs_byte_array_shutdown:
+ * @cx: the JS context that is being destroyed
+ *
+ * Releases the GBytes held for ArrayBuffers returned by ByteArray.buffer in
+ * @cx that are still alive. No JS may run in @cx afterwards.
+ */
+void
+gjs_byte_array_shutdown(JSContext *cx)
+{
+    auto iter = external_buffers.find(cx);
+    if (iter == external_buffers.end())
+        return;
+
+    JS_RemoveWeakPointerCompartmentCallback(cx,
+                                            update_external_buffer_weak_pointers);
+    for (ExternalBuffer& external : iter->second)
+        g_bytes_unref(external.bytes);
+    external_buffers.erase(iter);
+}
+
 static bool
 gjs_value_to_gsize(JSContext         *context,
                    JS::HandleValue    value,
@@ -253,7 +362,7 @@ byte_array_length_setter(JSContext *context,
     if (priv == NULL)
         return true; /* prototype, not instance */
 
-    byte_array_ensure_array(priv);
+    byte_array_ensure_array(to, priv);
 
     if (!gjs_value_to_gsize(context, args[0], &len)) {
         gjs_throw(context,
@@ -265,6 +374,64 @@ byte_array_length_setter(JSContext *context,
     return true;
 }
 
+/* Returns an ArrayBuffer whose contents are the ByteArray's own storage,
+ * so typed array views on it read and write the ByteArray without copying.
+ * Resizing the ByteArray gives it new storage, and the buffer keeps the
+ * old contents. */
+static bool
+byte_array_buffer_getter(JSContext *context,
+                         unsigned   argc,
+                         JS::Value *vp)
+{
+    GJS_GET_PRIV(context, argc, vp, args, to, ByteArrayInstance, priv);
+
+    if (priv == NULL)
+        return true; /* prototype, not an instance. */
+
+    JS::Value buffer_value = JS_GetReservedSlot(to, BYTE_ARRAY_SLOT_BUFFER);
+    if (buffer_value.isObject()) {
+        args.rval().set(buffer_value);
+        return true;
+    }
+
+    byte_array_ensure_gbytes(priv);
+
+    if (!priv->bytes_writable) {
+        /* GBytes from outside may be read-only memory, and GBytes given to C
+         * code must not change under it; take one copy that we are allowed
+         * to write to */
+        GBytes *foreign_bytes = priv->bytes;
+        gsize len;
+        const void *data = g_bytes_get_data(foreign_bytes, &len);
+        priv->bytes = g_bytes_new(data, len);
+        priv->bytes_writable = true;
+        g_bytes_unref(foreign_bytes);
+    }
+
+    gsize len;
+    void *data = (void *) g_bytes_get_data(priv->bytes, &len);
+    JS::RootedObject buffer(context);
+
+    if (len == 0) {
+        buffer = JS_NewArrayBuffer(context, 0);
+        if (!buffer)
+            return false;
+    } else {
+        buffer = JS_NewArrayBufferWithExternalContents(context, len, data);
+        if (!buffer)
+            return false;
+
+        ExternalBufferList& buffers = external_buffers_for_context(context);
+        buffers.emplace_back();
+        buffers.back().buffer = buffer;
+        buffers.back().bytes = g_bytes_ref(priv->bytes);
+    }
+
+    JS_SetReservedSlot(to, BYTE_ARRAY_SLOT_BUFFER, JS::ObjectValue(*buffer));
+    args.rval().setObject(*buffer);
+    return true;
+}
+
 static bool
 byte_array_set_index(JSContext         *context,
                      JS::HandleObject obj,
@@ -279,7 +446,19 @@ byte_array_set_index(JSContext         *context,
         return false;
     }
 
-    byte_array_ensure_array(priv);
+    /* Once ByteArray.buffer has been handed out, writing within bounds
+     * goes to the shared contents instead of making a GByteArray copy */
+    if (priv->bytes != NULL &&
+        JS_GetReservedSlot(obj, BYTE_ARRAY_SLOT_BUFFER).isObject() &&
+        idx < g_bytes_get_size(priv->bytes)) {
+        gsize len;
+        guint8 *data = (guint8 *) g_bytes_get_data(priv->bytes, &len);
+        data[idx] = v;
+        value_p.setUndefined();
+        return result.succeed();
+    }
+
+    byte_array_ensure_array(obj, priv);
 
     /* grow the array if necessary */
     if (idx >= priv->array->len) {
@@ -410,12 +589,14 @@ to_string_func(JSContext *context,
     GJS_GET_PRIV(context, argc, vp, argv, to, ByteArrayInstance, priv);
     GjsAutoJSChar encoding(context);
     bool encoding_is_utf8;
+    guint8 *bytes;
+    gsize len;
     gchar *data;
 
     if (priv == NULL)
         return true; /* prototype, not instance */
 
-    byte_array_ensure_array(priv);
+    gjs_byte_array_peek_data(context, to, &bytes, &len);
 
     if (argc >= 1 && argv[0].isString()) {
         if (!gjs_string_to_utf8(context, argv[0], &encoding))
@@ -430,18 +611,17 @@ to_string_func(JSContext *context,
         encoding_is_utf8 = true;
     }
 
-    if (priv->array->len == 0)
+    if (len == 0)
         /* the internal data pointer could be NULL in this case */
         data = (gchar*)"";
     else
-        data = (gchar*)priv->array->data;
+        data = (gchar*)bytes;
 
     if (encoding_is_utf8) {
         /* optimization, avoids iconv overhead and runs
          * libmozjs hardwired utf8-to-utf16
          */
-        return gjs_string_from_utf8(context, data, priv->array->len,
-                                    argv.rval());
+        return gjs_string_from_utf8(context, data, len, argv.rval());
     } else {
         bool ok = false;
         gsize bytes_written;
@@ -452,7 +632,7 @@ to_string_func(JSContext *context,
 
         error = NULL;
         u16_str = g_convert(data,
-                           priv->array->len,
+                           len,
                            "UTF-16",
                            encoding,
                            NULL, /* bytes read */
@@ -491,15 +671,17 @@ to_gbytes_func(JSContext *context,
     GJS_GET_PRIV(context, argc, vp, rec, to, ByteArrayInstance, priv);
     JSObject *ret_bytes_obj;
     GIBaseInfo *gbytes_info;
+    GBytes *bytes;
 
     if (priv == NULL)
         return true; /* prototype, not instance */
 
-    byte_array_ensure_gbytes(priv);
+    bytes = byte_array_share_gbytes(to, priv);
 
     gbytes_info = g_irepository_find_by_gtype(NULL, G_TYPE_BYTES);
     ret_bytes_obj = gjs_boxed_from_c_struct(context, (GIStructInfo*)gbytes_info,
-                                            priv->bytes, GJS_BOXED_CREATION_NONE);
+                                            bytes, GJS_BOXED_CREATION_NONE);
+    g_bytes_unref(bytes);
 
     rec.rval().setObjectOrNull(ret_bytes_obj);
     return true;
@@ -720,7 +902,9 @@ from_gbytes_func(JSContext *context,
     priv = priv_from_js(context, obj);
     g_assert (priv != NULL);
 
+    /* Shared with the caller, not written to unless copied first */
     priv->bytes = g_bytes_ref(gbytes);
+    priv->bytes_writable = false;
 
     argv.rval().setObject(*obj);
     return true;
@@ -762,9 +946,7 @@ gjs_byte_array_get_bytes (JSContext       *context,
     priv = priv_from_js(context, object);
     g_assert(priv != NULL);
 
-    byte_array_ensure_gbytes(priv);
-
-    return g_bytes_ref (priv->bytes);
+    return byte_array_share_gbytes(object, priv);
 }
 
 GByteArray *
@@ -775,7 +957,7 @@ gjs_byte_array_get_byte_array (JSContext       *context,
     priv = priv_from_js(context, obj);
     g_assert(priv != NULL);
 
-    byte_array_ensure_array(priv);
+    byte_array_ensure_array(obj, priv);
 
     return g_byte_array_ref (priv->array);
 }
@@ -803,6 +985,7 @@ gjs_byte_array_peek_data (JSContext       *context,
 static JSPropertySpec gjs_byte_array_proto_props[] = {
     JS_PSGS("length", byte_array_length_getter, byte_array_length_setter,
             JSPROP_PERMANENT),
+    JS_PSG("buffer", byte_array_buffer_getter, JSPROP_PERMANENT),
     JS_PS_END
 };
 
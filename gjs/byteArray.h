@@ -51,6 +51,8 @@ void        gjs_byte_array_peek_data(JSContext       *context,
                                      guint8         **out_data,
                                      gsize           *out_len);
 
+void gjs_byte_array_shutdown(JSContext *cx);
+
 G_END_DECLS
 
 #endif  /* __GJS_BYTE_ARRAY_H__ */
@@ -35,6 +35,13 @@ static char **coverage_prefixes = NULL;
 static char *coverage_output_path = NULL;
 static char *command = NULL;
 static gboolean print_version = false;
+static int gc_nursery_size_mb = 0;
+static int gc_slice_budget_ms = 0;
+static int gc_low_frequency_heap_growth = 0;
+static int gc_high_frequency_heap_growth_min = 0;
+static int gc_high_frequency_heap_growth_max = 0;
+static int gc_malloc_trigger_mb = 0;
+static int gc_native_trigger_mb = 0;
 
 static GOptionEntry entries[] = {
     { "version", 0, 0, G_OPTION_ARG_NONE, &print_version, "Print GJS version and exit" },
@@ -42,6 +49,13 @@ static GOptionEntry entries[] = {
     { "coverage-prefix", 'C', 0, G_OPTION_ARG_STRING_ARRAY, &coverage_prefixes, "Add the prefix PREFIX to the list of files to generate coverage info for", "PREFIX" },
     { "coverage-output", 0, 0, G_OPTION_ARG_STRING, &coverage_output_path, "Write coverage output to a directory DIR. This option is mandatory when using --coverage-path", "DIR", },
     { "include-path", 'I', 0, G_OPTION_ARG_STRING_ARRAY, &include_path, "Add the directory DIR to the list of directories to search for js files.", "DIR" },
+    { "gc-nursery-size", 0, 0, G_OPTION_ARG_INT, &gc_nursery_size_mb, "Size of the GC young generation in MiB", "MB" },
+    { "gc-slice-budget", 0, 0, G_OPTION_ARG_INT, &gc_slice_budget_ms, "Time to spend in each incremental GC slice", "MS" },
+    { "gc-low-frequency-heap-growth", 0, 0, G_OPTION_ARG_INT, &gc_low_frequency_heap_growth, "Heap growth before the next GC, when collections are infrequent", "PERCENT" },
+    { "gc-high-frequency-heap-growth-min", 0, 0, G_OPTION_ARG_INT, &gc_high_frequency_heap_growth_min, "Heap growth before the next GC for large heaps, when collections are frequent", "PERCENT" },
+    { "gc-high-frequency-heap-growth-max", 0, 0, G_OPTION_ARG_INT, &gc_high_frequency_heap_growth_max, "Heap growth before the next GC for small heaps, when collections are frequent", "PERCENT" },
+    { "gc-malloc-trigger", 0, 0, G_OPTION_ARG_INT, &gc_malloc_trigger_mb, "Memory the JS engine may malloc before triggering a GC", "MB" },
+    { "gc-native-trigger", 0, 0, G_OPTION_ARG_INT, &gc_native_trigger_mb, "Memory of wrapped GObjects and structs to create before triggering a GC", "MB" },
     { NULL }
 };
 
@@ -210,6 +224,16 @@ main(int argc, char **argv)
 
     g_option_context_free (context);
 
+    if (gc_nursery_size_mb < 0 || gc_slice_budget_ms < 0 ||
+        gc_low_frequency_heap_growth < 0 ||
+        gc_high_frequency_heap_growth_min < 0 ||
+        gc_high_frequency_heap_growth_max < 0 ||
+        gc_malloc_trigger_mb < 0 || gc_native_trigger_mb < 0)
+        g_error("GC tuning options cannot be negative");
+    if (gc_nursery_size_mb >= 4096 || gc_malloc_trigger_mb >= 4096 ||
+        gc_native_trigger_mb >= 4096)
+        g_error("GC sizes must be less than 4096 MB");
+
     if (print_version) {
         g_print("%s\n", PACKAGE_STRING);
         exit(0);
@@ -243,6 +267,13 @@ main(int argc, char **argv)
     js_context = (GjsContext*) g_object_new(GJS_TYPE_CONTEXT,
                                             "search-path", include_path,
                                             "program-name", program_name,
+                                            "gc-nursery-size", unsigned(gc_nursery_size_mb) << 20,
+                                            "gc-slice-budget", unsigned(gc_slice_budget_ms),
+                                            "gc-low-frequency-heap-growth", unsigned(gc_low_frequency_heap_growth),
+                                            "gc-high-frequency-heap-growth-min", unsigned(gc_high_frequency_heap_growth_min),
+                                            "gc-high-frequency-heap-growth-max", unsigned(gc_high_frequency_heap_growth_max),
+                                            "gc-malloc-trigger", unsigned(gc_malloc_trigger_mb) << 20,
+                                            "gc-native-trigger", unsigned(gc_native_trigger_mb) << 20,
                                             NULL);
 
     env_coverage_output_path = g_getenv("GJS_COVERAGE_OUTPUT");
@@ -26,6 +26,9 @@
 
 #include <inttypes.h>
 
+#include <array>
+#include <unordered_map>
+
 #include "context.h"
 #include "jsapi-util.h"
 #include "jsapi-wrapper.h"
@@ -57,8 +60,57 @@ bool _gjs_context_run_jobs(GjsContext *gjs_context);
 void _gjs_context_unregister_unhandled_promise_rejection(GjsContext *gjs_context,
                                                          uint64_t    promise_id);
 
+/* Optimizations on hot paths that can be turned off for benchmarking with a
+ * GJS_DISABLE_* environment variable. The environment is read when the
+ * context is created, not every time the optimization is used. */
+typedef enum {
+    GJS_OPTIMIZATION_PROPERTY_ACCESSORS,  /* GJS_DISABLE_PROPERTY_ACCESSORS */
+    GJS_OPTIMIZATION_ENUM_CACHE,          /* GJS_DISABLE_ENUM_CACHE */
+    GJS_OPTIMIZATION_CLASS_CACHE,         /* GJS_DISABLE_CLASS_CACHE */
+    GJS_OPTIMIZATION_STRING_FAST_PATHS,   /* GJS_DISABLE_STRING_FAST_PATHS */
+    GJS_OPTIMIZATION_STRING_CACHE,        /* GJS_DISABLE_STRING_CACHE */
+    GJS_OPTIMIZATION_METHOD_INDEX,        /* GJS_DISABLE_METHOD_INDEX */
+    GJS_OPTIMIZATION_MODULE_CACHE,        /* GJS_DISABLE_MODULE_CACHE */
+    GJS_OPTIMIZATION_NURSERY_BOXED,       /* GJS_DISABLE_NURSERY_BOXED */
+    GJS_OPTIMIZATION_SCALAR_INVOKERS,     /* GJS_DISABLE_SCALAR_INVOKERS */
+    GJS_OPTIMIZATION_LAST
+} GjsOptimization;
+
+bool _gjs_context_optimization_enabled(JSContext      *cx,
+                                       GjsOptimization optimization);
+
+/* Whether GJS_PREFETCH_IMPORTS was set when the context was created; see
+ * gjs/module.cpp */
+bool _gjs_context_prefetch_imports_enabled(JSContext *cx);
+
 G_END_DECLS
 
+class GjsGCScheduler;
+GjsGCScheduler *_gjs_context_get_gc_scheduler(GjsContext *js_context);
+
+/* Constructor and prototype of the JS class wrapping a GObject type, so that
+ * wrapping an object needn't look them up through its namespace object */
+struct GjsClassCacheEntry {
+    JS::Heap<JSObject *> constructor;
+    JS::Heap<JSObject *> prototype;
+};
+typedef std::unordered_map<GType, GjsClassCacheEntry> GjsClassCache;
+
+/* NULL if the cache is disabled or the context has started tearing down */
+GjsClassCache *_gjs_context_get_class_cache(GjsContext *js_context);
+
+/* A C string borrowed from C code and the atom last made from it, see
+ * gjs_string_from_borrowed_utf8() */
+struct GjsBorrowedString {
+    const char *utf8;
+    size_t length;
+    JS::Heap<JSString *> atom;
+};
+typedef std::array<GjsBorrowedString, 512> GjsBorrowedStringCache;
+
+/* NULL if the cache is disabled or the context has started tearing down */
+GjsBorrowedStringCache *_gjs_context_get_borrowed_string_cache(GjsContext *js_context);
+
 void _gjs_context_register_unhandled_promise_rejection(GjsContext   *gjs_context,
                                                        uint64_t      promise_id,
                                                        GjsAutoChar&& stack);
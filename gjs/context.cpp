@@ -30,13 +30,18 @@
 
 #include "context-private.h"
 #include "engine.h"
+#include "gc-scheduler.h"
 #include "global.h"
 #include "importer.h"
 #include "jsapi-private.h"
 #include "jsapi-util.h"
 #include "jsapi-wrapper.h"
+#include "mem.h"
+#include "module.h"
 #include "native.h"
 #include "byteArray.h"
+#include "gi/function.h"
+#include "gi/ns.h"
 #include "gi/object.h"
 #include "gi/repo.h"
 
@@ -85,12 +90,22 @@ struct _GjsContext {
     uint8_t exit_code;
 
     guint    auto_gc_id;
+    GjsGCScheduler *gc_scheduler;
+    GjsEngineTuning tuning;
+    unsigned gc_native_trigger;
+    bool optimizations[GJS_OPTIMIZATION_LAST];
+    bool prefetch_imports;
 
     std::array<JS::PersistentRootedId*, GJS_STRING_LAST> const_strings;
 
+    GjsClassCache *class_cache;
+    GjsBorrowedStringCache *borrowed_strings;
+
     JS::PersistentRooted<JobQueue> *job_queue;
     unsigned idle_drain_handler;
     bool draining_job_queue;
+    unsigned job_drain_budget_ms;
+    int job_drain_priority;
 
     std::unordered_map<uint64_t, GjsAutoChar> unhandled_rejection_stacks;
 };
@@ -118,6 +133,15 @@ enum {
     PROP_0,
     PROP_SEARCH_PATH,
     PROP_PROGRAM_NAME,
+    PROP_GC_NURSERY_SIZE,
+    PROP_GC_SLICE_BUDGET,
+    PROP_GC_LOW_FREQUENCY_HEAP_GROWTH,
+    PROP_GC_HIGH_FREQUENCY_HEAP_GROWTH_MIN,
+    PROP_GC_HIGH_FREQUENCY_HEAP_GROWTH_MAX,
+    PROP_GC_MALLOC_TRIGGER,
+    PROP_GC_NATIVE_TRIGGER,
+    PROP_JOB_DRAIN_BUDGET,
+    PROP_JOB_DRAIN_PRIORITY,
 };
 
 static GMutex contexts_lock;
@@ -127,6 +151,23 @@ static void
 gjs_context_init(GjsContext *js_context)
 {
     gjs_context_make_current(js_context);
+    js_context->job_drain_priority = G_PRIORITY_DEFAULT_IDLE;
+}
+
+/* The GC tuning properties are all construct-only unsigned integers, where
+ * zero keeps the engine's default */
+static void
+install_gc_tuning_property(GObjectClass *object_class,
+                           unsigned      prop_id,
+                           const char   *name,
+                           const char   *nick,
+                           const char   *blurb,
+                           unsigned      maximum)
+{
+    GParamSpec *pspec = g_param_spec_uint(name, nick, blurb, 0, maximum, 0,
+        GParamFlags(G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY |
+                    G_PARAM_STATIC_STRINGS));
+    g_object_class_install_property(object_class, prop_id, pspec);
 }
 
 static void
@@ -164,6 +205,56 @@ gjs_context_class_init(GjsContextClass *klass)
                                     pspec);
     g_param_spec_unref(pspec);
 
+    install_gc_tuning_property(object_class, PROP_GC_NURSERY_SIZE,
+        "gc-nursery-size", "GC nursery size",
+        "Bytes for the young generation; less than 1 MiB disables it",
+        G_MAXUINT);
+    install_gc_tuning_property(object_class, PROP_GC_SLICE_BUDGET,
+        "gc-slice-budget", "GC slice budget",
+        "Milliseconds to spend in each incremental GC slice", 1000);
+    install_gc_tuning_property(object_class, PROP_GC_LOW_FREQUENCY_HEAP_GROWTH,
+        "gc-low-frequency-heap-growth", "Low-frequency heap growth",
+        "Percentage of the live heap at which to trigger the next GC, when "
+        "collections are infrequent", 10000);
+    install_gc_tuning_property(object_class,
+        PROP_GC_HIGH_FREQUENCY_HEAP_GROWTH_MIN,
+        "gc-high-frequency-heap-growth-min", "High-frequency heap growth min",
+        "Percentage of a large live heap at which to trigger the next GC, "
+        "when collections are frequent", 10000);
+    install_gc_tuning_property(object_class,
+        PROP_GC_HIGH_FREQUENCY_HEAP_GROWTH_MAX,
+        "gc-high-frequency-heap-growth-max", "High-frequency heap growth max",
+        "Percentage of a small live heap at which to trigger the next GC, "
+        "when collections are frequent", 10000);
+    install_gc_tuning_property(object_class, PROP_GC_MALLOC_TRIGGER,
+        "gc-malloc-trigger", "GC malloc trigger",
+        "Bytes that the JS engine may malloc before it triggers a GC",
+        G_MAXUINT);
+    install_gc_tuning_property(object_class, PROP_GC_NATIVE_TRIGGER,
+        "gc-native-trigger", "GC native trigger",
+        "Bytes of wrapped GObjects and structs to create before triggering "
+        "a GC", G_MAXUINT);
+
+    pspec = g_param_spec_uint("job-drain-budget",
+                              "Job drain budget",
+                              "Milliseconds to spend running promise jobs "
+                              "before returning to the main loop; 0 runs "
+                              "them all at once",
+                              0, G_MAXUINT, 0,
+                              GParamFlags(G_PARAM_READWRITE |
+                                          G_PARAM_STATIC_STRINGS));
+    g_object_class_install_property(object_class, PROP_JOB_DRAIN_BUDGET,
+                                    pspec);
+
+    pspec = g_param_spec_int("job-drain-priority",
+                             "Job drain priority",
+                             "Main loop priority at which promise jobs run",
+                             G_MININT, G_MAXINT, G_PRIORITY_DEFAULT_IDLE,
+                             GParamFlags(G_PARAM_READWRITE |
+                                         G_PARAM_STATIC_STRINGS));
+    g_object_class_install_property(object_class, PROP_JOB_DRAIN_PRIORITY,
+                                    pspec);
+
     /* For GjsPrivate */
     {
 #ifdef G_OS_WIN32
@@ -190,6 +281,23 @@ gjs_context_tracer(JSTracer *trc, void *data)
 {
     GjsContext *gjs_context = reinterpret_cast<GjsContext *>(data);
     JS::TraceEdge<JSObject *>(trc, &gjs_context->global, "GJS global object");
+
+    if (gjs_context->class_cache) {
+        for (auto& kv : *gjs_context->class_cache) {
+            JS::TraceEdge<JSObject *>(trc, &kv.second.constructor,
+                                      "GJS cached class constructor");
+            JS::TraceEdge<JSObject *>(trc, &kv.second.prototype,
+                                      "GJS cached class prototype");
+        }
+    }
+
+    if (gjs_context->borrowed_strings) {
+        for (auto& entry : *gjs_context->borrowed_strings) {
+            if (entry.atom)
+                JS::TraceEdge<JSString *>(trc, &entry.atom,
+                                          "GJS borrowed string atom");
+        }
+    }
 }
 
 static void
@@ -227,6 +335,9 @@ gjs_context_dispose(GObject *object)
 
         JS_BeginRequest(js_context->context);
 
+        gjs_module_cancel_prefetches(js_context->context);
+        gjs_ns_snapshot_shutdown(js_context->context);
+
         /* Do a full GC here before tearing down, since once we do
          * that we may not have the JS_GetPrivate() to access the
          * context
@@ -241,12 +352,22 @@ gjs_context_dispose(GObject *object)
          * still exist, but point to NULL.
          */
         gjs_object_prepare_shutdown(js_context->context);
+        gjs_byte_array_shutdown(js_context->context);
+        gjs_function_shutdown(js_context->context);
 
         if (js_context->auto_gc_id > 0) {
             g_source_remove (js_context->auto_gc_id);
             js_context->auto_gc_id = 0;
         }
 
+        delete js_context->gc_scheduler;
+        js_context->gc_scheduler = nullptr;
+
+        delete js_context->class_cache;
+        js_context->class_cache = nullptr;
+        delete js_context->borrowed_strings;
+        js_context->borrowed_strings = nullptr;
+
         JS_RemoveExtraGCRootsTracer(js_context->context, gjs_context_tracer,
                                     js_context);
         js_context->global = NULL;
@@ -302,10 +423,30 @@ gjs_context_constructed(GObject *object)
 
     js_context->owner_thread = g_thread_self();
 
-    JSContext *cx = gjs_create_js_context(js_context);
+    static const char *optimization_switches[GJS_OPTIMIZATION_LAST] = {
+        "GJS_DISABLE_PROPERTY_ACCESSORS",
+        "GJS_DISABLE_ENUM_CACHE",
+        "GJS_DISABLE_CLASS_CACHE",
+        "GJS_DISABLE_STRING_FAST_PATHS",
+        "GJS_DISABLE_STRING_CACHE",
+        "GJS_DISABLE_METHOD_INDEX",
+        "GJS_DISABLE_MODULE_CACHE",
+        "GJS_DISABLE_NURSERY_BOXED",
+        "GJS_DISABLE_SCALAR_INVOKERS",
+    };
+    for (i = 0; i < GJS_OPTIMIZATION_LAST; i++)
+        js_context->optimizations[i] = !g_getenv(optimization_switches[i]);
+    js_context->prefetch_imports = g_getenv("GJS_PREFETCH_IMPORTS") != NULL;
+
+    JSContext *cx = gjs_create_js_context(js_context, js_context->tuning);
     if (!cx)
         g_error("Failed to create javascript context");
     js_context->context = cx;
+    js_context->gc_scheduler = new GjsGCScheduler(cx);
+    if (js_context->tuning.slice_budget_ms)
+        js_context->gc_scheduler->set_slice_budget(js_context->tuning.slice_budget_ms);
+    if (js_context->gc_native_trigger)
+        js_context->gc_scheduler->set_native_trigger(js_context->gc_native_trigger);
 
     new (&js_context->unhandled_rejection_stacks) std::unordered_map<uint64_t, GjsAutoChar>;
     new (&js_context->const_strings) std::array<JS::PersistentRootedId*, GJS_STRING_LAST>;
@@ -314,6 +455,11 @@ gjs_context_constructed(GObject *object)
             gjs_intern_string_to_id(cx, const_strings[i]));
     }
 
+    if (js_context->optimizations[GJS_OPTIMIZATION_CLASS_CACHE])
+        js_context->class_cache = new GjsClassCache();
+    if (js_context->optimizations[GJS_OPTIMIZATION_STRING_CACHE])
+        js_context->borrowed_strings = new GjsBorrowedStringCache();
+
     js_context->job_queue = new JS::PersistentRooted<JobQueue>(cx);
     if (!js_context->job_queue)
         g_error("Failed to initialize promise job queue");
@@ -368,6 +514,35 @@ gjs_context_get_property (GObject     *object,
     case PROP_PROGRAM_NAME:
         g_value_set_string(value, js_context->program_name);
         break;
+    case PROP_GC_NURSERY_SIZE:
+        g_value_set_uint(value, js_context->tuning.nursery_bytes);
+        break;
+    case PROP_GC_SLICE_BUDGET:
+        g_value_set_uint(value, js_context->tuning.slice_budget_ms);
+        break;
+    case PROP_GC_LOW_FREQUENCY_HEAP_GROWTH:
+        g_value_set_uint(value, js_context->tuning.low_frequency_heap_growth);
+        break;
+    case PROP_GC_HIGH_FREQUENCY_HEAP_GROWTH_MIN:
+        g_value_set_uint(value,
+                         js_context->tuning.high_frequency_heap_growth_min);
+        break;
+    case PROP_GC_HIGH_FREQUENCY_HEAP_GROWTH_MAX:
+        g_value_set_uint(value,
+                         js_context->tuning.high_frequency_heap_growth_max);
+        break;
+    case PROP_GC_MALLOC_TRIGGER:
+        g_value_set_uint(value, js_context->tuning.malloc_trigger_bytes);
+        break;
+    case PROP_GC_NATIVE_TRIGGER:
+        g_value_set_uint(value, js_context->gc_native_trigger);
+        break;
+    case PROP_JOB_DRAIN_BUDGET:
+        g_value_set_uint(value, js_context->job_drain_budget_ms);
+        break;
+    case PROP_JOB_DRAIN_PRIORITY:
+        g_value_set_int(value, js_context->job_drain_priority);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
         break;
@@ -391,6 +566,36 @@ gjs_context_set_property (GObject      *object,
     case PROP_PROGRAM_NAME:
         js_context->program_name = g_value_dup_string(value);
         break;
+    case PROP_GC_NURSERY_SIZE:
+        js_context->tuning.nursery_bytes = g_value_get_uint(value);
+        break;
+    case PROP_GC_SLICE_BUDGET:
+        js_context->tuning.slice_budget_ms = g_value_get_uint(value);
+        break;
+    case PROP_GC_LOW_FREQUENCY_HEAP_GROWTH:
+        js_context->tuning.low_frequency_heap_growth = g_value_get_uint(value);
+        break;
+    case PROP_GC_HIGH_FREQUENCY_HEAP_GROWTH_MIN:
+        js_context->tuning.high_frequency_heap_growth_min =
+            g_value_get_uint(value);
+        break;
+    case PROP_GC_HIGH_FREQUENCY_HEAP_GROWTH_MAX:
+        js_context->tuning.high_frequency_heap_growth_max =
+            g_value_get_uint(value);
+        break;
+    case PROP_GC_MALLOC_TRIGGER:
+        js_context->tuning.malloc_trigger_bytes = g_value_get_uint(value);
+        break;
+    case PROP_GC_NATIVE_TRIGGER:
+        js_context->gc_native_trigger = g_value_get_uint(value);
+        break;
+    case PROP_JOB_DRAIN_BUDGET:
+        js_context->job_drain_budget_ms = g_value_get_uint(value);
+        break;
+    case PROP_JOB_DRAIN_PRIORITY:
+        /* Takes effect the next time that the queue fills up */
+        js_context->job_drain_priority = g_value_get_int(value);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
         break;
@@ -427,6 +632,41 @@ trigger_gc_if_needed (gpointer user_data)
     return G_SOURCE_REMOVE;
 }
 
+GjsGCScheduler *
+_gjs_context_get_gc_scheduler(GjsContext *js_context)
+{
+    return js_context->gc_scheduler;
+}
+
+GjsClassCache *
+_gjs_context_get_class_cache(GjsContext *js_context)
+{
+    return js_context->class_cache;
+}
+
+GjsBorrowedStringCache *
+_gjs_context_get_borrowed_string_cache(GjsContext *js_context)
+{
+    return js_context->borrowed_strings;
+}
+
+bool
+_gjs_context_optimization_enabled(JSContext      *cx,
+                                  GjsOptimization optimization)
+{
+    auto js_context = static_cast<GjsContext *>(JS_GetContextPrivate(cx));
+    if (!js_context)
+        return true;
+    return js_context->optimizations[optimization];
+}
+
+bool
+_gjs_context_prefetch_imports_enabled(JSContext *cx)
+{
+    auto js_context = static_cast<GjsContext *>(JS_GetContextPrivate(cx));
+    return js_context && js_context->prefetch_imports;
+}
+
 void
 _gjs_context_schedule_gc_if_needed (GjsContext *js_context)
 {
@@ -483,15 +723,31 @@ _gjs_context_is_sweeping(JSContext *cx)
     return js_context->in_gc_sweep;
 }
 
+static bool run_jobs(GjsContext *gjs_context, int64_t deadline,
+                     bool *yielded_out = nullptr);
+
 static gboolean
 drain_job_queue_idle_handler(void *data)
 {
     auto gjs_context = static_cast<GjsContext *>(data);
-    _gjs_context_run_jobs(gjs_context);
+    int64_t deadline = 0;
+    if (gjs_context->job_drain_budget_ms)
+        deadline = g_get_monotonic_time() +
+            gjs_context->job_drain_budget_ms * G_GINT64_CONSTANT(1000);
+
+    bool yielded;
+    run_jobs(gjs_context, deadline, &yielded);
     /* Uncatchable exceptions are swallowed here - no way to get a handle on
      * the main loop to exit it from this idle handler */
-    g_assert(((void) "_gjs_context_run_jobs() should have emptied queue",
-              gjs_context->idle_drain_handler == 0));
+
+    /* Out of time; let the main loop handle other sources, and continue
+     * with the rest of the queue when it gets back to us */
+    if (yielded && !gjs_context->should_exit)
+        return G_SOURCE_CONTINUE;
+
+    /* Otherwise the queue is empty, or a job is running a nested main loop
+     * and the drain that called it will run the rest of the queue */
+    gjs_context->idle_drain_handler = 0;
     return G_SOURCE_REMOVE;
 }
 
@@ -503,36 +759,36 @@ _gjs_context_enqueue_job(GjsContext      *gjs_context,
     if (gjs_context->idle_drain_handler)
         g_assert(gjs_context->job_queue->length() > 0);
     else
-        g_assert(gjs_context->job_queue->length() == 0);
+        g_assert(gjs_context->job_queue->length() == 0 ||
+                 gjs_context->draining_job_queue);
 
     if (!gjs_context->job_queue->append(job))
         return false;
     if (!gjs_context->idle_drain_handler)
         gjs_context->idle_drain_handler =
-            g_idle_add(drain_job_queue_idle_handler, gjs_context);
+            g_idle_add_full(gjs_context->job_drain_priority,
+                            drain_job_queue_idle_handler, gjs_context, NULL);
 
     return true;
 }
 
-/**
- * _gjs_context_run_jobs:
- * @gjs_context: The #GjsContext instance
- *
- * Drains the queue of promise callbacks that the JS engine has reported
- * finished, calling each one and logging any exceptions that it throws.
- *
- * Adapted from js::RunJobs() in SpiderMonkey's default job queue
- * implementation.
- *
- * Returns: false if one of the jobs threw an uncatchable exception;
- * otherwise true.
- */
-bool
-_gjs_context_run_jobs(GjsContext *gjs_context)
+/* Runs jobs until the queue is empty, or if @deadline is not zero, until
+ * the first job that ends after that monotonic time. In that case the rest
+ * of the queue is left for the idle handler, and *@yielded_out is set to
+ * true. Nothing runs if the queue is already being drained further up the
+ * stack. */
+static bool
+run_jobs(GjsContext *gjs_context,
+         int64_t     deadline,
+         bool       *yielded_out)
 {
     bool retval = true;
+    bool yielded = false;
     g_assert(gjs_context->job_queue);
 
+    if (yielded_out)
+        *yielded_out = false;
+
     if (gjs_context->draining_job_queue || gjs_context->should_exit)
         return true;
 
@@ -540,6 +796,7 @@ _gjs_context_run_jobs(GjsContext *gjs_context)
     JSAutoRequest ar(cx);
 
     gjs_context->draining_job_queue = true;  /* Ignore reentrant calls */
+    int64_t start = g_get_monotonic_time();
 
     JS::RootedObject job(cx);
     JS::HandleValueArray args(JS::HandleValueArray::empty());
@@ -548,11 +805,18 @@ _gjs_context_run_jobs(GjsContext *gjs_context)
     /* Execute jobs in a loop until we've reached the end of the queue.
      * Since executing a job can trigger enqueueing of additional jobs,
      * it's crucial to recheck the queue length during each iteration. */
-    for (size_t ix = 0; ix < gjs_context->job_queue->length(); ix++) {
+    size_t ix;
+    for (ix = 0; ix < gjs_context->job_queue->length(); ix++) {
         /* A previous job might have set this flag. e.g., System.exit(). */
         if (gjs_context->should_exit)
             break;
 
+        /* Always run at least one job, so that the queue makes progress */
+        if (deadline && ix > 0 && g_get_monotonic_time() >= deadline) {
+            yielded = true;
+            break;
+        }
+
         job = gjs_context->job_queue->get()[ix];
 
         /* It's possible that job draining was interrupted prematurely,
@@ -563,6 +827,7 @@ _gjs_context_run_jobs(GjsContext *gjs_context)
             continue;
 
         gjs_context->job_queue->get()[ix] = nullptr;
+        GJS_INC_STAT(job_queue_run);
         {
             JSAutoCompartment ac(cx, job);
             if (!JS::Call(cx, JS::UndefinedHandleValue, job, args, &rval)) {
@@ -580,7 +845,28 @@ _gjs_context_run_jobs(GjsContext *gjs_context)
         }
     }
 
+    GJS_INC_STAT(job_queue_drains);
+    GJS_MAX_STAT(job_queue_max_drain_us, g_get_monotonic_time() - start);
+
     gjs_context->draining_job_queue = false;
+    if (yielded) {
+        /* Drop the entries of the jobs that have run, keeping the idle
+         * handler for the rest */
+        JobQueue& queue = gjs_context->job_queue->get();
+        queue.erase(queue.begin(), queue.begin() + ix);
+        GJS_INC_STAT(job_queue_yields);
+
+        /* A nested main loop may have dropped the idle handler */
+        if (!gjs_context->idle_drain_handler)
+            gjs_context->idle_drain_handler =
+                g_idle_add_full(gjs_context->job_drain_priority,
+                                drain_job_queue_idle_handler, gjs_context,
+                                NULL);
+        if (yielded_out)
+            *yielded_out = true;
+        return retval;
+    }
+
     gjs_context->job_queue->clear();
     if (gjs_context->idle_drain_handler) {
         g_source_remove(gjs_context->idle_drain_handler);
@@ -589,6 +875,27 @@ _gjs_context_run_jobs(GjsContext *gjs_context)
     return retval;
 }
 
+/**
+ * _gjs_context_run_jobs:
+ * @gjs_context: The #GjsContext instance
+ *
+ * Drains the queue of promise callbacks that the JS engine has reported
+ * finished, calling each one and logging any exceptions that it throws.
+ * Unlike the idle handler, this ignores the job-drain-budget property and
+ * always empties the queue.
+ *
+ * Adapted from js::RunJobs() in SpiderMonkey's default job queue
+ * implementation.
+ *
+ * Returns: false if one of the jobs threw an uncatchable exception;
+ * otherwise true.
+ */
+bool
+_gjs_context_run_jobs(GjsContext *gjs_context)
+{
+    return run_jobs(gjs_context, 0);
+}
+
 void
 _gjs_context_register_unhandled_promise_rejection(GjsContext   *gjs_context,
                                                   uint64_t      id,
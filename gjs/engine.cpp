@@ -290,10 +290,13 @@ static GjsInit gjs_is_inited;
 #endif
 
 JSContext *
-gjs_create_js_context(GjsContext *js_context)
+gjs_create_js_context(GjsContext            *js_context,
+                      const GjsEngineTuning& tuning)
 {
     g_assert(gjs_is_inited);
-    JSContext *cx = JS_NewContext(32 * 1024 * 1024 /* max bytes */);
+    JSContext *cx = JS_NewContext(32 * 1024 * 1024 /* max bytes */,
+                                  tuning.nursery_bytes ? tuning.nursery_bytes :
+                                  JS::DefaultNurseryBytes);
     if (!cx)
         return nullptr;
 
@@ -302,16 +305,26 @@ gjs_create_js_context(GjsContext *js_context)
 
     // commented are defaults in moz-24
     JS_SetNativeStackQuota(cx, 1024 * 1024);
-    JS_SetGCParameter(cx, JSGC_MAX_MALLOC_BYTES, 128 * 1024 * 1024);
+    JS_SetGCParameter(cx, JSGC_MAX_MALLOC_BYTES,
+                      tuning.malloc_trigger_bytes ? tuning.malloc_trigger_bytes :
+                      128 * 1024 * 1024);
     JS_SetGCParameter(cx, JSGC_MAX_BYTES, -1);
     JS_SetGCParameter(cx, JSGC_MODE, JSGC_MODE_INCREMENTAL);
-    JS_SetGCParameter(cx, JSGC_SLICE_TIME_BUDGET, 10); /* ms */
+    JS_SetGCParameter(cx, JSGC_SLICE_TIME_BUDGET,
+                      tuning.slice_budget_ms ? tuning.slice_budget_ms : 10); /* ms */
     // JS_SetGCParameter(cx, JSGC_HIGH_FREQUENCY_TIME_LIMIT, 1000); /* ms */
     JS_SetGCParameter(cx, JSGC_DYNAMIC_MARK_SLICE, true);
     JS_SetGCParameter(cx, JSGC_DYNAMIC_HEAP_GROWTH, true);
-    // JS_SetGCParameter(cx, JSGC_LOW_FREQUENCY_HEAP_GROWTH, 150);
-    // JS_SetGCParameter(cx, JSGC_HIGH_FREQUENCY_HEAP_GROWTH_MIN, 150);
-    // JS_SetGCParameter(cx, JSGC_HIGH_FREQUENCY_HEAP_GROWTH_MAX, 300);
+    /* SpiderMonkey rejects growth factors that would shrink the heap */
+    if (tuning.low_frequency_heap_growth >= 100)
+        JS_SetGCParameter(cx, JSGC_LOW_FREQUENCY_HEAP_GROWTH,
+                          tuning.low_frequency_heap_growth);
+    if (tuning.high_frequency_heap_growth_min >= 100)
+        JS_SetGCParameter(cx, JSGC_HIGH_FREQUENCY_HEAP_GROWTH_MIN,
+                          tuning.high_frequency_heap_growth_min);
+    if (tuning.high_frequency_heap_growth_max >= 100)
+        JS_SetGCParameter(cx, JSGC_HIGH_FREQUENCY_HEAP_GROWTH_MAX,
+                          tuning.high_frequency_heap_growth_max);
     // JS_SetGCParameter(cx, JSGC_HIGH_FREQUENCY_LOW_LIMIT, 100);
     // JS_SetGCParameter(cx, JSGC_HIGH_FREQUENCY_HIGH_LIMIT, 500);
     // JS_SetGCParameter(cx, JSGC_ALLOCATION_THRESHOLD, 30);
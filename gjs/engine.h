@@ -27,6 +27,17 @@
 #include "context.h"
 #include "jsapi-wrapper.h"
 
-JSContext *gjs_create_js_context(GjsContext *js_context);
+/* Heap and GC parameters for a new JSContext; zero keeps the default */
+struct GjsEngineTuning {
+    unsigned nursery_bytes;
+    unsigned slice_budget_ms;
+    unsigned low_frequency_heap_growth;  /* percent */
+    unsigned high_frequency_heap_growth_min;  /* percent */
+    unsigned high_frequency_heap_growth_max;  /* percent */
+    unsigned malloc_trigger_bytes;
+};
+
+JSContext *gjs_create_js_context(GjsContext            *js_context,
+                                 const GjsEngineTuning& tuning);
 
 #endif  /* GJS_ENGINE_H */
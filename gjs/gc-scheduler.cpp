@@ -0,0 +1,358 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2026  The GJS authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#include <glib-unix.h>
+#endif
+
+#include "context-private.h"
+#include "gc-scheduler.h"
+#include "util/log.h"
+
+/* Don't react to memory pressure more often than this */
+#define PRESSURE_GC_INTERVAL G_USEC_PER_SEC
+
+static unsigned
+env_to_uint(const char *name,
+            unsigned    default_value)
+{
+    const char *value = g_getenv(name);
+    if (!value)
+        return default_value;
+    return unsigned(g_ascii_strtoull(value, NULL, 10));
+}
+
+GjsGCScheduler::GjsGCScheduler(JSContext *cx) :
+    m_cx(cx),
+    m_native_bytes(0),
+    m_slice_idle_id(0),
+    m_slice_start(0),
+    m_last_pressure_gc(0)
+{
+    m_slice_budget_ms = env_to_uint("GJS_GC_SLICE_BUDGET",
+                                    DEFAULT_SLICE_BUDGET_MS);
+    m_native_trigger = size_t(env_to_uint("GJS_GC_NATIVE_TRIGGER_MB",
+                                          DEFAULT_NATIVE_TRIGGER >> 20)) << 20;
+    memset(&m_stats, 0, sizeof(m_stats));
+
+    m_prev_slice_callback = JS::SetGCSliceCallback(cx, on_gc_slice);
+
+#ifdef __linux__
+    m_pressure_fd = -1;
+    m_pressure_source_id = 0;
+    m_pressure_is_psi = false;
+    m_pressure_events_seen = 0;
+    watch_memory_pressure();
+#endif
+}
+
+GjsGCScheduler::~GjsGCScheduler()
+{
+    if (m_slice_idle_id)
+        g_source_remove(m_slice_idle_id);
+#ifdef __linux__
+    unwatch_memory_pressure();
+#endif
+    JS::SetGCSliceCallback(m_cx, m_prev_slice_callback);
+}
+
+void
+GjsGCScheduler::schedule_slices(void)
+{
+    if (m_slice_idle_id)
+        return;
+    m_slice_idle_id = g_idle_add_full(G_PRIORITY_DEFAULT_IDLE, on_slice_idle,
+                                      this, NULL);
+}
+
+gboolean
+GjsGCScheduler::on_slice_idle(void *data)
+{
+    auto self = static_cast<GjsGCScheduler *>(data);
+    JSAutoRequest ar(self->m_cx);
+
+    if (JS::IsIncrementalGCInProgress(self->m_cx)) {
+        JS::PrepareForIncrementalGC(self->m_cx);
+        JS::IncrementalGCSlice(self->m_cx, JS::gcreason::API,
+                               self->m_slice_budget_ms);
+    }
+
+    if (JS::IsIncrementalGCInProgress(self->m_cx))
+        return G_SOURCE_CONTINUE;
+
+    self->m_slice_idle_id = 0;
+    return G_SOURCE_REMOVE;
+}
+
+void
+GjsGCScheduler::start(JSGCInvocationKind   kind,
+                      JS::gcreason::Reason reason)
+{
+    JSAutoRequest ar(m_cx);
+
+    gjs_debug(GJS_DEBUG_CONTEXT, "Starting incremental GC, reason %s",
+              JS::gcreason::ExplainReason(reason));
+    JS::PrepareForFullGC(m_cx);
+    JS::StartIncrementalGC(m_cx, kind, reason, m_slice_budget_ms);
+    schedule_slices();
+}
+
+/* Called from an idle after JS code has run; see gjs_gc_if_needed() */
+void
+GjsGCScheduler::maybe_collect(void)
+{
+    if (JS::IsIncrementalGCInProgress(m_cx)) {
+        schedule_slices();
+        return;
+    }
+
+    if (m_native_bytes >= m_native_trigger)
+        start(GC_NORMAL, JS::gcreason::TOO_MUCH_MALLOC);
+}
+
+void
+GjsGCScheduler::memory_pressure(void)
+{
+    m_stats.n_pressure_events++;
+
+    int64_t now = g_get_monotonic_time();
+    if (now - m_last_pressure_gc < PRESSURE_GC_INTERVAL)
+        return;
+    m_last_pressure_gc = now;
+
+    if (JS::IsIncrementalGCInProgress(m_cx)) {
+        /* Get the ongoing collection done sooner */
+        JSAutoRequest ar(m_cx);
+        JS::PrepareForIncrementalGC(m_cx);
+        JS::IncrementalGCSlice(m_cx, JS::gcreason::MEM_PRESSURE,
+                               m_slice_budget_ms);
+        schedule_slices();
+        return;
+    }
+
+    start(GC_SHRINK, JS::gcreason::MEM_PRESSURE);
+}
+
+void
+GjsGCScheduler::on_gc_slice(JSContext                *cx,
+                            JS::GCProgress            progress,
+                            const JS::GCDescription& desc)
+{
+    GjsGCScheduler *self = gjs_gc_get_scheduler(cx);
+    if (!self)
+        return;
+
+    switch (progress) {
+    case JS::GC_CYCLE_BEGIN:
+        /* Whoever started it, this collection takes care of the native
+         * memory allocated so far. If SpiderMonkey started it, we still want
+         * to finish it in idle time rather than on its next allocation. */
+        self->m_native_bytes = 0;
+        self->m_stats.n_cycles++;
+        self->schedule_slices();
+        break;
+    case JS::GC_SLICE_BEGIN:
+        self->m_slice_start = g_get_monotonic_time();
+        break;
+    case JS::GC_SLICE_END: {
+        int64_t pause = g_get_monotonic_time() - self->m_slice_start;
+        int64_t pause_ms = pause / 1000;
+        unsigned bucket = 0;
+        while (bucket < GJS_GC_PAUSE_BUCKETS - 1 && pause_ms >= (1 << bucket))
+            bucket++;
+
+        self->m_stats.n_slices++;
+        self->m_stats.total_pause_us += pause;
+        self->m_stats.max_pause_us = MAX(self->m_stats.max_pause_us, pause);
+        self->m_stats.pause_histogram[bucket]++;
+        break;
+    }
+    default:
+        break;
+    }
+
+    if (self->m_prev_slice_callback)
+        self->m_prev_slice_callback(cx, progress, desc);
+}
+
+#ifdef __linux__
+/* Returns the path of memory.events in this process's cgroup v2, if any */
+static char *
+cgroup_memory_events_path(void)
+{
+    char *contents;
+    if (!g_file_get_contents("/proc/self/cgroup", &contents, NULL, NULL))
+        return NULL;
+
+    char *path = NULL;
+    char **lines = g_strsplit(contents, "\n", -1);
+    for (char **line = lines; *line; line++) {
+        if (g_str_has_prefix(*line, "0::/") && strcmp(*line, "0::/") != 0) {
+            path = g_strconcat("/sys/fs/cgroup", *line + 3, "/memory.events",
+                               NULL);
+            break;
+        }
+    }
+
+    g_strfreev(lines);
+    g_free(contents);
+    return path;
+}
+
+/* Sums the counters for the cgroup going over its high and max limits.
+ * Returns false if the file can't be read. */
+static bool
+read_cgroup_memory_events(int       fd,
+                          uint64_t *total_out)
+{
+    char buf[512];
+    ssize_t len = pread(fd, buf, sizeof(buf) - 1, 0);
+    if (len <= 0)
+        return false;
+    buf[len] = '\0';
+
+    uint64_t total = 0;
+    char **lines = g_strsplit(buf, "\n", -1);
+    for (char **line = lines; *line; line++) {
+        if (g_str_has_prefix(*line, "high ") || g_str_has_prefix(*line, "max ") ||
+            g_str_has_prefix(*line, "oom "))
+            total += g_ascii_strtoull(strchr(*line, ' ') + 1, NULL, 10);
+    }
+    g_strfreev(lines);
+    *total_out = total;
+    return true;
+}
+
+void
+GjsGCScheduler::watch_memory_pressure(void)
+{
+    /* Prefer a PSI trigger: tasks stalled on memory for 100 ms within 2 s,
+     * the shortest window that unprivileged processes can ask for */
+    static const char psi_trigger[] = "some 100000 2000000";
+    int fd = open("/proc/pressure/memory", O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd >= 0 && write(fd, psi_trigger, sizeof(psi_trigger)) < 0) {
+        close(fd);
+        fd = -1;
+    }
+    m_pressure_is_psi = fd >= 0;
+
+    /* Otherwise, the cgroup's memory.events file signals a change whenever
+     * the cgroup goes over its high or max limit */
+    if (fd < 0) {
+        GjsAutoChar path = cgroup_memory_events_path();
+        if (path)
+            fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd >= 0 && !read_cgroup_memory_events(fd, &m_pressure_events_seen)) {
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    if (fd < 0)
+        return;
+
+    gjs_debug(GJS_DEBUG_CONTEXT, "Watching memory pressure through %s",
+              m_pressure_is_psi ? "PSI" : "cgroup memory events");
+    m_pressure_fd = fd;
+    m_pressure_source_id = g_unix_fd_add_full(G_PRIORITY_DEFAULT, fd,
+                                              GIOCondition(G_IO_PRI | G_IO_ERR),
+                                              on_pressure_fd, this, NULL);
+}
+
+void
+GjsGCScheduler::unwatch_memory_pressure(void)
+{
+    if (m_pressure_source_id)
+        g_source_remove(m_pressure_source_id);
+    m_pressure_source_id = 0;
+    if (m_pressure_fd >= 0)
+        close(m_pressure_fd);
+    m_pressure_fd = -1;
+}
+
+gboolean
+GjsGCScheduler::on_pressure_fd(int          fd,
+                               GIOCondition condition,
+                               void        *data)
+{
+    auto self = static_cast<GjsGCScheduler *>(data);
+
+    if (!(condition & G_IO_ERR)) {
+        if (self->m_pressure_is_psi) {
+            self->memory_pressure();
+            return G_SOURCE_CONTINUE;
+        }
+
+        uint64_t events;
+        if (read_cgroup_memory_events(fd, &events)) {
+            if (events > self->m_pressure_events_seen) {
+                self->m_pressure_events_seen = events;
+                self->memory_pressure();
+            }
+            return G_SOURCE_CONTINUE;
+        }
+    }
+
+    /* The trigger or the cgroup went away, or memory.events can't be read;
+     * it would stay readable for G_IO_PRI until it is, so stop watching */
+    gjs_debug(GJS_DEBUG_CONTEXT, "Stopped watching memory pressure");
+    self->m_pressure_source_id = 0;
+    close(self->m_pressure_fd);
+    self->m_pressure_fd = -1;
+    return G_SOURCE_REMOVE;
+}
+#endif  /* __linux__ */
+
+GjsGCScheduler *
+gjs_gc_get_scheduler(JSContext *cx)
+{
+    auto gjs_context = static_cast<GjsContext *>(JS_GetContextPrivate(cx));
+    if (!gjs_context)
+        return NULL;
+    return _gjs_context_get_gc_scheduler(gjs_context);
+}
+
+/**
+ * gjs_gc_note_native_alloc:
+ * @cx: the JS context
+ * @nbytes: size of the native memory kept alive by a JS object
+ *
+ * Counts memory allocated outside of the JS heap for a JS object, such as
+ * a wrapped GObject or a boxed struct, towards starting the next collection.
+ */
+void
+gjs_gc_note_native_alloc(JSContext *cx,
+                         size_t     nbytes)
+{
+    GjsGCScheduler *scheduler = gjs_gc_get_scheduler(cx);
+    if (scheduler && scheduler->note_native_alloc(nbytes))
+        _gjs_context_schedule_gc_if_needed(
+            static_cast<GjsContext *>(JS_GetContextPrivate(cx)));
+}
@@ -0,0 +1,106 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2026  The GJS authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef GJS_GC_SCHEDULER_H
+#define GJS_GC_SCHEDULER_H
+
+#include <stdint.h>
+
+#include <glib.h>
+
+#include "jsapi-wrapper.h"
+
+/* Pauses shorter than 2^i ms go in bucket i; the last bucket takes the rest */
+#define GJS_GC_PAUSE_BUCKETS 10
+
+typedef struct {
+    uint64_t n_cycles;
+    uint64_t n_slices;
+    uint64_t n_pressure_events;
+    int64_t total_pause_us;
+    int64_t max_pause_us;
+    uint64_t pause_histogram[GJS_GC_PAUSE_BUCKETS];
+} GjsGCStats;
+
+/* Decides when to collect garbage for one JSContext. Collections are started
+ * when enough native memory has been allocated on behalf of JS (wrapped
+ * GObjects, boxed structs) or when the system reports memory pressure, and
+ * are then run incrementally, one slice of at most the slice budget per
+ * idle callback. */
+class GjsGCScheduler {
+    JSContext *m_cx;
+    unsigned m_slice_budget_ms;
+    size_t m_native_trigger;
+    size_t m_native_bytes;
+    unsigned m_slice_idle_id;
+    int64_t m_slice_start;
+    int64_t m_last_pressure_gc;
+    JS::GCSliceCallback m_prev_slice_callback;
+    GjsGCStats m_stats;
+
+#ifdef __linux__
+    int m_pressure_fd;
+    unsigned m_pressure_source_id;
+    bool m_pressure_is_psi;
+    uint64_t m_pressure_events_seen;
+
+    void watch_memory_pressure(void);
+    void unwatch_memory_pressure(void);
+    static gboolean on_pressure_fd(int fd, GIOCondition condition, void *data);
+#endif
+
+    void start(JSGCInvocationKind kind, JS::gcreason::Reason reason);
+    void schedule_slices(void);
+    static gboolean on_slice_idle(void *data);
+    static void on_gc_slice(JSContext *cx, JS::GCProgress progress,
+                            const JS::GCDescription& desc);
+
+public:
+    static const unsigned DEFAULT_SLICE_BUDGET_MS = 5;
+    static const size_t DEFAULT_NATIVE_TRIGGER = 32 * 1024 * 1024;
+
+    explicit GjsGCScheduler(JSContext *cx);
+    ~GjsGCScheduler();
+
+    void maybe_collect(void);
+    void memory_pressure(void);
+
+    inline bool note_native_alloc(size_t nbytes) {
+        m_native_bytes += nbytes;
+        return m_native_bytes >= m_native_trigger;
+    }
+
+    void set_slice_budget(unsigned ms) { m_slice_budget_ms = ms; }
+    unsigned slice_budget(void) const { return m_slice_budget_ms; }
+    void set_native_trigger(size_t nbytes) { m_native_trigger = nbytes; }
+    size_t native_trigger(void) const { return m_native_trigger; }
+
+    const GjsGCStats& stats(void) const { return m_stats; }
+};
+
+void gjs_gc_note_native_alloc(JSContext *cx,
+                              size_t     nbytes);
+
+GjsGCScheduler *gjs_gc_get_scheduler(JSContext *cx);
+
+#endif  /* GJS_GC_SCHEDULER_H */
@@ -41,6 +41,9 @@
 #endif
 
 #include <string.h>
+#include <time.h>
+
+#include <glib/gstdio.h>
 
 #define MODULE_INIT_FILENAME "__init__.js"
 
@@ -48,8 +51,28 @@ static char **gjs_search_path = NULL;
 
 typedef struct {
     bool is_root;
+    /* search path element -> DirListing */
+    GHashTable *dir_listings;
 } Importer;
 
+/* The names in a search path directory, so that resolving a module to a
+ * file or directory, or finding out that it isn't there, is a hash lookup
+ * instead of a number of file queries. Local directories are listed again
+ * when their mtime changes; resources never change. */
+typedef struct {
+    /* basename -> GFileType */
+    GHashTable *entries;
+    /* NULL if not a local directory */
+    char *path;
+    bool exists;
+    time_t mtime;
+    time_t listed_at;
+    unsigned generation;
+} DirListing;
+
+/* Listings made before the last gjs_importer_clear_cache() are stale */
+static unsigned dir_listing_generation = 0;
+
 typedef struct {
     GPtrArray *elements;
     unsigned int index;
@@ -417,6 +440,123 @@ import_symbol_from_init_js(JSContext       *cx,
     return true;
 }
 
+static void
+dir_listing_free(void *data)
+{
+    auto listing = static_cast<DirListing *>(data);
+    g_hash_table_destroy(listing->entries);
+    g_free(listing->path);
+    g_slice_free(DirListing, listing);
+}
+
+static DirListing *
+dir_listing_new(const char *dirname)
+{
+    DirListing *listing = g_slice_new0(DirListing);
+    listing->entries = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                             g_free, NULL);
+    listing->generation = dir_listing_generation;
+
+    /* new_for_commandline_arg handles resource:/// paths */
+    GjsAutoUnref<GFile> dir = g_file_new_for_commandline_arg(dirname);
+    if (g_file_is_native(dir)) {
+        GStatBuf buf;
+
+        /* Stat before listing, so that changes made while listing are
+         * noticed the next time */
+        listing->path = g_file_get_path(dir);
+        listing->exists = listing->path && g_stat(listing->path, &buf) == 0;
+        if (listing->exists)
+            listing->mtime = buf.st_mtime;
+        listing->listed_at = time(NULL);
+    }
+
+    GjsAutoUnref<GFileEnumerator> direnum =
+        g_file_enumerate_children(dir,
+                                  G_FILE_ATTRIBUTE_STANDARD_NAME ","
+                                  G_FILE_ATTRIBUTE_STANDARD_TYPE,
+                                  G_FILE_QUERY_INFO_NONE, NULL, NULL);
+    if (!direnum)
+        return listing;
+
+    while (true) {
+        GFileInfo *info;
+        if (!g_file_enumerator_iterate(direnum, &info, NULL, NULL, NULL) ||
+            info == NULL)
+            break;
+
+        g_hash_table_replace(listing->entries,
+                             g_strdup(g_file_info_get_name(info)),
+                             GINT_TO_POINTER(g_file_info_get_file_type(info)));
+    }
+
+    return listing;
+}
+
+static bool
+dir_listing_is_current(DirListing *listing)
+{
+    GStatBuf buf;
+
+    if (listing->generation != dir_listing_generation)
+        return false;
+
+    if (!listing->path)
+        return true;
+
+    if (g_stat(listing->path, &buf) != 0)
+        return !listing->exists;
+
+    /* The mtime only has a resolution of one second, so changes made in the
+     * same second as the listing could have been missed */
+    return listing->exists && buf.st_mtime == listing->mtime &&
+        listing->listed_at > listing->mtime;
+}
+
+/**
+ * gjs_importer_clear_cache:
+ *
+ * Makes every importer list its search path directories again, for when they
+ * were changed in a way that the mtime doesn't show.
+ */
+void
+gjs_importer_clear_cache(void)
+{
+    dir_listing_generation++;
+}
+
+static DirListing *
+importer_get_dir_listing(Importer   *priv,
+                         const char *dirname)
+{
+    if (!priv->dir_listings)
+        priv->dir_listings = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                                   g_free, dir_listing_free);
+
+    auto listing = static_cast<DirListing *>(
+        g_hash_table_lookup(priv->dir_listings, dirname));
+    if (listing && dir_listing_is_current(listing))
+        return listing;
+
+    gjs_debug(GJS_DEBUG_IMPORTER, "Listing search path directory '%s'",
+              dirname);
+    listing = dir_listing_new(dirname);
+    g_hash_table_replace(priv->dir_listings, g_strdup(dirname), listing);
+    return listing;
+}
+
+static bool
+dir_listing_lookup(DirListing *listing,
+                   const char *name,
+                   GFileType  *type_p)
+{
+    void *type;
+    if (!g_hash_table_lookup_extended(listing->entries, name, NULL, &type))
+        return false;
+    *type_p = GFileType(GPOINTER_TO_INT(type));
+    return true;
+}
+
 static bool
 import_file_on_module(JSContext       *context,
                       JS::HandleObject obj,
@@ -461,9 +601,10 @@ do_import(JSContext       *context,
     JS::RootedObject search_path(context);
     guint32 search_path_len;
     guint32 i;
-    bool result, exists, is_array;
+    bool result, is_array;
     GPtrArray *directories;
     GFile *gfile;
+    GFileType file_type;
 
     if (!gjs_object_require_property(context, obj, "importer",
                                      GJS_STRING_SEARCH_PATH, &search_path))
@@ -525,19 +666,23 @@ do_import(JSContext       *context,
         if (dirname[0] == '\0')
             continue;
 
+        DirListing *listing = importer_get_dir_listing(priv, dirname);
+
         /* Try importing __init__.js and loading the symbol from it */
-        import_symbol_from_init_js(context, obj, dirname, name, &result);
-        if (result)
-            goto out;
+        if (dir_listing_lookup(listing, MODULE_INIT_FILENAME, &file_type)) {
+            import_symbol_from_init_js(context, obj, dirname, name, &result);
+            if (result)
+                goto out;
+        }
 
         /* Second try importing a directory (a sub-importer) */
-        if (full_path)
-            g_free(full_path);
-        full_path = g_build_filename(dirname, name,
-                                     NULL);
-        gfile = g_file_new_for_commandline_arg(full_path);
+        if (dir_listing_lookup(listing, name, &file_type) &&
+            file_type == G_FILE_TYPE_DIRECTORY) {
+            if (full_path)
+                g_free(full_path);
+            full_path = g_build_filename(dirname, name,
+                                         NULL);
 
-        if (g_file_query_file_type(gfile, (GFileQueryInfoFlags) 0, NULL) == G_FILE_TYPE_DIRECTORY) {
             gjs_debug(GJS_DEBUG_IMPORTER,
                       "Adding directory '%s' to child importer '%s'",
                       full_path, name);
@@ -549,8 +694,6 @@ do_import(JSContext       *context,
             full_path = NULL;
         }
 
-        g_object_unref(gfile);
-
         /* If we just added to directories, we know we don't need to
          * check for a file.  If we added to directories on an earlier
          * iteration, we want to ignore any files later in the
@@ -562,21 +705,18 @@ do_import(JSContext       *context,
         }
 
         /* Third, if it's not a directory, try importing a file */
-        g_free(full_path);
-        full_path = g_build_filename(dirname, filename,
-                                     NULL);
-        gfile = g_file_new_for_commandline_arg(full_path);
-        exists = g_file_query_exists(gfile, NULL);
-
-        if (!exists) {
+        if (!dir_listing_lookup(listing, filename, &file_type)) {
             gjs_debug(GJS_DEBUG_IMPORTER,
                       "JS import '%s' not found in %s",
                       name, dirname.get());
-
-            g_object_unref(gfile);
             continue;
         }
 
+        g_free(full_path);
+        full_path = g_build_filename(dirname, filename,
+                                     NULL);
+        gfile = g_file_new_for_commandline_arg(full_path);
+
         if (import_file_on_module(context, obj, id, name, gfile)) {
             gjs_debug(GJS_DEBUG_IMPORTER,
                       "successfully imported module '%s'", name);
@@ -803,6 +943,8 @@ importer_finalize(js::FreeOp *fop,
         return; /* we are the prototype, not a real instance */
 
     GJS_DEC_COUNTER(importer);
+    if (priv->dir_listings)
+        g_hash_table_destroy(priv->dir_listings);
     g_slice_free(Importer, priv);
 }
 
@@ -33,6 +33,8 @@ G_BEGIN_DECLS
 JSObject *gjs_create_root_importer(JSContext          *cx,
                                    const char * const *search_path);
 
+void gjs_importer_clear_cache(void);
+
 G_END_DECLS
 
 #endif  /* __GJS_IMPORTER_H__ */
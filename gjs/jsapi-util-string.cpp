@@ -26,8 +26,123 @@
 #include <algorithm>
 #include <string.h>
 
+#include "context-private.h"
 #include "jsapi-util.h"
 #include "jsapi-wrapper.h"
+#include "mem.h"
+
+/* Whether the first @len bytes of @str are all ASCII. This ORs together a
+ * word at a time and tests the high bit of every byte at once; compilers turn
+ * the unrolled loop into vector instructions where they can. */
+static bool
+is_ascii(const char *str,
+         size_t      len)
+{
+    static const uint64_t high_bits = UINT64_C(0x8080808080808080);
+    const char *end = str + len;
+
+    for (; end - str >= 32; str += 32) {
+        uint64_t words[4];
+        memcpy(words, str, sizeof(words));
+        if ((words[0] | words[1] | words[2] | words[3]) & high_bits)
+            return false;
+    }
+
+    for (; end - str >= 8; str += 8) {
+        uint64_t word;
+        memcpy(&word, str, sizeof(word));
+        if (word & high_bits)
+            return false;
+    }
+
+    for (; str < end; str++) {
+        if (*str & 0x80)
+            return false;
+    }
+
+    return true;
+}
+
+/* Decodes UTF-8 made up only of ASCII and of the two-byte sequences for
+ * U+0080 to U+00FF into @latin1, which must have room for @len bytes.
+ * Returns false if @utf8 contains anything else, including invalid UTF-8,
+ * which is left for g_utf8_to_utf16() to report. */
+static bool
+utf8_to_latin1(const char *utf8,
+               size_t      len,
+               char       *latin1,
+               size_t     *latin1_len)
+{
+    auto in = reinterpret_cast<const uint8_t *>(utf8);
+    const uint8_t *end = in + len;
+    char *out = latin1;
+
+    while (in < end) {
+        if (*in < 0x80) {
+            *out++ = *in++;
+            continue;
+        }
+
+        if ((*in != 0xc2 && *in != 0xc3) || end - in < 2 ||
+            (in[1] & 0xc0) != 0x80)
+            return false;
+
+        *out++ = char(((in[0] & 0x03) << 6) | (in[1] & 0x3f));
+        in += 2;
+    }
+
+    *latin1_len = out - latin1;
+    return true;
+}
+
+/* Encodes a Latin-1 JSString as UTF-8, directly from its chars. Returns NULL
+ * on OOM. */
+static char *
+latin1_string_to_utf8(JSContext *cx,
+                      JSString  *str)
+{
+    JSLinearString *linear = JS_EnsureLinearString(cx, str);
+    if (!linear)
+        return NULL;
+
+    size_t len = JS_GetStringLength(str);
+    size_t n_high = 0;
+    {
+        JS::AutoCheckCannotGC nogc;
+        const JS::Latin1Char *chars = JS_GetLatin1LinearStringChars(nogc,
+                                                                    linear);
+        if (!is_ascii(reinterpret_cast<const char *>(chars), len)) {
+            for (size_t ix = 0; ix < len; ix++)
+                n_high += chars[ix] >> 7;
+        }
+    }
+
+    char *utf8 = js_pod_malloc<char>(len + n_high + 1);
+    if (!utf8) {
+        JS_ReportOutOfMemory(cx);
+        return NULL;
+    }
+
+    JS::AutoCheckCannotGC nogc;
+    const JS::Latin1Char *chars = JS_GetLatin1LinearStringChars(nogc, linear);
+    if (n_high == 0) {
+        memcpy(utf8, chars, len);
+        utf8[len] = '\0';
+        return utf8;
+    }
+
+    char *out = utf8;
+    for (size_t ix = 0; ix < len; ix++) {
+        if (chars[ix] < 0x80) {
+            *out++ = chars[ix];
+        } else {
+            *out++ = char(0xc0 | (chars[ix] >> 6));
+            *out++ = char(0x80 | (chars[ix] & 0x3f));
+        }
+    }
+    *out = '\0';
+    return utf8;
+}
 
 bool
 gjs_string_to_utf8 (JSContext      *context,
@@ -44,13 +159,62 @@ gjs_string_to_utf8 (JSContext      *context,
     }
 
     JS::RootedString str(context, value.toString());
-    utf8_string_p->reset(context, JS_EncodeStringToUTF8(context, str));
+    if (JS_StringHasLatin1Chars(str) &&
+        _gjs_context_optimization_enabled(context,
+                                          GJS_OPTIMIZATION_STRING_FAST_PATHS))
+        utf8_string_p->reset(context, latin1_string_to_utf8(context, str));
+    else
+        utf8_string_p->reset(context, JS_EncodeStringToUTF8(context, str));
 
     JS_EndRequest(context);
 
     return true;
 }
 
+/* Creates a JS string straight from @utf8_string if it only has Latin-1
+ * characters, which covers the ASCII that most strings from C are made of.
+ * Sets *handled to false if it has others. */
+static bool
+string_from_latin1_utf8(JSContext             *context,
+                        const char            *utf8_string,
+                        ssize_t                n_bytes,
+                        JS::MutableHandleValue value_p,
+                        bool                  *handled)
+{
+    /* g_utf8_to_utf16() also stops at the first NUL byte */
+    size_t len = n_bytes < 0 ? strlen(utf8_string) :
+        strnlen(utf8_string, n_bytes);
+    JS::RootedString str(context);
+
+    *handled = true;
+    if (is_ascii(utf8_string, len)) {
+        str = JS_NewStringCopyN(context, utf8_string, len);
+    } else {
+        char stack_buffer[256];
+        GjsAutoChar heap_buffer;
+        char *latin1 = stack_buffer;
+        size_t latin1_len;
+
+        if (len > sizeof(stack_buffer)) {
+            heap_buffer = static_cast<char *>(g_malloc(len));
+            latin1 = heap_buffer;
+        }
+
+        if (!utf8_to_latin1(utf8_string, len, latin1, &latin1_len)) {
+            *handled = false;
+            return true;
+        }
+
+        str = JS_NewStringCopyN(context, latin1, latin1_len);
+    }
+
+    if (!str)
+        return false;
+
+    value_p.setString(str);
+    return true;
+}
+
 bool
 gjs_string_from_utf8(JSContext             *context,
                      const char            *utf8_string,
@@ -65,6 +229,18 @@ gjs_string_from_utf8(JSContext             *context,
     * n_chars (from g_utf8_strlen()) the result appears truncated
     */
 
+    if (_gjs_context_optimization_enabled(context,
+                                          GJS_OPTIMIZATION_STRING_FAST_PATHS)) {
+        JSAutoRequest ar(context);
+        bool handled;
+
+        if (!string_from_latin1_utf8(context, utf8_string, n_bytes, value_p,
+                                     &handled))
+            return false;
+        if (handled)
+            return true;
+    }
+
     error = NULL;
     u16_string =
         reinterpret_cast<char16_t *>(g_utf8_to_utf16(utf8_string, n_bytes, NULL,
@@ -90,6 +266,91 @@ gjs_string_from_utf8(JSContext             *context,
     return str != NULL;
 }
 
+/* Strings longer than this are unlikely to be names, so not worth caching */
+#define BORROWED_STRING_MAX_LENGTH 128
+
+static bool
+borrowed_string_matches(JSContext               *cx,
+                        const GjsBorrowedString& entry,
+                        const char              *utf8_string)
+{
+    /* Unused entries have no atom */
+    if (!entry.atom || entry.utf8 != utf8_string)
+        return false;
+
+    /* The C code may have freed the string and reused the memory since, so
+     * compare the contents too. strncmp() stops at the end of utf8_string,
+     * and the atom has no NULs, so this never reads past either of them. */
+    JS::AutoCheckCannotGC nogc;
+    size_t len;
+    const JS::Latin1Char *chars =
+        JS_GetLatin1StringCharsAndLength(cx, nogc, entry.atom, &len);
+    return chars && len == entry.length &&
+        strncmp(utf8_string, reinterpret_cast<const char *>(chars), len) == 0 &&
+        utf8_string[len] == '\0';
+}
+
+/**
+ * gjs_string_from_borrowed_utf8:
+ * @context: the JS context
+ * @utf8_string: a NUL-terminated string that C code still owns
+ * @value_p: return location for the JS string
+ *
+ * Like gjs_string_from_utf8(), for names that belong to C and are handed to
+ * JS again and again at the same address, such as type names and property
+ * names. Don't use it for arbitrary text: every string it sees is made into
+ * an atom, and the atoms stay alive as long as their table entry. Short ASCII
+ * strings are turned into atoms, which are remembered by
+ * address in a small per-context table, so the next time the same string
+ * crosses into JS it costs a comparison instead of an allocation. A NULL
+ * @utf8_string becomes null.
+ *
+ * Returns: false if an exception is pending
+ */
+bool
+gjs_string_from_borrowed_utf8(JSContext             *context,
+                              const char            *utf8_string,
+                              JS::MutableHandleValue value_p)
+{
+    if (!utf8_string) {
+        value_p.setNull();
+        return true;
+    }
+
+    auto gjs_context = static_cast<GjsContext *>(JS_GetContextPrivate(context));
+    GjsBorrowedStringCache *cache =
+        _gjs_context_get_borrowed_string_cache(gjs_context);
+    if (!cache)
+        return gjs_string_from_utf8(context, utf8_string, -1, value_p);
+
+    JSAutoRequest ar(context);
+
+    uintptr_t addr = reinterpret_cast<uintptr_t>(utf8_string);
+    GjsBorrowedString& entry = (*cache)[((addr >> 3) ^ (addr >> 12)) %
+                                        cache->size()];
+    if (borrowed_string_matches(context, entry, utf8_string)) {
+        GJS_INC_STAT(string_cache_hit);
+        value_p.setString(entry.atom);
+        return true;
+    }
+
+    GJS_INC_STAT(string_cache_miss);
+
+    size_t len = strnlen(utf8_string, BORROWED_STRING_MAX_LENGTH + 1);
+    if (len > BORROWED_STRING_MAX_LENGTH || !is_ascii(utf8_string, len))
+        return gjs_string_from_utf8(context, utf8_string, -1, value_p);
+
+    JSString *atom = JS_AtomizeStringN(context, utf8_string, len);
+    if (!atom)
+        return false;
+
+    entry.utf8 = utf8_string;
+    entry.length = len;
+    entry.atom = atom;
+    value_p.setString(atom);
+    return true;
+}
+
 bool
 gjs_string_to_filename(JSContext      *context,
                        const JS::Value filename_val,
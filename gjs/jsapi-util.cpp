@@ -33,6 +33,7 @@
 #include "jsapi-util.h"
 #include "jsapi-wrapper.h"
 #include "context-private.h"
+#include "gc-scheduler.h"
 #include "jsapi-private.h"
 #include <gi/boxed.h>
 
@@ -643,80 +644,12 @@ gjs_get_type_name(JS::Value value)
     }
 }
 
-#ifdef __linux__
-static void
-_linux_get_self_process_size (gulong *vm_size,
-                              gulong *rss_size)
-{
-    char *contents;
-    char *iter;
-    gsize len;
-    int i;
-
-    *vm_size = *rss_size = 0;
-
-    if (!g_file_get_contents ("/proc/self/stat", &contents, &len, NULL))
-        return;
-
-    iter = contents;
-    /* See "man proc" for where this 22 comes from */
-    for (i = 0; i < 22; i++) {
-        iter = strchr (iter, ' ');
-        if (!iter)
-            goto out;
-        iter++;
-    }
-    sscanf (iter, " %lu", vm_size);
-    iter = strchr (iter, ' ');
-    if (iter)
-        sscanf (iter, " %lu", rss_size);
-
- out:
-    g_free (contents);
-}
-
-static gulong linux_rss_trigger;
-static gint64 last_gc_time;
-#endif
-
 void
 gjs_gc_if_needed (JSContext *context)
 {
-#ifdef __linux__
-    {
-        /* We initiate a GC if VM or RSS has grown by this much */
-        gulong vmsize;
-        gulong rss_size;
-        gint64 now;
-
-        /* We rate limit GCs to at most one per 5 frames.
-           One frame is 16666 microseconds (1000000/60)*/
-        now = g_get_monotonic_time();
-        if (now - last_gc_time < 5 * 16666)
-            return;
-
-        _linux_get_self_process_size (&vmsize, &rss_size);
-
-        /* linux_rss_trigger is initialized to 0, so currently
-         * we always do a full GC early.
-         *
-         * Here we see if the RSS has grown by 25% since
-         * our last look; if so, initiate a full GC.  In
-         * theory using RSS is bad if we get swapped out,
-         * since we may be overzealous in GC, but on the
-         * other hand, if swapping is going on, better
-         * to GC.
-         */
-        if (rss_size > linux_rss_trigger) {
-            linux_rss_trigger = (gulong) MIN(G_MAXULONG, rss_size * 1.25);
-            JS_GC(context);
-            last_gc_time = now;
-        } else if (rss_size < (0.75 * linux_rss_trigger)) {
-            /* If we've shrunk by 75%, lower the trigger */
-            linux_rss_trigger = (rss_size * 1.25);
-        }
-    }
-#endif
+    GjsGCScheduler *scheduler = gjs_gc_get_scheduler(context);
+    if (scheduler)
+        scheduler->maybe_collect();
 }
 
 /**
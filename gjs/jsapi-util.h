@@ -214,6 +214,9 @@ bool gjs_string_from_utf8(JSContext             *context,
                           const char            *utf8_string,
                           ssize_t                n_bytes,
                           JS::MutableHandleValue value_p);
+bool gjs_string_from_borrowed_utf8(JSContext             *context,
+                                   const char            *utf8_string,
+                                   JS::MutableHandleValue value_p);
 
 bool gjs_string_to_filename(JSContext       *cx,
                             const JS::Value  string_val,
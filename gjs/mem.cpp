@@ -71,6 +71,55 @@ static GjsMemCounter* counters[] = {
     GJS_LIST_COUNTER(constructor_proxy),
 };
 
+#define GJS_DEFINE_STAT(name)            \
+    GjsStatCounter gjs_stat_ ## name = { \
+        0, #name                         \
+    };
+
+GJS_DEFINE_STAT(trampoline_pool_hit)
+GJS_DEFINE_STAT(trampoline_pool_miss)
+GJS_DEFINE_STAT(boxed_nursery_alloc)
+GJS_DEFINE_STAT(boxed_nursery_pin)
+GJS_DEFINE_STAT(job_queue_run)
+GJS_DEFINE_STAT(job_queue_drains)
+GJS_DEFINE_STAT(job_queue_yields)
+GJS_DEFINE_STAT(job_queue_max_drain_us)
+GJS_DEFINE_STAT(string_cache_hit)
+GJS_DEFINE_STAT(string_cache_miss)
+GJS_DEFINE_STAT(class_cache_hit)
+GJS_DEFINE_STAT(class_cache_miss)
+GJS_DEFINE_STAT(module_prefetch_read)
+GJS_DEFINE_STAT(module_prefetch_hit)
+GJS_DEFINE_STAT(module_prefetch_miss)
+
+#define GJS_LIST_STAT(name) \
+    & gjs_stat_ ## name
+
+static GjsStatCounter* stats[] = {
+    GJS_LIST_STAT(trampoline_pool_hit),
+    GJS_LIST_STAT(trampoline_pool_miss),
+    GJS_LIST_STAT(boxed_nursery_alloc),
+    GJS_LIST_STAT(boxed_nursery_pin),
+    GJS_LIST_STAT(job_queue_run),
+    GJS_LIST_STAT(job_queue_drains),
+    GJS_LIST_STAT(job_queue_yields),
+    GJS_LIST_STAT(job_queue_max_drain_us),
+    GJS_LIST_STAT(string_cache_hit),
+    GJS_LIST_STAT(string_cache_miss),
+    GJS_LIST_STAT(class_cache_hit),
+    GJS_LIST_STAT(class_cache_miss),
+    GJS_LIST_STAT(module_prefetch_read),
+    GJS_LIST_STAT(module_prefetch_hit),
+    GJS_LIST_STAT(module_prefetch_miss),
+};
+
+GjsStatCounter * const *
+gjs_get_stat_counters(unsigned *n_counters)
+{
+    *n_counters = G_N_ELEMENTS(stats);
+    return stats;
+}
+
 void
 gjs_memory_report(const char *where,
                   bool        die_if_leaks)
@@ -106,6 +155,14 @@ gjs_memory_report(const char *where,
                   counters[i]->value);
     }
 
+    gjs_debug(GJS_DEBUG_MEMORY, "  Statistics:");
+    for (i = 0; i < (int) G_N_ELEMENTS(stats); ++i) {
+        gjs_debug(GJS_DEBUG_MEMORY,
+                  "    %24s = %" G_GUINT64_FORMAT,
+                  stats[i]->name,
+                  stats[i]->value);
+    }
+
     if (die_if_leaks && GJS_GET_COUNTER(everything) > 0) {
         g_error("%s: JavaScript objects were leaked.", where);
     }
@@ -71,6 +71,44 @@ GJS_DECLARE_COUNTER(constructor_proxy)
 #define GJS_GET_COUNTER(name) \
     g_atomic_int_get(&gjs_counter_ ## name .value)
 
+/* Statistics about caches and pools. Unlike the counters above, these
+ * don't count live objects, so they are not checked for leaks. They are
+ * only updated from the JS thread. */
+typedef struct {
+    guint64 value;
+    const char *name;
+} GjsStatCounter;
+
+#define GJS_DECLARE_STAT(name) \
+    extern GjsStatCounter gjs_stat_ ## name ;
+
+GJS_DECLARE_STAT(trampoline_pool_hit)
+GJS_DECLARE_STAT(trampoline_pool_miss)
+GJS_DECLARE_STAT(boxed_nursery_alloc)
+GJS_DECLARE_STAT(boxed_nursery_pin)
+GJS_DECLARE_STAT(job_queue_run)
+GJS_DECLARE_STAT(job_queue_drains)
+GJS_DECLARE_STAT(job_queue_yields)
+GJS_DECLARE_STAT(job_queue_max_drain_us)
+GJS_DECLARE_STAT(string_cache_hit)
+GJS_DECLARE_STAT(string_cache_miss)
+GJS_DECLARE_STAT(class_cache_hit)
+GJS_DECLARE_STAT(class_cache_miss)
+GJS_DECLARE_STAT(module_prefetch_read)
+GJS_DECLARE_STAT(module_prefetch_hit)
+GJS_DECLARE_STAT(module_prefetch_miss)
+
+#define GJS_INC_STAT(name) \
+    (gjs_stat_ ## name .value++)
+
+#define GJS_MAX_STAT(name, v) \
+    (gjs_stat_ ## name .value = MAX(gjs_stat_ ## name .value, (guint64) (v)))
+
+#define GJS_GET_STAT(name) \
+    (gjs_stat_ ## name .value)
+
+GjsStatCounter * const *gjs_get_stat_counters(unsigned *n_counters);
+
 void gjs_memory_report(const char *where,
                        bool        die_if_leaks);
 
@@ -21,14 +21,741 @@
  * IN THE SOFTWARE.
  */
 
+#include <config.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <unordered_map>
+
 #include <gio/gio.h>
+#include <glib/gstdio.h>
 
+#include "context-private.h"
+#include "global.h"
 #include "jsapi-private.h"
 #include "jsapi-util.h"
 #include "jsapi-wrapper.h"
+#include "mem.h"
 #include "module.h"
 #include "util/log.h"
 
+/* Compiled modules are cached on disk in SpiderMonkey's XDR format, one file
+ * per module path. Each file starts with a key made of the engine version,
+ * the module's path, its modification time and a checksum of its source, so
+ * that a changed module or a different engine never picks up stale bytecode.
+ * It ends with a checksum of the bytecode, so that a truncated or damaged
+ * file is never decoded. Set GJS_DISABLE_MODULE_CACHE to turn the cache off,
+ * or GJS_MODULE_CACHE_DIR to put it somewhere else than the user cache
+ * directory. */
+
+#define MODULE_CACHE_MAGIC "GJS-XDR-2"
+
+/* Length of the hex MD5 checksum at the end of the file */
+#define MODULE_CACHE_CHECKSUM_LEN 32
+
+static bool
+module_cache_enabled(JSContext *cx)
+{
+    return _gjs_context_optimization_enabled(cx, GJS_OPTIMIZATION_MODULE_CACHE);
+}
+
+static char *
+module_cache_path(const char *full_path)
+{
+    const char *cache_dir = g_getenv("GJS_MODULE_CACHE_DIR");
+    GjsAutoChar default_dir;
+    if (!cache_dir) {
+        default_dir = g_build_filename(g_get_user_cache_dir(), "gjs",
+                                       "modules", nullptr);
+        cache_dir = default_dir;
+    }
+
+    GjsAutoChar name = g_compute_checksum_for_string(G_CHECKSUM_SHA256,
+                                                     full_path, -1);
+    return g_strconcat(cache_dir, G_DIR_SEPARATOR_S, name.get(), ".xdr",
+                       nullptr);
+}
+
+static char *
+module_cache_key(const char *full_path,
+                 const char *etag,
+                 const char *script,
+                 size_t      script_len)
+{
+    /* For local files, the etag is the modification time */
+    GjsAutoChar checksum = g_compute_checksum_for_data(G_CHECKSUM_SHA256,
+        reinterpret_cast<const guchar *>(script), script_len);
+    return g_strdup_printf("%s\n%s\n%s\n%s\n%s\n%s\n", MODULE_CACHE_MAGIC,
+                           PACKAGE_VERSION, JS_GetImplementationVersion(),
+                           full_path, etag ? etag : "", checksum.get());
+}
+
+/* Returns false with no exception pending if there was no usable cache */
+static bool
+module_cache_load(JSContext             *cx,
+                  const char            *cache_path,
+                  const char            *key,
+                  JS::MutableHandleScript script)
+{
+    char *unowned_data;
+    size_t len;
+    if (!g_file_get_contents(cache_path, &unowned_data, &len, nullptr))
+        return false;
+    GjsAutoChar data = unowned_data;
+
+    size_t key_len = strlen(key);
+    if (len <= key_len + MODULE_CACHE_CHECKSUM_LEN ||
+        memcmp(data, key, key_len) != 0)
+        return false;
+
+    const uint8_t *bytecode = reinterpret_cast<uint8_t *>(data.get()) + key_len;
+    size_t bytecode_len = len - key_len - MODULE_CACHE_CHECKSUM_LEN;
+    GjsAutoChar checksum = g_compute_checksum_for_data(G_CHECKSUM_MD5,
+                                                       bytecode, bytecode_len);
+    if (memcmp(bytecode + bytecode_len, checksum, MODULE_CACHE_CHECKSUM_LEN) != 0) {
+        gjs_debug(GJS_DEBUG_IMPORTER, "Discarding damaged module cache %s",
+                  cache_path);
+        return false;
+    }
+
+    JS::TranscodeBuffer buffer;
+    if (!buffer.append(bytecode, bytecode_len))
+        return false;
+
+    JS::TranscodeResult result = JS::DecodeScript(cx, buffer, script);
+    if (result == JS::TranscodeResult_Ok)
+        return true;
+
+    if (result == JS::TranscodeResult_Throw)
+        JS_ClearPendingException(cx);
+    gjs_debug(GJS_DEBUG_IMPORTER, "Discarding unusable module cache %s",
+              cache_path);
+    return false;
+}
+
+static void
+module_cache_store(JSContext       *cx,
+                   const char      *cache_path,
+                   const char      *key,
+                   JS::HandleScript script)
+{
+    JS::TranscodeBuffer buffer;
+    size_t key_len = strlen(key);
+    if (!buffer.append(reinterpret_cast<const uint8_t *>(key), key_len))
+        return;
+
+    JS::TranscodeResult result = JS::EncodeScript(cx, buffer, script);
+    if (result != JS::TranscodeResult_Ok) {
+        if (result == JS::TranscodeResult_Throw)
+            JS_ClearPendingException(cx);
+        return;
+    }
+
+    GjsAutoChar checksum = g_compute_checksum_for_data(G_CHECKSUM_MD5,
+        buffer.begin() + key_len, buffer.length() - key_len);
+    if (!buffer.append(reinterpret_cast<const uint8_t *>(checksum.get()),
+                       MODULE_CACHE_CHECKSUM_LEN))
+        return;
+
+    GError *error = nullptr;
+    GjsAutoChar cache_dir = g_path_get_dirname(cache_path);
+    if (g_mkdir_with_parents(cache_dir, 0755) != 0 ||
+        !g_file_set_contents(cache_path,
+                             reinterpret_cast<const char *>(buffer.begin()),
+                             buffer.length(), &error)) {
+        gjs_debug(GJS_DEBUG_IMPORTER, "Failed to write module cache %s: %s",
+                  cache_path, error ? error->message : g_strerror(errno));
+        g_clear_error(&error);
+    }
+}
+
+static bool
+module_cache_is_valid(const char *cache_path,
+                      const char *key)
+{
+    FILE *fp = g_fopen(cache_path, "rb");
+    if (!fp)
+        return false;
+
+    size_t key_len = strlen(key);
+    GjsAutoChar data = static_cast<char *>(g_malloc(key_len));
+    bool valid = fread(data.get(), 1, key_len, fp) == key_len &&
+        memcmp(data, key, key_len) == 0;
+    fclose(fp);
+    return valid;
+}
+
+/* With GJS_PREFETCH_IMPORTS set when the context is created, the source of
+ * each imported module is scanned for imports.foo.bar references. The
+ * modules they name, and the modules those name in turn, are read and
+ * scanned on a worker thread, which hands each one over to the main thread
+ * as soon as it is read. The main thread picks them up at the next import,
+ * or from the main loop, and compiles them on SpiderMonkey's helper threads,
+ * so that by the time they are imported there is a compiled script waiting.
+ * Modules that are too small to be worth a helper thread, or that are in the
+ * module cache, are only scanned. */
+
+typedef struct {
+    char *full_path;
+    /* NULL once the module has been imported */
+    char *source;
+    const char *stripped_source;
+    size_t stripped_len;
+    int line_number;
+    bool in_module_cache;
+    gunichar2 *chars;
+    /* Set when compiling off-thread; the token and done flag are set by the
+     * helper thread, with prefetch_lock held */
+    bool compiling;
+    bool done;
+    void *token;
+} ModulePrefetch;
+
+typedef struct {
+    int ref_count;  /* atomic; held by the context, each scan and the idle */
+    JSContext *cx;
+    /* module path -> ModulePrefetch; only used on the main thread */
+    GHashTable *modules;
+    /* The rest is protected by prefetch_lock. Modules read by workers that
+     * the main thread hasn't picked up yet: */
+    GQueue incoming;
+    unsigned idle_id;
+    bool cancelled;
+} PrefetchTable;
+
+/* One scan, run on a worker thread */
+typedef struct {
+    PrefetchTable *table;
+    GPtrArray *dirs;
+    char *source;
+    size_t source_len;
+    /* Module paths to skip, because they were read already */
+    GHashTable *known;
+    bool check_module_cache;
+} PrefetchScan;
+
+/* Protects prefetch_tables, the shared fields of each PrefetchTable, and the
+ * done flag and token of each ModulePrefetch */
+static GMutex prefetch_lock;
+static GCond prefetch_cond;
+
+static std::unordered_map<JSContext *, PrefetchTable *> prefetch_tables;
+
+static bool
+prefetch_enabled(JSContext *cx)
+{
+    return _gjs_context_prefetch_imports_enabled(cx);
+}
+
+static void
+prefetch_free(void *data)
+{
+    auto prefetch = static_cast<ModulePrefetch *>(data);
+    g_assert(!prefetch->compiling);
+    g_free(prefetch->full_path);
+    g_free(prefetch->source);
+    g_free(prefetch->chars);
+    g_slice_free(ModulePrefetch, prefetch);
+}
+
+static PrefetchTable *
+prefetch_table_ref(PrefetchTable *table)
+{
+    g_atomic_int_inc(&table->ref_count);
+    return table;
+}
+
+static void
+prefetch_table_unref(void *data)
+{
+    auto table = static_cast<PrefetchTable *>(data);
+    if (!g_atomic_int_dec_and_test(&table->ref_count))
+        return;
+
+    g_assert(!table->modules);
+    g_list_free_full(table->incoming.head, prefetch_free);
+    g_slice_free(PrefetchTable, table);
+}
+
+static void
+prefetch_scan_free(void *data)
+{
+    auto scan = static_cast<PrefetchScan *>(data);
+    prefetch_table_unref(scan->table);
+    g_ptr_array_unref(scan->dirs);
+    g_free(scan->source);
+    g_hash_table_unref(scan->known);
+    g_slice_free(PrefetchScan, scan);
+}
+
+static void
+prefetch_finished(void *token,
+                  void *data)
+{
+    auto prefetch = static_cast<ModulePrefetch *>(data);
+
+    g_mutex_lock(&prefetch_lock);
+    prefetch->token = token;
+    prefetch->done = true;
+    g_cond_broadcast(&prefetch_cond);
+    g_mutex_unlock(&prefetch_lock);
+}
+
+static void *
+prefetch_wait(ModulePrefetch *prefetch)
+{
+    g_mutex_lock(&prefetch_lock);
+    while (!prefetch->done)
+        g_cond_wait(&prefetch_cond, &prefetch_lock);
+    g_mutex_unlock(&prefetch_lock);
+
+    prefetch->compiling = false;
+    g_clear_pointer(&prefetch->chars, g_free);
+    return prefetch->token;
+}
+
+static PrefetchTable *
+prefetch_table_lookup(JSContext *cx)
+{
+    g_mutex_lock(&prefetch_lock);
+    auto iter = prefetch_tables.find(cx);
+    PrefetchTable *table = iter == prefetch_tables.end() ? nullptr : iter->second;
+    g_mutex_unlock(&prefetch_lock);
+    return table;
+}
+
+static PrefetchTable *
+prefetch_table(JSContext *cx)
+{
+    g_mutex_lock(&prefetch_lock);
+    PrefetchTable *&table = prefetch_tables[cx];
+    if (!table) {
+        table = g_slice_new0(PrefetchTable);
+        table->ref_count = 1;
+        table->cx = cx;
+        table->modules = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                               nullptr, prefetch_free);
+        g_queue_init(&table->incoming);
+    }
+    PrefetchTable *retval = table;
+    g_mutex_unlock(&prefetch_lock);
+    return retval;
+}
+
+/* Starts compiling @prefetch on a helper thread, if it is worth it */
+static void
+prefetch_compile(JSContext      *cx,
+                 ModulePrefetch *prefetch)
+{
+    if (prefetch->in_module_cache)
+        return;
+
+    JS::CompileOptions options(cx);
+    options.setFileAndLine(prefetch->full_path, prefetch->line_number)
+           .setSourceIsLazy(true);
+
+    long n_chars;
+    prefetch->chars = g_utf8_to_utf16(prefetch->stripped_source,
+                                      glong(prefetch->stripped_len), nullptr,
+                                      &n_chars, nullptr);
+    if (!prefetch->chars || !JS::CanCompileOffThread(cx, options, n_chars))
+        return;
+
+    if (JS::CompileOffThread(cx, options,
+                             reinterpret_cast<char16_t *>(prefetch->chars),
+                             n_chars, prefetch_finished, prefetch)) {
+        gjs_debug(GJS_DEBUG_IMPORTER, "Compiling %s off-thread",
+                  prefetch->full_path);
+        prefetch->compiling = true;
+    } else {
+        JS_ClearPendingException(cx);
+    }
+}
+
+/* Takes the modules that workers have read, and starts compiling them */
+static void
+prefetch_drain(JSContext     *cx,
+               PrefetchTable *table)
+{
+    g_mutex_lock(&prefetch_lock);
+    GList *incoming = table->incoming.head;
+    g_queue_init(&table->incoming);
+    g_mutex_unlock(&prefetch_lock);
+
+    for (GList *l = incoming; l; l = l->next) {
+        auto prefetch = static_cast<ModulePrefetch *>(l->data);
+
+        /* Another scan may have read it too, or it was imported already */
+        if (g_hash_table_contains(table->modules, prefetch->full_path)) {
+            prefetch_free(prefetch);
+            continue;
+        }
+
+        g_hash_table_insert(table->modules, prefetch->full_path, prefetch);
+        GJS_INC_STAT(module_prefetch_read);
+        prefetch_compile(cx, prefetch);
+    }
+    g_list_free(incoming);
+}
+
+static gboolean
+prefetch_drain_idle(void *data)
+{
+    auto table = static_cast<PrefetchTable *>(data);
+
+    g_mutex_lock(&prefetch_lock);
+    table->idle_id = 0;
+    g_mutex_unlock(&prefetch_lock);
+
+    JSContext *cx = table->cx;
+    JSAutoRequest ar(cx);
+    JSAutoCompartment ac(cx, gjs_get_import_global(cx));
+    prefetch_drain(cx, table);
+    return G_SOURCE_REMOVE;
+}
+
+/* Finds the file that imports.@names[0].@names[1]... would load, the way the
+ * importer resolves it: in each directory, a subdirectory takes precedence
+ * over a file, and the first search path directory that has either wins.
+ * Only subdirectories that exist are searched for the next name, and a file
+ * ends the chain, since the rest are properties of that module. Returns NULL
+ * if the chain doesn't name a file. */
+static char *
+prefetch_resolve_import(GPtrArray *search_dirs,
+                        char     **names)
+{
+    GPtrArray *dirs = g_ptr_array_new_with_free_func(g_object_unref);
+    for (unsigned i = 0; i < search_dirs->len; i++) {
+        auto dirname = static_cast<const char *>(search_dirs->pdata[i]);
+        if (*dirname != '\0')
+            g_ptr_array_add(dirs, g_file_new_for_commandline_arg(dirname));
+    }
+
+    char *path = nullptr;
+    for (char **name = names; *name && dirs->len > 0 && !path; name++) {
+        GPtrArray *subdirs = g_ptr_array_new_with_free_func(g_object_unref);
+        GjsAutoChar filename = g_strconcat(*name, ".js", nullptr);
+
+        for (unsigned i = 0; i < dirs->len; i++) {
+            auto dir = static_cast<GFile *>(dirs->pdata[i]);
+            GFile *subdir = g_file_get_child(dir, *name);
+            if (g_file_query_file_type(subdir, G_FILE_QUERY_INFO_NONE,
+                                       nullptr) == G_FILE_TYPE_DIRECTORY) {
+                g_ptr_array_add(subdirs, subdir);
+                continue;
+            }
+            g_object_unref(subdir);
+
+            /* Once a directory is found, files later in the path are
+             * ignored */
+            if (subdirs->len > 0)
+                continue;
+
+            GjsAutoUnref<GFile> file = g_file_get_child(dir, filename);
+            if (g_file_query_file_type(file, G_FILE_QUERY_INFO_NONE,
+                                       nullptr) == G_FILE_TYPE_REGULAR) {
+                path = g_file_get_parse_name(file);
+                break;
+            }
+        }
+
+        g_ptr_array_unref(dirs);
+        dirs = subdirs;
+    }
+
+    g_ptr_array_unref(dirs);
+    return path;
+}
+
+/* Adds the files that the imports.foo.bar references in @source load to
+ * @to_read */
+static void
+prefetch_find_imports(PrefetchScan *scan,
+                      const char   *source,
+                      size_t        source_len,
+                      GQueue       *to_read)
+{
+    static GRegex *imports_regex;
+    if (g_once_init_enter(&imports_regex)) {
+        GRegex *regex = g_regex_new(
+            "(?<![\\w$.])imports((?:\\.[A-Za-z_$][\\w$]*)+)",
+            G_REGEX_OPTIMIZE, GRegexMatchFlags(0), nullptr);
+        g_once_init_leave(&imports_regex, regex);
+    }
+
+    GMatchInfo *match;
+    g_regex_match_full(imports_regex, source, source_len, 0,
+                       GRegexMatchFlags(0), &match, nullptr);
+    for (; g_match_info_matches(match); g_match_info_next(match, nullptr)) {
+        GjsAutoChar chain = g_match_info_fetch(match, 1);
+        char **names = g_strsplit(chain.get() + 1, ".", -1);
+
+        /* GI namespaces and importer properties aren't files */
+        if (!names[0] || strcmp(names[0], "gi") == 0 ||
+            g_str_has_prefix(names[0], "__") ||
+            strcmp(names[0], "searchPath") == 0) {
+            g_strfreev(names);
+            continue;
+        }
+
+        char *path = prefetch_resolve_import(scan->dirs, names);
+        if (path)
+            g_queue_push_tail(to_read, path);
+        g_strfreev(names);
+    }
+    g_match_info_free(match);
+}
+
+/* Runs on a worker thread. Reads the module at @path, unless it was read
+ * already, and adds the modules that it refers to to @to_read. Returns false
+ * if the scan was cancelled. */
+static bool
+prefetch_read_module(PrefetchScan *scan,
+                     const char   *path,
+                     GQueue       *to_read)
+{
+    GjsAutoUnref<GFile> file = g_file_new_for_commandline_arg(path);
+    char *full_path = g_file_get_parse_name(file);
+    if (g_hash_table_contains(scan->known, full_path)) {
+        g_free(full_path);
+        return true;
+    }
+    g_hash_table_add(scan->known, full_path);
+
+    char *source;
+    size_t len;
+    char *unowned_etag;
+    if (!g_file_load_contents(file, nullptr, &source, &len, &unowned_etag,
+                              nullptr))
+        return true;
+    GjsAutoChar etag = unowned_etag;
+
+    ModulePrefetch *prefetch = g_slice_new0(ModulePrefetch);
+    prefetch->full_path = g_strdup(full_path);
+    prefetch->source = source;
+    prefetch->line_number = 1;
+    prefetch->stripped_source =
+        gjs_strip_unix_shebang(source, &len, &prefetch->line_number);
+    prefetch->stripped_len = len;
+
+    if (scan->check_module_cache) {
+        GjsAutoChar cache_path = module_cache_path(full_path);
+        GjsAutoChar key = module_cache_key(full_path, etag,
+                                           prefetch->stripped_source, len);
+        prefetch->in_module_cache = module_cache_is_valid(cache_path, key);
+    }
+
+    /* Scan before handing the module over; the main thread frees the source
+     * once it is imported */
+    prefetch_find_imports(scan, prefetch->stripped_source, len, to_read);
+
+    PrefetchTable *table = scan->table;
+    g_mutex_lock(&prefetch_lock);
+    bool cancelled = table->cancelled;
+    if (!cancelled) {
+        g_queue_push_tail(&table->incoming, prefetch);
+        if (!table->idle_id)
+            table->idle_id = g_idle_add_full(G_PRIORITY_DEFAULT_IDLE,
+                                             prefetch_drain_idle,
+                                             prefetch_table_ref(table),
+                                             prefetch_table_unref);
+    }
+    g_mutex_unlock(&prefetch_lock);
+
+    if (cancelled)
+        prefetch_free(prefetch);
+    return !cancelled;
+}
+
+/* Runs on a worker thread. Reads every module that the source refers to,
+ * and every module that those refer to in turn. */
+static void
+prefetch_scan_thread(GTask        *task,
+                     void         *source_object,
+                     void         *data,
+                     GCancellable *cancellable)
+{
+    auto scan = static_cast<PrefetchScan *>(data);
+
+    GQueue to_read = G_QUEUE_INIT;
+    prefetch_find_imports(scan, scan->source, scan->source_len, &to_read);
+
+    char *path;
+    while ((path = static_cast<char *>(g_queue_pop_head(&to_read)))) {
+        bool cancelled = !prefetch_read_module(scan, path, &to_read);
+        g_free(path);
+        if (cancelled)
+            break;
+    }
+    g_list_free_full(to_read.head, g_free);
+}
+
+static bool
+prefetch_search_path(JSContext *cx,
+                     GPtrArray *dirs)
+{
+    JS::RootedObject importer(cx,
+        &gjs_get_global_slot(cx, GJS_GLOBAL_SLOT_IMPORTS).toObject());
+    JS::RootedObject search_path(cx);
+    uint32_t len;
+    if (!gjs_object_require_property(cx, importer, "importer",
+                                     GJS_STRING_SEARCH_PATH, &search_path) ||
+        !JS_GetArrayLength(cx, search_path, &len))
+        return false;
+
+    JS::RootedValue elem(cx);
+    for (uint32_t i = 0; i < len; i++) {
+        GjsAutoJSChar dirname(cx);
+        if (!JS_GetElement(cx, search_path, i, &elem))
+            return false;
+        if (!elem.isString())
+            continue;
+        if (!gjs_string_to_utf8(cx, elem, &dirname))
+            return false;
+        g_ptr_array_add(dirs, g_strdup(dirname));
+    }
+    return true;
+}
+
+/* Starts prefetching every module that @source refers to, and every module
+ * that those refer to in turn */
+static void
+prefetch_dependencies(JSContext  *cx,
+                      const char *source,
+                      size_t      source_len)
+{
+    GPtrArray *dirs = g_ptr_array_new_with_free_func(g_free);
+    if (!prefetch_search_path(cx, dirs)) {
+        JS_ClearPendingException(cx);
+        g_ptr_array_unref(dirs);
+        return;
+    }
+
+    PrefetchTable *table = prefetch_table(cx);
+    prefetch_drain(cx, table);
+
+    PrefetchScan *scan = g_slice_new0(PrefetchScan);
+    scan->table = prefetch_table_ref(table);
+    scan->dirs = dirs;
+    scan->source = g_strndup(source, source_len);
+    scan->source_len = source_len;
+    scan->check_module_cache = module_cache_enabled(cx);
+    scan->known = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                                        nullptr);
+    GHashTableIter iter;
+    void *path;
+    g_hash_table_iter_init(&iter, table->modules);
+    while (g_hash_table_iter_next(&iter, &path, nullptr))
+        g_hash_table_add(scan->known, g_strdup(static_cast<char *>(path)));
+
+    GTask *task = g_task_new(nullptr, nullptr, nullptr, nullptr);
+    g_task_set_task_data(task, scan, prefetch_scan_free);
+    g_task_run_in_thread(task, prefetch_scan_thread);
+    g_object_unref(task);
+}
+
+/* Picks up the script compiled off-thread for @filename, if there is one
+ * and it was compiled from the same source */
+static bool
+prefetch_take(JSContext             *cx,
+              const char            *filename,
+              const char            *source,
+              size_t                 source_len,
+              JS::MutableHandleScript script)
+{
+    PrefetchTable *table = prefetch_table_lookup(cx);
+    if (!table)
+        return false;
+    prefetch_drain(cx, table);
+
+    auto prefetch = static_cast<ModulePrefetch *>(
+        g_hash_table_lookup(table->modules, filename));
+    if (!prefetch) {
+        /* Imported before a scan read it; make sure none ever compiles it */
+        prefetch = g_slice_new0(ModulePrefetch);
+        prefetch->full_path = g_strdup(filename);
+        g_hash_table_insert(table->modules, prefetch->full_path, prefetch);
+        return false;
+    }
+    if (!prefetch->source)
+        return false;
+
+    /* The source is only needed until the module is imported; the entry
+     * stays, so that the module isn't prefetched again */
+    GjsAutoChar prefetched_source = prefetch->source;
+    prefetch->source = nullptr;
+    bool same_source = prefetch->stripped_len == source_len &&
+        memcmp(prefetch->stripped_source, source, source_len) == 0;
+    prefetch->stripped_source = nullptr;
+    prefetch->stripped_len = 0;
+
+    if (!prefetch->compiling)
+        return false;
+
+    void *token = prefetch_wait(prefetch);
+    if (!same_source) {
+        GJS_INC_STAT(module_prefetch_miss);
+        JS::CancelOffThreadScript(cx, token);
+        return false;
+    }
+
+    script.set(JS::FinishOffThreadScript(cx, token));
+    if (!script) {
+        /* Compile again on the main thread to report the error */
+        JS_ClearPendingException(cx);
+        return false;
+    }
+
+    GJS_INC_STAT(module_prefetch_hit);
+    return true;
+}
+
+/**
+ * gjs_module_cancel_prefetches:
+ * @cx: the JS context
+ *
+ * Cancels the scans for modules to prefetch for @cx, waits for any modules
+ * still being compiled off-thread for @cx and discards them. Must be called
+ * before destroying @cx.
+ */
+void
+gjs_module_cancel_prefetches(JSContext *cx)
+{
+    g_mutex_lock(&prefetch_lock);
+    auto iter = prefetch_tables.find(cx);
+    if (iter == prefetch_tables.end()) {
+        g_mutex_unlock(&prefetch_lock);
+        return;
+    }
+    PrefetchTable *table = iter->second;
+    prefetch_tables.erase(iter);
+
+    /* Scans still running on worker threads hold a reference to the table,
+     * and stop at the next module they read */
+    table->cancelled = true;
+    if (table->idle_id) {
+        g_source_remove(table->idle_id);
+        table->idle_id = 0;
+    }
+    g_list_free_full(table->incoming.head, prefetch_free);
+    g_queue_init(&table->incoming);
+    g_mutex_unlock(&prefetch_lock);
+
+    GHashTableIter hash_iter;
+    void *value;
+    g_hash_table_iter_init(&hash_iter, table->modules);
+    while (g_hash_table_iter_next(&hash_iter, nullptr, &value)) {
+        auto prefetch = static_cast<ModulePrefetch *>(value);
+        if (prefetch->compiling)
+            JS::CancelOffThreadScript(cx, prefetch_wait(prefetch));
+    }
+
+    g_clear_pointer(&table->modules, g_hash_table_destroy);
+    prefetch_table_unref(table);
+}
+
 class GjsModule {
     char *m_name;
 
@@ -77,6 +804,49 @@ class GjsModule {
         return true;
     }
 
+    /* Compiles the module code, or loads it from the cache if @etag and
+     * the source match the cached copy */
+    bool
+    compile_import(JSContext             *cx,
+                   const char            *script,
+                   size_t                 script_len,
+                   const char            *filename,
+                   int                    line_number,
+                   const char            *etag,
+                   JS::MutableHandleScript compiled_script)
+    {
+        GjsAutoChar cache_path, key;
+        if (module_cache_enabled(cx)) {
+            cache_path = module_cache_path(filename);
+            key = module_cache_key(filename, etag, script, script_len);
+            if (module_cache_load(cx, cache_path, key, compiled_script)) {
+                gjs_debug(GJS_DEBUG_IMPORTER, "Loaded module %s from cache",
+                          m_name);
+                return true;
+            }
+        }
+
+        if (prefetch_take(cx, filename, script, script_len, compiled_script)) {
+            gjs_debug(GJS_DEBUG_IMPORTER, "Using module %s compiled off-thread",
+                      m_name);
+        } else {
+            JS::CompileOptions options(cx);
+            options.setUTF8(true)
+                   .setFileAndLine(filename, line_number)
+                   .setSourceIsLazy(true);
+
+            if (!JS::Compile(cx, options, script, script_len, compiled_script))
+                return false;
+        }
+
+        /* Has to happen before executing; run-once scripts can't be encoded
+         * after they have run */
+        if (cache_path)
+            module_cache_store(cx, cache_path, key, compiled_script);
+
+        return true;
+    }
+
     /* Carries out the actual execution of the module code */
     bool
     evaluate_import(JSContext       *cx,
@@ -84,15 +854,12 @@ class GjsModule {
                     const char      *script,
                     size_t           script_len,
                     const char      *filename,
-                    int              line_number)
+                    int              line_number,
+                    const char      *etag = nullptr)
     {
-        JS::CompileOptions options(cx);
-        options.setUTF8(true)
-               .setFileAndLine(filename, line_number)
-               .setSourceIsLazy(true);
-
         JS::RootedScript compiled_script(cx);
-        if (!JS::Compile(cx, options, script, script_len, &compiled_script))
+        if (!compile_import(cx, script, script_len, filename, line_number,
+                            etag, &compiled_script))
             return false;
 
         JS::AutoObjectVector scope_chain(cx);
@@ -115,25 +882,29 @@ class GjsModule {
                 GFile           *file)
     {
         GError *error = nullptr;
-        char *unowned_script;
+        char *unowned_script, *unowned_etag = nullptr;
         size_t script_len = 0;
         int start_line_number = 1;
 
         if (!(g_file_load_contents(file, nullptr, &unowned_script, &script_len,
-                                   nullptr, &error))) {
+                                   &unowned_etag, &error))) {
             gjs_throw_g_error(cx, error);
             return false;
         }
 
         GjsAutoChar script = unowned_script;  /* steals ownership */
+        GjsAutoChar etag = unowned_etag;
         g_assert(script != nullptr);
 
         const char *stripped_script =
             gjs_strip_unix_shebang(script, &script_len, &start_line_number);
 
+        if (prefetch_enabled(cx))
+            prefetch_dependencies(cx, stripped_script, script_len);
+
         GjsAutoChar full_path = g_file_get_parse_name(file);
         return evaluate_import(cx, module, stripped_script, script_len,
-                               full_path, start_line_number);
+                               full_path, start_line_number, etag);
     }
 
     /* JSClass operations */
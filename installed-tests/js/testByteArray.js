@@ -1,4 +1,5 @@
 const ByteArray = imports.byteArray;
+const GLib = imports.gi.GLib;
 
 describe('Byte array', function () {
     it('has length 0 for empty array', function () {
@@ -128,4 +129,65 @@ describe('Byte array', function () {
         expect(s.length).toEqual(4);
         expect(s).toEqual('abcd');
     });
+
+    describe('buffer', function () {
+        it('shares the contents with typed array views', function () {
+            let a = ByteArray.fromArray([1, 2, 3, 4]);
+            let view = new Uint8Array(a.buffer);
+            expect(a.buffer).toBe(a.buffer);
+            expect(view.length).toEqual(4);
+            view[0] = 42;
+            expect(a[0]).toEqual(42);
+            a[1] = 43;
+            expect(view[1]).toEqual(43);
+            expect(a.toString()).toEqual('*+\x03\x04');
+        });
+
+        it('stays valid after the ByteArray is resized', function () {
+            let a = ByteArray.fromArray([1, 2, 3, 4]);
+            let view = new Uint8Array(a.buffer);
+            a.length = 10;
+            expect(view.length).toEqual(4);
+            view[0] = 42;
+            expect(a[0]).toEqual(1);
+            expect(new Uint8Array(a.buffer).length).toEqual(10);
+        });
+
+        it('gives toGBytes() a copy that later writes do not change', function () {
+            let a = ByteArray.fromArray([1, 2, 3, 4]);
+            let view = new Uint8Array(a.buffer);
+            view[2] = 42;
+            let bytes = a.toGBytes();
+            expect(bytes.get_data()[2]).toEqual(42);
+            view[2] = 43;
+            a[3] = 44;
+            expect(bytes.get_data()[2]).toEqual(42);
+            expect(bytes.get_data()[3]).toEqual(4);
+        });
+
+        it('does not write to a GBytes returned by toGBytes()', function () {
+            let a = ByteArray.fromArray([1, 2, 3, 4]);
+            let bytes = a.toGBytes();
+            let view = new Uint8Array(a.buffer);
+            view[0] = 42;
+            a[1] = 43;
+            expect(a[0]).toEqual(42);
+            expect(bytes.get_data()[0]).toEqual(1);
+            expect(bytes.get_data()[1]).toEqual(2);
+        });
+
+        it('does not write to a GBytes passed to fromGBytes()', function () {
+            let bytes = GLib.Bytes.new([1, 2, 3, 4]);
+            let a = ByteArray.fromGBytes(bytes);
+            let view = new Uint8Array(a.buffer);
+            view[0] = 42;
+            expect(a[0]).toEqual(42);
+            expect(bytes.get_data()[0]).toEqual(1);
+        });
+
+        it('is empty for an empty ByteArray', function () {
+            let a = new ByteArray.ByteArray();
+            expect(a.buffer.byteLength).toEqual(0);
+        });
+    });
 });
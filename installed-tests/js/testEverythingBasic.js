@@ -6,6 +6,7 @@ const GLib = imports.gi.GLib;
 const Gio = imports.gi.Gio;
 const GObject = imports.gi.GObject;
 const Lang = imports.lang;
+const System = imports.system;
 
 describe('Life, the Universe and Everything', function () {
     it('includes booleans', function () {
@@ -241,6 +242,22 @@ describe('Life, the Universe and Everything', function () {
         expect(Regress.test_callback_thaw_async()).toEqual(44);
     });
 
+    it('reuses the trampoline of a finished callback', function () {
+        Regress.test_callback(() => 1);
+        let hits = System.getStatistics().trampoline_pool_hit;
+        expect(Regress.test_callback(() => 2)).toEqual(2);
+        expect(System.getStatistics().trampoline_pool_hit).toEqual(hits + 1);
+    });
+
+    it('reuses the trampoline of a finished async callback', function () {
+        Regress.test_callback_async(() => 44);
+        Regress.test_callback_thaw_async();
+        let hits = System.getStatistics().trampoline_pool_hit;
+        Regress.test_callback_async(() => 45);
+        expect(System.getStatistics().trampoline_pool_hit).toEqual(hits + 1);
+        expect(Regress.test_callback_thaw_async()).toEqual(45);
+    });
+
     describe('GValue boxing and unboxing', function () {
         it('integer in', function () {
             expect(Regress.test_int_value_arg(42)).toEqual(42);
@@ -302,6 +319,19 @@ describe('Life, the Universe and Everything', function () {
         });
     });
 
+    it('typed arrays for arrays of numbers in', function () {
+        expect(Regress.test_array_int_in(new Int32Array([1, 2, 3, 4]))).toEqual(10);
+        expect(Regress.test_array_gint8_in(new Int8Array([1, 2, 3, 4]))).toEqual(10);
+        expect(Regress.test_array_gint16_in(new Int16Array([1, 2, 3, 4]))).toEqual(10);
+        expect(Regress.test_array_gint32_in(new Int32Array([1, 2, 3, 4]))).toEqual(10);
+        expect(Regress.test_array_gint32_in(new Int32Array(0))).toEqual(0);
+    });
+
+    it('typed arrays with a different element type are converted', function () {
+        expect(Regress.test_array_int_in(new Float64Array([1, 2, 3, 4]))).toEqual(10);
+        expect(Regress.test_array_gint16_in(new Uint8Array([1, 2, 3, 4]))).toEqual(10);
+    });
+
     it('implicit conversions from strings to int arrays', function () {
         expect(Regress.test_array_gint8_in("\x01\x02\x03\x04")).toEqual(10);
         expect(Regress.test_array_gint16_in("\x01\x02\x03\x04")).toEqual(10);
@@ -453,6 +483,23 @@ describe('Life, the Universe and Everything', function () {
             o.emit_sig_with_array_len_prop();
         });
 
+        it('signal with array len parameter is marshalled the same way every time', function () {
+            let handler1 = jasmine.createSpy('handler1');
+            let handler2 = jasmine.createSpy('handler2');
+            o.connect('sig-with-array-len-prop', handler1);
+            o.connect('sig-with-array-len-prop', handler2);
+            o.emit_sig_with_array_len_prop();
+            o.emit_sig_with_array_len_prop();
+            expect(handler1.calls.count()).toEqual(2);
+            expect(handler2.calls.count()).toEqual(2);
+            [handler1, handler2].forEach(handler => {
+                handler.calls.allArgs().forEach(args => {
+                    expect(args.length).toEqual(2);
+                    expect(args[1]).toEqual([0, 1, 2, 3, 4]);
+                });
+            });
+        });
+
         xit('can pass parameter to signal with array len parameter via emit', function () {
             o.connect('sig-with-array-len-prop', (signalObj, signalArray) => {
                 expect(signalArray).toEqual([0, 1, 2, 3, 4]);
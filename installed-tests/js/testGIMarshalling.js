@@ -658,3 +658,28 @@ describe('GObject properties', function () {
         expect(obj.some_gvalue).toEqual('foo');
     });
 });
+
+describe('Enum and flags', function () {
+    it('accept values that are not contiguous', function () {
+        expect(() => GIMarshallingTests.genum_in(GIMarshallingTests.GEnum.VALUE3))
+            .not.toThrow();
+        expect(() => GIMarshallingTests.enum_in(GIMarshallingTests.Enum.VALUE3))
+            .not.toThrow();
+    });
+
+    it('reject values that are not part of the enumeration', function () {
+        expect(() => GIMarshallingTests.genum_in(41)).toThrow();
+        expect(() => GIMarshallingTests.genum_in(43)).toThrow();
+        expect(() => GIMarshallingTests.enum_in(-1)).toThrow();
+    });
+
+    it('accept combinations of flags', function () {
+        expect(() => GIMarshallingTests.flags_in_zero(0)).not.toThrow();
+        expect(() => GIMarshallingTests.flags_in(GIMarshallingTests.Flags.VALUE2))
+            .not.toThrow();
+    });
+
+    it('reject bits that are not flags', function () {
+        expect(() => GIMarshallingTests.flags_in(1 << 20)).toThrow();
+    });
+});
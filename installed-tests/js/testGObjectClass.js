@@ -240,6 +240,18 @@ describe('GObject class', function () {
         expect(minimalSpy).toHaveBeenCalledWith(myInstance, 7, 5);
     });
 
+    it('passes arguments correctly when a signal is emitted from its own handler', function () {
+        let calls = [];
+        myInstance.connect('minimal', (obj, one, two) => {
+            calls.push([one, two]);
+            if (one > 0)
+                myInstance.emit_minimal(one - 1, two * 2);
+            calls.push([one, two]);
+        });
+        myInstance.emit_minimal(1, 3);
+        expect(calls).toEqual([[1, 3], [0, 6], [0, 6], [1, 3]]);
+    });
+
     it('can return values from signals', function () {
         let fullSpy = jasmine.createSpy('fullSpy').and.returnValue(42);
         myInstance.connect('full', fullSpy);
@@ -356,3 +368,28 @@ describe('GObject class', function () {
         })).toThrow();
     });
 });
+
+describe('GObject properties', function () {
+    it('are accessors on the prototype', function () {
+        let action = new Gio.SimpleAction({ name: 'foo' });
+        expect(action.enabled).toBeTruthy();
+        action.enabled = false;
+        expect(action.enabled).toBeFalsy();
+        expect(action.hasOwnProperty('enabled')).toBeFalsy();
+        let descriptor = Object.getOwnPropertyDescriptor(
+            Gio.SimpleAction.prototype, 'enabled');
+        expect(typeof descriptor.get).toEqual('function');
+        expect(typeof descriptor.set).toEqual('function');
+    });
+
+    it('are read through camel case and underscore names', function () {
+        let action = new Gio.SimpleAction({ name: 'foo' });
+        expect(action.parameterType).toBeNull();
+        expect(action.parameter_type).toBeNull();
+    });
+
+    it('throw when writing a read-only property', function () {
+        let action = new Gio.SimpleAction({ name: 'foo' });
+        expect(() => { action.stateType = null; }).toThrow();
+    });
+});
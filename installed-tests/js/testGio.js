@@ -27,4 +27,44 @@ describe('ListStore iterator', function () {
             expect(f.value).toBe(i++);
         }
     });
-});
\ No newline at end of file
+});
+
+describe('Async functions called without a callback', function () {
+    const GLib = imports.gi.GLib;
+
+    it('return a promise for the result of the finish function', function (done) {
+        let file = Gio.File.new_for_path('.');
+        file.query_info_async('standard::type', Gio.FileQueryInfoFlags.NONE,
+            GLib.PRIORITY_DEFAULT, null).then(info => {
+                expect(info.get_file_type()).toEqual(Gio.FileType.DIRECTORY);
+                done();
+            });
+    });
+
+    it('reject the promise with the error of the finish function', function (done) {
+        let file = Gio.File.new_for_path('/nonexistent/file');
+        file.load_contents_async(null).catch(e => {
+            expect(e.matches(Gio.IOErrorEnum, Gio.IOErrorEnum.NOT_FOUND)).toBeTruthy();
+            done();
+        });
+    });
+
+    it('still call a callback when given one', function (done) {
+        let file = Gio.File.new_for_path('.');
+        let retval = file.query_info_async('standard::type',
+            Gio.FileQueryInfoFlags.NONE, GLib.PRIORITY_DEFAULT, null,
+            (obj, res) => {
+                expect(obj.query_info_finish(res).get_file_type())
+                    .toEqual(Gio.FileType.DIRECTORY);
+                done();
+            });
+        expect(retval).toBeUndefined();
+    });
+
+    it('only return a promise when the callback is left out', function () {
+        let file = Gio.File.new_for_path('.');
+        expect(() => file.query_info_async('standard::type',
+            Gio.FileQueryInfoFlags.NONE, GLib.PRIORITY_DEFAULT, null,
+            undefined)).toThrow();
+    });
+});
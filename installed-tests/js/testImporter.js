@@ -221,4 +221,57 @@ describe('Importer', function () {
             expect(keys).not.toContain('searchPath');
         });
     });
+
+    describe('with a search path directory that changes', function () {
+        const GLib = imports.gi.GLib;
+        let tmpDir;
+
+        beforeEach(function () {
+            tmpDir = GLib.dir_make_tmp('gjs-importer-XXXXXX');
+            imports.searchPath.unshift(tmpDir);
+        });
+
+        afterEach(function () {
+            imports.searchPath.shift();
+            GLib.unlink(`${tmpDir}/lateModule.js`);
+            GLib.unlink(`${tmpDir}/clearedModule.js`);
+            GLib.unlink(`${tmpDir}/clearCache.js`);
+            GLib.rmdir(tmpDir);
+        });
+
+        it('finds a module added after a failed import', function () {
+            expect(() => imports.lateModule)
+                .toThrow(jasmine.objectContaining({ name: 'ImportError' }));
+            GLib.file_set_contents(`${tmpDir}/lateModule.js`, 'var late = true;');
+            expect(imports.lateModule.late).toBeTruthy();
+        });
+
+        it('finds a module after clearing the cache', function () {
+            const Gio = imports.gi.Gio;
+            const System = imports.system;
+
+            // Hide the change from the mtime check: keep the directory's
+            // mtime in the past, at the same value before and after
+            let dir = Gio.File.new_for_path(tmpDir);
+            let mtime = Math.floor(Date.now() / 1000) - 100;
+            let setMtime = () => dir.set_attribute_uint64('time::modified',
+                mtime, Gio.FileQueryInfoFlags.NONE, null);
+
+            setMtime();
+            expect(() => imports.clearedModule)
+                .toThrow(jasmine.objectContaining({ name: 'ImportError' }));
+            GLib.file_set_contents(`${tmpDir}/clearedModule.js`, 'var cleared = true;');
+            setMtime();
+            expect(() => imports.clearedModule)
+                .toThrow(jasmine.objectContaining({ name: 'ImportError' }));
+
+            System.clearImportCache();
+            expect(imports.clearedModule.cleared).toBeTruthy();
+        });
+
+        it('resolves a module named clearCache', function () {
+            GLib.file_set_contents(`${tmpDir}/clearCache.js`, 'var found = true;');
+            expect(imports.clearCache.found).toBeTruthy();
+        });
+    });
 });
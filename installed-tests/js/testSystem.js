@@ -1,4 +1,5 @@
 const System = imports.system;
+const GLib = imports.gi.GLib;
 const GObject = imports.gi.GObject;
 
 describe('System.addressOf()', function () {
@@ -28,3 +29,69 @@ describe('System.gc()', function () {
         expect(System.gc).not.toThrow();
     });
 });
+
+describe('System.getStatistics()', function () {
+    it('reports the cache and pool counters', function () {
+        let stats = System.getStatistics();
+        expect(typeof stats.trampoline_pool_hit).toEqual('number');
+        expect(typeof stats.trampoline_pool_miss).toEqual('number');
+    });
+
+    it('counts small structs that only get pinned when C needs them', function () {
+        let before = System.getStatistics();
+        let tv = new GLib.TimeVal();
+        tv.tv_sec = 5;
+        expect(tv.tv_sec).toEqual(5);
+        let middle = System.getStatistics();
+        expect(middle.boxed_nursery_alloc).toBeGreaterThan(before.boxed_nursery_alloc);
+        expect(middle.boxed_nursery_pin).toEqual(before.boxed_nursery_pin);
+
+        tv.add(1000000);
+        expect(tv.tv_sec).toEqual(6);
+        let after = System.getStatistics();
+        expect(after.boxed_nursery_pin).toBeGreaterThan(middle.boxed_nursery_pin);
+    });
+
+    it('counts type names that are found in the string cache', function () {
+        let before = System.getStatistics();
+        let names = [1, 2, 3].map(() => GObject.TYPE_OBJECT.name);
+        let after = System.getStatistics();
+        expect(names).toEqual(['GObject', 'GObject', 'GObject']);
+        expect(after.string_cache_hit).toBeGreaterThan(before.string_cache_hit);
+    });
+
+    it('counts property names that are found in the string cache', function () {
+        let pspec = GObject.ParamSpec.string('cached-name', 'Cached name',
+            'A property name', GObject.ParamFlags.READABLE, '');
+        let before = System.getStatistics();
+        let names = [1, 2, 3].map(() => pspec.name);
+        let after = System.getStatistics();
+        expect(names).toEqual(['cached-name', 'cached-name', 'cached-name']);
+        expect(after.string_cache_hit).toBeGreaterThan(before.string_cache_hit);
+    });
+
+    it('does not put strings returned by C functions in the string cache', function () {
+        let before = System.getStatistics();
+        GObject.type_name(GObject.TYPE_OBJECT);
+        GLib.get_home_dir();
+        GLib.get_home_dir();
+        let after = System.getStatistics();
+        expect(after.string_cache_hit).toEqual(before.string_cache_hit);
+        expect(after.string_cache_miss).toEqual(before.string_cache_miss);
+    });
+});
+
+describe('System.getGCStatistics()', function () {
+    it('counts collections and their pauses', function () {
+        System.gc();
+        let stats = System.getGCStatistics();
+        expect(stats.cycles).toBeGreaterThan(0);
+        expect(stats.slices).toBeGreaterThan(0);
+        expect(stats.maxPauseMs).toBeLessThanOrEqual(stats.totalPauseMs);
+
+        let histogram = stats.pauseHistogram;
+        expect(histogram[histogram.length - 1].upToMs).toEqual(Infinity);
+        let total = histogram.reduce((sum, bucket) => sum + bucket.count, 0);
+        expect(total).toEqual(stats.slices);
+    });
+});
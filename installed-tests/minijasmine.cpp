@@ -32,6 +32,7 @@
 
 #include "gjs/gjs.h"
 #include "gjs/mem.h"
+#include "test/gjs-test-tmp-dir.h"
 
 G_GNUC_NORETURN
 static void
@@ -54,6 +55,15 @@ main(int argc, char **argv)
     /* Jasmine library has some code style nits that trip this */
     g_setenv("GJS_DISABLE_EXTRA_WARNINGS", "1", false);
 
+    /* Keep compiled modules out of the user's cache directory */
+    char *module_cache_dir = NULL;
+    if (!g_getenv("GJS_MODULE_CACHE_DIR")) {
+        module_cache_dir = g_dir_make_tmp("gjs-minijasmine-cache-XXXXXX",
+                                          NULL);
+        if (module_cache_dir)
+            g_setenv("GJS_MODULE_CACHE_DIR", module_cache_dir, true);
+    }
+
     setlocale(LC_ALL, "");
 
     if (g_getenv("GJS_USE_UNINSTALLED_FILES") != NULL) {
@@ -131,6 +141,11 @@ main(int argc, char **argv)
     g_object_unref(cx);
     gjs_memory_report("after destroying context", true);
 
+    if (module_cache_dir) {
+        gjs_test_remove_tmp_dir(module_cache_dir);
+        g_free(module_cache_dir);
+    }
+
     /* For TAP, should actually be return 0; as a nonzero return code would
      * indicate an error in the test harness. But that would be quite silly
      * when running the tests outside of the TAP driver. */
@@ -6,6 +6,13 @@ else
     gjs="gjs-console"
 fi
 
+# Keep compiled modules out of the user's cache directory
+if test -z "$GJS_MODULE_CACHE_DIR"; then
+    GJS_MODULE_CACHE_DIR=$(mktemp -d)
+    export GJS_MODULE_CACHE_DIR
+    trap 'rm -rf "$GJS_MODULE_CACHE_DIR"' EXIT
+fi
+
 # This JS script should exit immediately with code 42. If that is not working,
 # then it will exit after 3 seconds as a fallback, with code 0.
 cat <<EOF >exit.js
@@ -354,9 +354,6 @@ function _init() {
     this.ParamSpec.override = Gi.override_property;
 
     Object.defineProperties(this.ParamSpec.prototype, {
-        'name': { configurable: false,
-                  enumerable: false,
-                  get: function() { return this.get_name() } },
         '_nick': { configurable: false,
                    enumerable: false,
                    get: function() { return this.get_nick() } },
@@ -24,6 +24,7 @@
 
 #include <config.h>
 
+#include <math.h>
 #include <sys/types.h>
 #include <time.h>
 
@@ -34,7 +35,10 @@
 
 #include "gi/object.h"
 #include "gjs/context-private.h"
+#include "gjs/gc-scheduler.h"
+#include "gjs/importer.h"
 #include "gjs/jsapi-util-args.h"
+#include "gjs/mem.h"
 #include "system.h"
 
 /* Note that this cannot be relied on to test whether two objects are the same!
@@ -170,6 +174,103 @@ gjs_clear_date_caches(JSContext *context,
     return true;
 }
 
+static bool
+gjs_clear_import_cache(JSContext *context,
+                       unsigned   argc,
+                       JS::Value *vp)
+{
+    JS::CallArgs argv = JS::CallArgsFromVp(argc, vp);
+    if (!gjs_parse_call_args(context, "clearImportCache", argv, ""))
+        return false;
+
+    gjs_importer_clear_cache();
+
+    argv.rval().setUndefined();
+    return true;
+}
+
+static bool
+gjs_get_statistics(JSContext *cx,
+                   unsigned   argc,
+                   JS::Value *vp)
+{
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    if (!gjs_parse_call_args(cx, "getStatistics", args, ""))
+        return false;
+
+    JS::RootedObject stats(cx, JS_NewPlainObject(cx));
+    if (!stats)
+        return false;
+
+    unsigned n_counters;
+    GjsStatCounter * const *counters = gjs_get_stat_counters(&n_counters);
+    for (unsigned i = 0; i < n_counters; i++) {
+        if (!JS_DefineProperty(cx, stats, counters[i]->name,
+                               double(counters[i]->value), JSPROP_ENUMERATE))
+            return false;
+    }
+
+    args.rval().setObject(*stats);
+    return true;
+}
+
+static bool
+gjs_get_gc_statistics(JSContext *cx,
+                      unsigned   argc,
+                      JS::Value *vp)
+{
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    if (!gjs_parse_call_args(cx, "getGCStatistics", args, ""))
+        return false;
+
+    GjsGCScheduler *scheduler = gjs_gc_get_scheduler(cx);
+    if (!scheduler) {
+        args.rval().setNull();
+        return true;
+    }
+    const GjsGCStats& gc_stats = scheduler->stats();
+
+    JS::RootedObject stats(cx, JS_NewPlainObject(cx));
+    if (!stats ||
+        !JS_DefineProperty(cx, stats, "cycles", double(gc_stats.n_cycles),
+                           JSPROP_ENUMERATE) ||
+        !JS_DefineProperty(cx, stats, "slices", double(gc_stats.n_slices),
+                           JSPROP_ENUMERATE) ||
+        !JS_DefineProperty(cx, stats, "pressureEvents",
+                           double(gc_stats.n_pressure_events),
+                           JSPROP_ENUMERATE) ||
+        !JS_DefineProperty(cx, stats, "totalPauseMs",
+                           gc_stats.total_pause_us / 1000.0, JSPROP_ENUMERATE) ||
+        !JS_DefineProperty(cx, stats, "maxPauseMs",
+                           gc_stats.max_pause_us / 1000.0, JSPROP_ENUMERATE))
+        return false;
+
+    /* One {upToMs, count} entry per bucket, see GJS_GC_PAUSE_BUCKETS */
+    JS::RootedObject histogram(cx, JS_NewArrayObject(cx, GJS_GC_PAUSE_BUCKETS));
+    if (!histogram)
+        return false;
+    JS::RootedObject bucket(cx);
+    for (unsigned i = 0; i < GJS_GC_PAUSE_BUCKETS; i++) {
+        double up_to_ms = i == GJS_GC_PAUSE_BUCKETS - 1 ?
+            INFINITY : double(1 << i);
+        bucket = JS_NewPlainObject(cx);
+        if (!bucket ||
+            !JS_DefineProperty(cx, bucket, "upToMs", up_to_ms,
+                               JSPROP_ENUMERATE) ||
+            !JS_DefineProperty(cx, bucket, "count",
+                               double(gc_stats.pause_histogram[i]),
+                               JSPROP_ENUMERATE) ||
+            !JS_DefineElement(cx, histogram, i, bucket, JSPROP_ENUMERATE))
+            return false;
+    }
+    if (!JS_DefineProperty(cx, stats, "pauseHistogram", histogram,
+                           JSPROP_ENUMERATE))
+        return false;
+
+    args.rval().setObject(*stats);
+    return true;
+}
+
 static JSFunctionSpec module_funcs[] = {
     JS_FS("addressOf", gjs_address_of, 1, GJS_MODULE_PROP_FLAGS),
     JS_FS("refcount", gjs_refcount, 1, GJS_MODULE_PROP_FLAGS),
@@ -178,6 +279,9 @@ static JSFunctionSpec module_funcs[] = {
     JS_FS("gc", gjs_gc, 0, GJS_MODULE_PROP_FLAGS),
     JS_FS("exit", gjs_exit, 0, GJS_MODULE_PROP_FLAGS),
     JS_FS("clearDateCaches", gjs_clear_date_caches, 0, GJS_MODULE_PROP_FLAGS),
+    JS_FS("clearImportCache", gjs_clear_import_cache, 0, GJS_MODULE_PROP_FLAGS),
+    JS_FS("getStatistics", gjs_get_statistics, 0, GJS_MODULE_PROP_FLAGS),
+    JS_FS("getGCStatistics", gjs_get_gc_statistics, 0, GJS_MODULE_PROP_FLAGS),
     JS_FS_END
 };
 
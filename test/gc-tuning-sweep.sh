@@ -0,0 +1,36 @@
+#!/bin/sh
+# Runs test/gc-tuning-workload.js under different heap and GC settings and
+# prints one line of results per setting, to help pick values for the
+# gc-* GjsContext properties / gjs-console options on a given device.
+#
+# Usage: test/gc-tuning-sweep.sh [GJS_CONSOLE] [FRAMES]
+
+gjs=${1:-gjs-console}
+frames=${2:-600}
+workload="$(dirname "$0")/gc-tuning-workload.js"
+
+run () {
+    printf '%-48s ' "${*:-defaults}"
+    "$gjs" "$@" "$workload" "$frames" || echo "failed"
+}
+
+run
+for nursery in 1 4 16 64; do
+    run --gc-nursery-size=$nursery
+done
+for budget in 2 5 10 20; do
+    run --gc-slice-budget=$budget
+done
+for growth in 120 150 200 300; do
+    run --gc-low-frequency-heap-growth=$growth
+done
+for growth in "120 200" "150 300" "200 500"; do
+    set -- $growth
+    run --gc-high-frequency-heap-growth-min=$1 --gc-high-frequency-heap-growth-max=$2
+done
+for trigger in 16 64 128 512; do
+    run --gc-malloc-trigger=$trigger
+done
+for trigger in 8 32 128; do
+    run --gc-native-trigger=$trigger
+done
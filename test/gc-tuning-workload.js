@@ -0,0 +1,70 @@
+// Allocation workload for test/gc-tuning-sweep.sh. It simulates an
+// application's frames: every frame creates short-lived JS objects and
+// strings, replaces part of a long-lived cache, and wraps some GObjects and
+// structs. Prints one line of results in the form key=value.
+
+const GLib = imports.gi.GLib;
+const GObject = imports.gi.GObject;
+const System = imports.system;
+
+const FRAMES = Number(ARGV[0]) || 600;
+const CACHE_SIZE = 20000;
+
+let cache = new Array(CACHE_SIZE);
+let frameTimes = [];
+let checksum = 0;
+
+function frame(n) {
+    // Garbage that dies young
+    for (let i = 0; i < 2000; i++) {
+        let point = {x: i, y: n, label: `point ${i}`};
+        checksum += point.label.length;
+    }
+
+    // Objects that survive for a few hundred frames
+    for (let i = 0; i < 200; i++)
+        cache[(n * 200 + i) % CACHE_SIZE] = {frame: n, data: new Array(16).fill(i)};
+
+    // Native memory held by wrappers
+    for (let i = 0; i < 50; i++) {
+        let obj = new GObject.Object();
+        let date = new GLib.Date();
+        checksum += obj ? 1 : 0;
+        checksum += date ? 1 : 0;
+    }
+}
+
+let loop = GLib.MainLoop.new(null, false);
+let n = 0;
+let start = GLib.get_monotonic_time();
+GLib.idle_add(GLib.PRIORITY_DEFAULT, function () {
+    let frameStart = GLib.get_monotonic_time();
+    frame(n++);
+    frameTimes.push(GLib.get_monotonic_time() - frameStart);
+    if (n < FRAMES)
+        return GLib.SOURCE_CONTINUE;
+    loop.quit();
+    return GLib.SOURCE_REMOVE;
+});
+loop.run();
+let total = GLib.get_monotonic_time() - start;
+
+frameTimes.sort((a, b) => a - b);
+let p95 = frameTimes[Math.floor(frameTimes.length * 0.95)];
+let max = frameTimes[frameTimes.length - 1];
+
+let peakRss = 0;
+let [ok, status] = GLib.file_get_contents('/proc/self/status');
+if (ok) {
+    let match = /VmHWM:\s*(\d+)/.exec(status.toString());
+    if (match)
+        peakRss = Number(match[1]);
+}
+
+let gc = System.getGCStatistics();
+print(`total_ms=${(total / 1000).toFixed(0)} ` +
+    `frame_p95_ms=${(p95 / 1000).toFixed(2)} ` +
+    `frame_max_ms=${(max / 1000).toFixed(2)} ` +
+    `gc_cycles=${gc.cycles} gc_slices=${gc.slices} ` +
+    `gc_max_pause_ms=${gc.maxPauseMs.toFixed(2)} ` +
+    `peak_rss_kb=${peakRss} checksum=${checksum}`);
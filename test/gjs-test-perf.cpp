@@ -0,0 +1,764 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2026  The GJS authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <girepository.h>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include "gjs/context.h"
+#include "gjs/mem.h"
+#include "test/gjs-test-utils.h"
+
+/* Benchmarks for the hot paths between JS and C. These only do anything in
+ * GLib's performance testing mode, "gjs-tests -m perf", so that they don't
+ * slow down "make check". Results are reported with g_test_minimized_result()
+ * and g_test_maximized_result(); run with --verbose to see the comparisons
+ * printed with g_test_message(). */
+
+static bool
+skip_unless_perf(void)
+{
+    if (g_test_perf())
+        return false;
+    g_test_skip("Benchmarks only run with -m perf");
+    return true;
+}
+
+/* Evaluates @script in a fresh context and returns the time it took */
+static double
+eval_timed(const char *script)
+{
+    GjsContext *context = gjs_context_new();
+    GError *error = NULL;
+    int status;
+
+    g_test_timer_start();
+    bool ok = gjs_context_eval(context, script, -1, "<perf>", &status, &error);
+    double elapsed = g_test_timer_elapsed();
+
+    g_assert_no_error(error);
+    g_assert_true(ok);
+    g_object_unref(context);
+    return elapsed;
+}
+
+#define SCALAR_CALLS 1000000
+#define SCALAR_CALLS_SCRIPT                                     \
+    "const GLib = imports.gi.GLib;\n"                           \
+    "for (let i = 0; i < " G_STRINGIFY(SCALAR_CALLS) "; i++) {\n" \
+    "    GLib.get_monotonic_time();\n"                          \
+    "    GLib.random_int_range(0, i + 1);\n"                    \
+    "}\n"
+
+static void
+test_perf_scalar_invoker(void)
+{
+    if (skip_unless_perf())
+        return;
+
+    g_setenv("GJS_DISABLE_SCALAR_INVOKERS", "1", true);
+    double generic_time = eval_timed(SCALAR_CALLS_SCRIPT);
+    g_unsetenv("GJS_DISABLE_SCALAR_INVOKERS");
+    double scalar_time = eval_timed(SCALAR_CALLS_SCRIPT);
+
+    g_test_message("Generic invoker: %.0f calls/s",
+                   2 * SCALAR_CALLS / generic_time);
+    g_test_maximized_result(2 * SCALAR_CALLS / scalar_time,
+                            "Scalar invoker: %.0f calls/s",
+                            2 * SCALAR_CALLS / scalar_time);
+}
+
+#define ENUM_CALLS 1000000
+#define ENUM_SCRIPT                                                     \
+    "const GLib = imports.gi.GLib;\n"                                   \
+    "let n = 0;\n"                                                      \
+    "for (let i = 0; i < " G_STRINGIFY(ENUM_CALLS) "; i++) {\n"          \
+    "    n += GLib.Checksum.type_get_length(GLib.ChecksumType.SHA256);\n" \
+    "    n += GLib.unichar_type(0x41 + (i & 0x3f));\n"                  \
+    "    GLib.format_size_full(i, GLib.FormatSizeFlags.IEC_UNITS |\n"   \
+    "                          GLib.FormatSizeFlags.LONG_FORMAT);\n"     \
+    "}\n"
+
+static void
+test_perf_enum_validation(void)
+{
+    if (skip_unless_perf())
+        return;
+
+    g_setenv("GJS_DISABLE_ENUM_CACHE", "1", true);
+    double scan_time = eval_timed(ENUM_SCRIPT);
+    g_unsetenv("GJS_DISABLE_ENUM_CACHE");
+    double cache_time = eval_timed(ENUM_SCRIPT);
+
+    g_test_message("Scanning value infos: %.0f calls/s",
+                   3 * ENUM_CALLS / scan_time);
+    g_test_maximized_result(3 * ENUM_CALLS / cache_time,
+                            "Cached value tables: %.0f calls/s",
+                            3 * ENUM_CALLS / cache_time);
+}
+
+#define STRING_CALLS 1000000
+#define STRING_SCRIPT(corpus)                                           \
+    "const GLib = imports.gi.GLib;\n"                                   \
+    "let s = '" corpus "';\n"                                           \
+    "for (let i = 0; i < " G_STRINGIFY(STRING_CALLS) "; i++)\n"          \
+    "    GLib.strdup(s);\n"
+
+/* Each GLib.strdup() converts its argument to UTF-8 and the copy back */
+static void
+string_round_trips(const char *corpus_name,
+                   const char *script)
+{
+    g_setenv("GJS_DISABLE_STRING_FAST_PATHS", "1", true);
+    double utf16_time = eval_timed(script);
+    g_unsetenv("GJS_DISABLE_STRING_FAST_PATHS");
+    double fast_time = eval_timed(script);
+
+    g_test_message("%s through UTF-16: %.0f round trips/s", corpus_name,
+                   STRING_CALLS / utf16_time);
+    g_test_maximized_result(STRING_CALLS / fast_time,
+                            "%s with fast paths: %.0f round trips/s",
+                            corpus_name, STRING_CALLS / fast_time);
+}
+
+static void
+test_perf_string_conversion(void)
+{
+    if (skip_unless_perf())
+        return;
+
+    string_round_trips("ASCII", STRING_SCRIPT(
+        "/org/gnome/Shell/Extensions/window-list@gnome-shell-extensions"));
+    string_round_trips("Latin-1", STRING_SCRIPT(
+        "Cr\\u00e8me br\\u00fbl\\u00e9e \\u00e0 la fran\\u00e7aise et ch\\u00e2teau"));
+    /* Never takes the fast paths; this measures what checking for them costs */
+    string_round_trips("CJK", STRING_SCRIPT(
+        "\\u65e5\\u672c\\u8a9e\\u306e\\u30c6\\u30ad\\u30b9\\u30c8\\u3068\\u4e2d\\u6587\\u6587\\u672c"));
+}
+
+#define BORROWED_STRING_CALLS 1000000
+#define BORROWED_STRING_SCRIPT                                          \
+    "const GObject = imports.gi.GObject;\n"                             \
+    "const pspec = GObject.ParamSpec.string('gjs-perf-borrowed', '',\n" \
+    "    '', GObject.ParamFlags.READABLE, '');\n"                       \
+    "let n = 0;\n"                                                      \
+    "for (let i = 0; i < " G_STRINGIFY(BORROWED_STRING_CALLS) " / 2; i++) {\n" \
+    "    n += GObject.TYPE_OBJECT.name.length;\n"                       \
+    "    n += pspec.name.length;\n"                                     \
+    "}\n"
+
+/* Strings that C keeps owning; with the cache, all but the first of each
+ * are atoms found by address instead of new strings for the GC to collect */
+static void
+test_perf_string_borrowed(void)
+{
+    if (skip_unless_perf())
+        return;
+
+    g_setenv("GJS_DISABLE_STRING_CACHE", "1", true);
+    double copy_time = eval_timed(BORROWED_STRING_SCRIPT);
+    g_unsetenv("GJS_DISABLE_STRING_CACHE");
+    guint64 hits = GJS_GET_STAT(string_cache_hit);
+    guint64 misses = GJS_GET_STAT(string_cache_miss);
+    double cache_time = eval_timed(BORROWED_STRING_SCRIPT);
+    hits = GJS_GET_STAT(string_cache_hit) - hits;
+    misses = GJS_GET_STAT(string_cache_miss) - misses;
+
+    g_test_message("Copied strings: %.0f strings/s",
+                   BORROWED_STRING_CALLS / copy_time);
+    g_test_message("String cache hit rate: %.1f%%",
+                   100.0 * hits / MAX(hits + misses, 1));
+    g_test_maximized_result(BORROWED_STRING_CALLS / cache_time,
+                            "Cached atoms: %.0f strings/s",
+                            BORROWED_STRING_CALLS / cache_time);
+}
+
+#define ARRAY_LENGTH 65536
+#define ARRAY_CALLS 200
+#define ARRAY_IN_SCRIPT(init)                                           \
+    "const GLib = imports.gi.GLib;\n"                                   \
+    "let data = " init ";\n"                                            \
+    "for (let i = 0; i < data.length; i++)\n"                           \
+    "    data[i] = i & 0xff;\n"                                         \
+    "for (let i = 0; i < " G_STRINGIFY(ARRAY_CALLS) "; i++)\n"          \
+    "    GLib.compute_checksum_for_data(GLib.ChecksumType.MD5, data);\n"
+
+static void
+test_perf_typed_array_in(void)
+{
+    if (skip_unless_perf())
+        return;
+
+    double array_time = eval_timed(ARRAY_IN_SCRIPT(
+        "new Array(" G_STRINGIFY(ARRAY_LENGTH) ")"));
+    double typed_array_time = eval_timed(ARRAY_IN_SCRIPT(
+        "new Uint8Array(" G_STRINGIFY(ARRAY_LENGTH) ")"));
+
+    g_test_message("Array: %.0f elements/s",
+                   double(ARRAY_LENGTH) * ARRAY_CALLS / array_time);
+    g_test_maximized_result(double(ARRAY_LENGTH) * ARRAY_CALLS / typed_array_time,
+                            "Uint8Array: %.0f elements/s",
+                            double(ARRAY_LENGTH) * ARRAY_CALLS / typed_array_time);
+}
+
+#define BYTE_ARRAY_LENGTH 1048576
+#define BYTE_ARRAY_PASSES 10
+#define BYTE_ARRAY_SCRIPT(view)                                         \
+    "const ByteArray = imports.byteArray;\n"                            \
+    "let a = new ByteArray.ByteArray(" G_STRINGIFY(BYTE_ARRAY_LENGTH) ");\n" \
+    "let v = " view ";\n"                                               \
+    "for (let pass = 0; pass < " G_STRINGIFY(BYTE_ARRAY_PASSES) "; pass++) {\n" \
+    "    for (let i = 0; i < v.length; i++)\n"                          \
+    "        v[i] = (v[i] + i) & 0xff;\n"                               \
+    "}\n"
+
+static void
+test_perf_byte_array_buffer(void)
+{
+    if (skip_unless_perf())
+        return;
+
+    double byte_array_time = eval_timed(BYTE_ARRAY_SCRIPT("a"));
+    double view_time = eval_timed(BYTE_ARRAY_SCRIPT("new Uint8Array(a.buffer)"));
+    double accesses = 2.0 * BYTE_ARRAY_LENGTH * BYTE_ARRAY_PASSES;
+
+    g_test_message("ByteArray: %.0f accesses/s", accesses / byte_array_time);
+    g_test_maximized_result(accesses / view_time,
+                            "Uint8Array on ByteArray.buffer: %.0f accesses/s",
+                            accesses / view_time);
+}
+
+/* Returns a script that looks up every method of every class in @ns_name
+ * on the class's prototype, like an application touching a lot of API at
+ * startup would */
+static char *
+touch_all_methods_script(const char *ns_name,
+                         const char *version)
+{
+    GError *error = NULL;
+    g_irepository_require(NULL, ns_name, version, GIRepositoryLoadFlags(0),
+                          &error);
+    g_assert_no_error(error);
+
+    GString *script = g_string_new(NULL);
+    g_string_append_printf(script, "imports.gi.versions.%s = '%s';\n"
+                           "const Ns = imports.gi.%s;\n",
+                           ns_name, version, ns_name);
+
+    int n_infos = g_irepository_get_n_infos(NULL, ns_name);
+    for (int i = 0; i < n_infos; i++) {
+        GIBaseInfo *info = g_irepository_get_info(NULL, ns_name, i);
+        if (g_base_info_get_type(info) == GI_INFO_TYPE_OBJECT &&
+            g_type_is_a(g_registered_type_info_get_g_type(info),
+                        G_TYPE_OBJECT)) {
+            int n_methods = g_object_info_get_n_methods(info);
+            for (int j = 0; j < n_methods; j++) {
+                GIFunctionInfo *method = g_object_info_get_method(info, j);
+                g_string_append_printf(script, "Ns.%s.prototype.%s;\n",
+                                       g_base_info_get_name(info),
+                                       g_base_info_get_name(method));
+                g_base_info_unref(method);
+            }
+        }
+        g_base_info_unref(info);
+    }
+
+    return g_string_free(script, false);
+}
+
+static void
+test_perf_method_resolve(void)
+{
+    if (skip_unless_perf())
+        return;
+
+    char *script = touch_all_methods_script("Gio", "2.0");
+
+    g_setenv("GJS_DISABLE_METHOD_INDEX", "1", true);
+    double lookup_time = eval_timed(script);
+    g_unsetenv("GJS_DISABLE_METHOD_INDEX");
+    double index_time = eval_timed(script);
+
+    g_test_message("Method lookup: %.3f s", lookup_time);
+    g_test_minimized_result(index_time, "Method index: %.3f s", index_time);
+
+    g_free(script);
+}
+
+#define PROPERTY_ACCESSES 1000000
+#define PROPERTY_SCRIPT                                                 \
+    "const Gio = imports.gi.Gio;\n"                                     \
+    "let action = new Gio.SimpleAction({ name: 'perf' });\n"            \
+    "let n = 0;\n"                                                      \
+    "for (let i = 0; i < " G_STRINGIFY(PROPERTY_ACCESSES) "; i++) {\n"   \
+    "    action.enabled = (i & 1) === 0;\n"                             \
+    "    if (action.enabled)\n"                                         \
+    "        n += action.name.length;\n"                               \
+    "}\n"
+
+static void
+test_perf_property_access(void)
+{
+    if (skip_unless_perf())
+        return;
+
+    g_setenv("GJS_DISABLE_PROPERTY_ACCESSORS", "1", true);
+    double hook_time = eval_timed(PROPERTY_SCRIPT);
+    g_unsetenv("GJS_DISABLE_PROPERTY_ACCESSORS");
+    double accessor_time = eval_timed(PROPERTY_SCRIPT);
+
+    /* one set and one or two gets per iteration */
+    double accesses = 2.5 * PROPERTY_ACCESSES;
+    g_test_message("Property hooks: %.0f accesses/s", accesses / hook_time);
+    g_test_maximized_result(accesses / accessor_time,
+                            "Property accessors: %.0f accesses/s",
+                            accesses / accessor_time);
+}
+
+#define WRAPPED_OBJECTS 1000000
+#define WRAP_SCRIPT                                                     \
+    "const Gio = imports.gi.Gio;\n"                                     \
+    "for (let i = 0; i < " G_STRINGIFY(WRAPPED_OBJECTS) " / 2; i++) {\n" \
+    "    Gio.SimpleAction.new('perf', null);\n"                         \
+    "    Gio.File.new_for_path('/');\n"                                 \
+    "}\n"
+
+/* Every object here is created in C and wrapped on its way into JS; the
+ * files are of a private GType, which lives in the private namespace */
+static void
+test_perf_object_wrap(void)
+{
+    if (skip_unless_perf())
+        return;
+
+    g_setenv("GJS_DISABLE_CLASS_CACHE", "1", true);
+    double lookup_time = eval_timed(WRAP_SCRIPT);
+    g_unsetenv("GJS_DISABLE_CLASS_CACHE");
+    double cache_time = eval_timed(WRAP_SCRIPT);
+
+    g_test_message("Namespace lookup: %.0f wrappers/s",
+                   WRAPPED_OBJECTS / lookup_time);
+    g_test_maximized_result(WRAPPED_OBJECTS / cache_time,
+                            "Class cache: %.0f wrappers/s",
+                            WRAPPED_OBJECTS / cache_time);
+}
+
+#define EMISSIONS 10000000
+#define EMIT_SCRIPT                                                     \
+    "const GObject = imports.gi.GObject;\n"                             \
+    "const Lang = imports.lang;\n"                                      \
+    "const Emitter = new Lang.Class({\n"                                \
+    "    Name: 'PerfEmitter',\n"                                        \
+    "    Extends: GObject.Object,\n"                                    \
+    "    Signals: {\n"                                                  \
+    "        'three-args': {\n"                                         \
+    "            param_types: [GObject.Object.$gtype, GObject.TYPE_INT,\n" \
+    "                          GObject.TYPE_DOUBLE],\n"                 \
+    "        },\n"                                                      \
+    "    },\n"                                                          \
+    "});\n"                                                             \
+    "let emitter = new Emitter();\n"                                    \
+    "let arg = new GObject.Object();\n"                                 \
+    "let sum = 0;\n"                                                    \
+    "emitter.connect('three-args', (e, o, i, d) => { sum += i; });\n"   \
+    "for (let i = 0; i < " G_STRINGIFY(EMISSIONS) "; i++)\n"            \
+    "    emitter.emit('three-args', arg, i, 0.5);\n"
+
+static void
+test_perf_signal_emit(void)
+{
+    if (skip_unless_perf())
+        return;
+
+    double elapsed = eval_timed(EMIT_SCRIPT);
+    g_test_maximized_result(EMISSIONS / elapsed,
+                            "emit() with 3 arguments: %.0f emissions/s",
+                            EMISSIONS / elapsed);
+}
+
+#define MODULES 400
+
+/* Writes MODULES modules with a few hundred lines each into a new temporary
+ * directory, and returns the script that imports all of them */
+static char *
+write_modules(char **modules_dir)
+{
+    GError *error = NULL;
+    *modules_dir = g_dir_make_tmp("gjs-perf-modules-XXXXXX", &error);
+    g_assert_no_error(error);
+
+    GString *source = g_string_new("");
+    for (unsigned i = 0; i < 50; i++) {
+        g_string_append_printf(source,
+            "var Class%u = class {\n"
+            "    constructor(a, b) { this.a = a; this.b = b; }\n"
+            "    sum() { return this.a + this.b; }\n"
+            "    product() { return [this.a, this.b].reduce((x, y) => x * y, 1); }\n"
+            "};\n"
+            "function helper%u(n) {\n"
+            "    let s = `${n}`;\n"
+            "    return s.length > 2 ? s.slice(0, 2) : s.padStart(2, '0');\n"
+            "}\n", i, i);
+    }
+
+    for (unsigned i = 0; i < MODULES; i++) {
+        char *name = g_strdup_printf("perfModule%u.js", i);
+        char *path = g_build_filename(*modules_dir, name, NULL);
+        g_file_set_contents(path, source->str, source->len, &error);
+        g_assert_no_error(error);
+        g_free(path);
+        g_free(name);
+    }
+    g_string_free(source, true);
+
+    return g_strdup_printf("imports.searchPath.unshift('%s');\n"
+                           "for (let i = 0; i < %d; i++)\n"
+                           "    imports['perfModule' + i];\n",
+                           *modules_dir, MODULES);
+}
+
+static void
+test_perf_module_cache(void)
+{
+    if (skip_unless_perf())
+        return;
+
+    GError *error = NULL;
+    char *modules_dir;
+    char *script = write_modules(&modules_dir);
+    char *cache_dir = g_dir_make_tmp("gjs-perf-cache-XXXXXX", &error);
+    g_assert_no_error(error);
+    char *old_cache_dir = g_strdup(g_getenv("GJS_MODULE_CACHE_DIR"));
+    g_setenv("GJS_MODULE_CACHE_DIR", cache_dir, true);
+
+    g_setenv("GJS_DISABLE_MODULE_CACHE", "1", true);
+    double uncached_time = eval_timed(script);
+    g_unsetenv("GJS_DISABLE_MODULE_CACHE");
+    double cold_time = eval_timed(script);
+    double warm_time = eval_timed(script);
+
+    if (old_cache_dir)
+        g_setenv("GJS_MODULE_CACHE_DIR", old_cache_dir, true);
+    else
+        g_unsetenv("GJS_MODULE_CACHE_DIR");
+    g_free(old_cache_dir);
+    gjs_test_remove_tmp_dir(cache_dir);
+    gjs_test_remove_tmp_dir(modules_dir);
+    g_free(cache_dir);
+    g_free(modules_dir);
+    g_free(script);
+
+    g_test_message("Importing %d modules without cache: %.3f s", MODULES,
+                   uncached_time);
+    g_test_message("Importing %d modules, cold cache: %.3f s", MODULES,
+                   cold_time);
+    g_test_minimized_result(warm_time,
+                            "Importing %d modules, warm cache: %.3f s",
+                            MODULES, warm_time);
+}
+
+#define TREE_MODULES 500
+
+/* Writes a binary tree of TREE_MODULES modules into a "tree" subdirectory of
+ * a new temporary directory, each importing its two children, and returns
+ * the script that imports the root. Every module is large enough to be worth
+ * compiling off-thread. */
+static char *
+write_module_tree(char **modules_dir)
+{
+    GError *error = NULL;
+    *modules_dir = g_dir_make_tmp("gjs-perf-tree-XXXXXX", &error);
+    g_assert_no_error(error);
+    char *tree_dir = g_build_filename(*modules_dir, "tree", NULL);
+    g_assert_cmpint(g_mkdir(tree_dir, 0755), ==, 0);
+
+    GString *body = g_string_new("");
+    for (unsigned i = 0; i < 100; i++) {
+        g_string_append_printf(body,
+            "var fn%u = function (a, b) {\n"
+            "    let o = { a, b, sum: a + b, list: [a, b, a * b] };\n"
+            "    return o.list.map(x => x + o.sum).join(',');\n"
+            "};\n", i);
+    }
+
+    for (unsigned i = 0; i < TREE_MODULES; i++) {
+        GString *source = g_string_new("");
+        for (unsigned child = 2 * i + 1;
+             child <= 2 * i + 2 && child < TREE_MODULES; child++)
+            g_string_append_printf(source, "var child%u = imports.tree.mod%u;\n",
+                                   child, child);
+        g_string_append_len(source, body->str, body->len);
+
+        char *name = g_strdup_printf("mod%u.js", i);
+        char *path = g_build_filename(tree_dir, name, NULL);
+        g_file_set_contents(path, source->str, source->len, &error);
+        g_assert_no_error(error);
+        g_free(path);
+        g_free(name);
+        g_string_free(source, true);
+    }
+    g_string_free(body, true);
+    g_free(tree_dir);
+
+    return g_strdup_printf("imports.searchPath.unshift('%s');\n"
+                           "imports.tree.mod0;\n", *modules_dir);
+}
+
+static void
+test_perf_module_prefetch(void)
+{
+    if (skip_unless_perf())
+        return;
+
+    char *modules_dir;
+    char *script = write_module_tree(&modules_dir);
+
+    /* Measure compiling, not loading bytecode from the cache */
+    g_setenv("GJS_DISABLE_MODULE_CACHE", "1", true);
+    double serial_time = eval_timed(script);
+    g_setenv("GJS_PREFETCH_IMPORTS", "1", true);
+    double prefetch_time = eval_timed(script);
+    g_unsetenv("GJS_PREFETCH_IMPORTS");
+    g_unsetenv("GJS_DISABLE_MODULE_CACHE");
+
+    char *tree_dir = g_build_filename(modules_dir, "tree", NULL);
+    gjs_test_remove_tmp_dir(tree_dir);
+    gjs_test_remove_tmp_dir(modules_dir);
+    g_free(tree_dir);
+    g_free(modules_dir);
+    g_free(script);
+
+    g_test_message("Importing %d-module tree, compiled on import: %.3f s "
+                   "(%u processors)", TREE_MODULES, serial_time,
+                   g_get_num_processors());
+    g_test_minimized_result(prefetch_time,
+                            "Importing %d-module tree, prefetched: %.3f s",
+                            TREE_MODULES, prefetch_time);
+}
+
+#define BOXED_ALLOCS 1000000
+
+/* Creates many short-lived GLib.TimeVal structs, and returns the number of
+ * collections of the major heap that it took */
+static unsigned
+boxed_alloc_gc_cycles(double *elapsed)
+{
+    GjsContext *context = gjs_context_new();
+    GError *error = NULL;
+    int cycles;
+
+    g_test_timer_start();
+    bool ok = gjs_context_eval(context,
+        "const GLib = imports.gi.GLib;\n"
+        "const System = imports.system;\n"
+        "let sum = 0;\n"
+        "for (let i = 0; i < " G_STRINGIFY(BOXED_ALLOCS) "; i++) {\n"
+        "    let tv = new GLib.TimeVal();\n"
+        "    tv.tv_sec = i;\n"
+        "    sum += tv.tv_sec;\n"
+        "}\n"
+        "System.getGCStatistics().cycles | 0;\n",
+        -1, "<perf>", &cycles, &error);
+    *elapsed = g_test_timer_elapsed();
+
+    g_assert_no_error(error);
+    g_assert_true(ok);
+    g_object_unref(context);
+    return cycles;
+}
+
+static void
+test_perf_boxed_nursery(void)
+{
+    if (skip_unless_perf())
+        return;
+
+    double tenured_time, nursery_time;
+    g_setenv("GJS_DISABLE_NURSERY_BOXED", "1", true);
+    unsigned tenured_gcs = boxed_alloc_gc_cycles(&tenured_time);
+    g_unsetenv("GJS_DISABLE_NURSERY_BOXED");
+    unsigned nursery_gcs = boxed_alloc_gc_cycles(&nursery_time);
+
+    g_test_message("Tenured wrappers: %u GCs, %.0f structs/s", tenured_gcs,
+                   BOXED_ALLOCS / tenured_time);
+    g_test_message("Nursery wrappers: %u GCs, %.0f structs/s", nursery_gcs,
+                   BOXED_ALLOCS / nursery_time);
+    g_test_minimized_result(nursery_gcs, "Nursery wrappers: %u GCs",
+                            nursery_gcs);
+}
+
+#ifdef __GLIBC__
+#define WRAPPERS 200000
+
+/* Returns the number of bytes of C heap used by keeping WRAPPERS wrapped
+ * GObjects alive, each with @n_connections signal connections */
+static double
+wrapper_heap_bytes(unsigned n_connections)
+{
+    GjsContext *context = gjs_context_new();
+    GError *error = NULL;
+    int status;
+
+    /* Load the typelib and create the prototype beforehand, so that only
+     * the per-wrapper cost gets measured */
+    bool ok = gjs_context_eval(context,
+        "const GObject = imports.gi.GObject;\n"
+        "let objs = [];\n"
+        "new GObject.Object();\n",
+        -1, "<perf>", &status, &error);
+    g_assert_no_error(error);
+    g_assert_true(ok);
+    gjs_context_gc(context);
+    size_t before = mallinfo().uordblks;
+
+    char *script = g_strdup_printf(
+        "for (let i = 0; i < %d; i++) {\n"
+        "    let o = new GObject.Object();\n"
+        "    for (let j = 0; j < %u; j++)\n"
+        "        o.connect('notify', () => {});\n"
+        "    objs.push(o);\n"
+        "}\n", WRAPPERS, n_connections);
+    ok = gjs_context_eval(context, script, -1, "<perf>", &status, &error);
+    g_assert_no_error(error);
+    g_assert_true(ok);
+    gjs_context_gc(context);
+    size_t after = mallinfo().uordblks;
+
+    g_free(script);
+    g_object_unref(context);
+    return double(after - before) / WRAPPERS;
+}
+
+static void
+test_perf_object_wrapper_heap(void)
+{
+    if (skip_unless_perf())
+        return;
+
+    double connected = wrapper_heap_bytes(1);
+    double bare = wrapper_heap_bytes(0);
+    g_test_message("Wrapper with one signal connection: %.0f bytes",
+                   connected);
+    g_test_minimized_result(bare, "Wrapper without connections: %.0f bytes",
+                            bare);
+}
+
+#define RECTANGLES 10000000
+#define RECTANGLES_SCRIPT                                               \
+    "imports.gi.versions.Gdk = '3.0';\n"                                \
+    "const Gdk = imports.gi.Gdk;\n"                                     \
+    "let area = 0;\n"                                                   \
+    "for (let i = 0; i < " G_STRINGIFY(RECTANGLES) "; i++) {\n"         \
+    "    let rect = new Gdk.Rectangle({x: i, y: i, width: 3, height: 4});\n" \
+    "    area += rect.width * rect.height;\n"                           \
+    "}\n"
+
+#define LIVE_RECTANGLES 100000
+
+/* Returns the number of bytes of C heap used by keeping LIVE_RECTANGLES
+ * Gdk.Rectangles alive */
+static double
+rectangle_heap_bytes(void)
+{
+    GjsContext *context = gjs_context_new();
+    GError *error = NULL;
+    int status;
+
+    bool ok = gjs_context_eval(context,
+        "imports.gi.versions.Gdk = '3.0';\n"
+        "const Gdk = imports.gi.Gdk;\n"
+        "let rects = [];\n"
+        "new Gdk.Rectangle();\n",
+        -1, "<perf>", &status, &error);
+    g_assert_no_error(error);
+    g_assert_true(ok);
+    gjs_context_gc(context);
+    size_t before = mallinfo().uordblks;
+
+    ok = gjs_context_eval(context,
+        "for (let i = 0; i < " G_STRINGIFY(LIVE_RECTANGLES) "; i++)\n"
+        "    rects.push(new Gdk.Rectangle({x: i, y: i, width: 3, height: 4}));\n",
+        -1, "<perf>", &status, &error);
+    g_assert_no_error(error);
+    g_assert_true(ok);
+    gjs_context_gc(context);
+    size_t after = mallinfo().uordblks;
+
+    g_object_unref(context);
+    return double(after - before) / LIVE_RECTANGLES;
+}
+
+static void
+test_perf_boxed_rectangle(void)
+{
+    if (skip_unless_perf())
+        return;
+    if (!g_irepository_require(NULL, "Gdk", "3.0", GIRepositoryLoadFlags(0),
+                               NULL)) {
+        g_test_skip("Gdk 3.0 typelib not available");
+        return;
+    }
+
+    g_setenv("GJS_DISABLE_NURSERY_BOXED", "1", true);
+    double tenured_time = eval_timed(RECTANGLES_SCRIPT);
+    double tenured_bytes = rectangle_heap_bytes();
+    g_unsetenv("GJS_DISABLE_NURSERY_BOXED");
+    double inline_time = eval_timed(RECTANGLES_SCRIPT);
+    double inline_bytes = rectangle_heap_bytes();
+
+    g_test_message("Boxed wrappers: %.0f rectangles/s, %.0f bytes of C heap each",
+                   RECTANGLES / tenured_time, tenured_bytes);
+    g_test_message("Inline wrappers: %.0f bytes of C heap each", inline_bytes);
+    g_test_maximized_result(RECTANGLES / inline_time,
+                            "Inline wrappers: %.0f rectangles/s",
+                            RECTANGLES / inline_time);
+}
+#endif  /* __GLIBC__ */
+
+void
+gjs_test_add_tests_for_perf(void)
+{
+    g_test_add_func("/perf/function/scalar-invoker", test_perf_scalar_invoker);
+    g_test_add_func("/perf/arg/typed-array-in", test_perf_typed_array_in);
+    g_test_add_func("/perf/arg/enum-validation", test_perf_enum_validation);
+    g_test_add_func("/perf/byte-array/buffer", test_perf_byte_array_buffer);
+    g_test_add_func("/perf/string/conversion", test_perf_string_conversion);
+    g_test_add_func("/perf/string/borrowed", test_perf_string_borrowed);
+    g_test_add_func("/perf/object/method-resolve", test_perf_method_resolve);
+    g_test_add_func("/perf/object/property-access", test_perf_property_access);
+    g_test_add_func("/perf/object/signal-emit", test_perf_signal_emit);
+    g_test_add_func("/perf/object/wrap", test_perf_object_wrap);
+    g_test_add_func("/perf/module/cache", test_perf_module_cache);
+    g_test_add_func("/perf/module/prefetch", test_perf_module_prefetch);
+    g_test_add_func("/perf/boxed/nursery", test_perf_boxed_nursery);
+#ifdef __GLIBC__
+    g_test_add_func("/perf/object/wrapper-heap", test_perf_object_wrapper_heap);
+    g_test_add_func("/perf/boxed/rectangle", test_perf_boxed_rectangle);
+#endif
+}
@@ -0,0 +1,250 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2026  The GJS authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <tuple>
+
+#include <glib-object.h>
+
+#include "gi/toggle.h"
+#include "gjs-test-utils.h"
+
+#define N_THREADS 8
+#define N_OBJECTS_PER_THREAD 2000
+
+/* Net number of toggle ups minus toggle downs handled, per object. Only
+ * touched from the main thread, where toggles are handled. */
+static GHashTable *net_toggles;
+
+static void
+counting_handler(GObject               *gobj,
+                 ToggleQueue::Direction direction)
+{
+    int net = GPOINTER_TO_INT(g_hash_table_lookup(net_toggles, gobj));
+    net += direction == ToggleQueue::UP ? 1 : -1;
+    g_hash_table_insert(net_toggles, gobj, GINT_TO_POINTER(net));
+}
+
+static void
+setup(void)
+{
+    net_toggles = g_hash_table_new(NULL, NULL);
+}
+
+static void
+teardown(void)
+{
+    g_hash_table_destroy(net_toggles);
+}
+
+static GObject **
+new_objects(unsigned n)
+{
+    GObject **objects = g_new(GObject *, n);
+    for (unsigned i = 0; i < n; i++)
+        objects[i] = G_OBJECT(g_object_new(G_TYPE_OBJECT, NULL));
+    return objects;
+}
+
+static void
+free_objects(GObject **objects,
+             unsigned  n)
+{
+    for (unsigned i = 0; i < n; i++) {
+        g_assert_cmpuint(objects[i]->ref_count, ==, 1);
+        g_object_unref(objects[i]);
+    }
+    g_free(objects);
+}
+
+static void
+test_toggle_queue_down_then_up_coalesces(void)
+{
+    ToggleQueue queue;
+    GObject *gobj = G_OBJECT(g_object_new(G_TYPE_OBJECT, NULL));
+    bool down, up;
+
+    setup();
+    queue.enqueue(gobj, ToggleQueue::DOWN, counting_handler);
+    std::tie(down, up) = queue.is_queued(gobj);
+    g_assert_true(down);
+    g_assert_false(up);
+
+    queue.enqueue(gobj, ToggleQueue::UP, counting_handler);
+    std::tie(down, up) = queue.is_queued(gobj);
+    g_assert_false(down);
+    g_assert_false(up);
+
+    g_assert_false(queue.handle_toggle(counting_handler));
+    g_assert_cmpuint(g_hash_table_size(net_toggles), ==, 0);
+    g_assert_cmpuint(gobj->ref_count, ==, 1);
+
+    while (g_main_context_iteration(NULL, false))
+        ;
+    g_object_unref(gobj);
+    teardown();
+}
+
+static void
+test_toggle_queue_cancel(void)
+{
+    ToggleQueue queue;
+    GObject **objects = new_objects(3);
+    bool down, up;
+
+    setup();
+    for (unsigned i = 0; i < 3; i++)
+        queue.enqueue(objects[i], ToggleQueue::DOWN, counting_handler);
+
+    std::tie(down, up) = queue.cancel(objects[1]);
+    g_assert_true(down);
+    g_assert_false(up);
+    std::tie(down, up) = queue.cancel(objects[1]);
+    g_assert_false(down);
+    g_assert_false(up);
+
+    /* The remaining toggles are handled in order */
+    g_assert_true(queue.handle_toggle(counting_handler));
+    g_assert_true(g_hash_table_contains(net_toggles, objects[0]));
+    g_assert_true(queue.handle_toggle(counting_handler));
+    g_assert_true(g_hash_table_contains(net_toggles, objects[2]));
+    g_assert_false(queue.handle_toggle(counting_handler));
+    g_assert_false(g_hash_table_contains(net_toggles, objects[1]));
+
+    while (g_main_context_iteration(NULL, false))
+        ;
+    free_objects(objects, 3);
+    teardown();
+}
+
+static void
+test_toggle_queue_idle_drains_in_batches(void)
+{
+    const unsigned n_objects = 3 * ToggleQueue::MAX_BATCH;
+    ToggleQueue queue;
+    GObject **objects = new_objects(n_objects);
+
+    setup();
+    for (unsigned i = 0; i < n_objects; i++)
+        queue.enqueue(objects[i], ToggleQueue::DOWN, counting_handler);
+
+    g_assert_true(g_main_context_iteration(NULL, false));
+    g_assert_cmpuint(g_hash_table_size(net_toggles), ==,
+                     ToggleQueue::MAX_BATCH);
+
+    while (g_main_context_iteration(NULL, false))
+        ;
+    g_assert_cmpuint(g_hash_table_size(net_toggles), ==, n_objects);
+    g_assert_false(queue.handle_toggle(counting_handler));
+
+    free_objects(objects, n_objects);
+    teardown();
+}
+
+typedef struct {
+    ToggleQueue *queue;
+    GObject **objects;
+} ThreadData;
+
+static volatile int n_threads_finished;
+
+/* Even objects get a toggle down, odd objects a toggle down followed by a
+ * toggle up, like an object passed between threads would */
+static void *
+toggle_from_thread(void *data)
+{
+    auto thread_data = static_cast<ThreadData *>(data);
+
+    for (unsigned i = 0; i < N_OBJECTS_PER_THREAD; i++) {
+        GObject *gobj = thread_data->objects[i];
+        thread_data->queue->enqueue(gobj, ToggleQueue::DOWN, counting_handler);
+        if (i % 2 == 1) {
+            /* Toggling up happens on going from one to two references */
+            g_object_ref(gobj);
+            thread_data->queue->enqueue(gobj, ToggleQueue::UP,
+                                        counting_handler);
+            g_object_unref(gobj);
+        }
+    }
+
+    g_atomic_int_inc(&n_threads_finished);
+    return nullptr;
+}
+
+static void
+test_toggle_queue_stress_many_threads(void)
+{
+    ToggleQueue queue;
+    ThreadData thread_data[N_THREADS];
+    GThread *threads[N_THREADS];
+
+    setup();
+    n_threads_finished = 0;
+    for (unsigned i = 0; i < N_THREADS; i++) {
+        thread_data[i].queue = &queue;
+        thread_data[i].objects = new_objects(N_OBJECTS_PER_THREAD);
+    }
+    for (unsigned i = 0; i < N_THREADS; i++)
+        threads[i] = g_thread_new("toggler", toggle_from_thread,
+                                  &thread_data[i]);
+
+    /* Drain concurrently with the threads enqueueing, so that some down-up
+     * pairs are coalesced and some are handled separately */
+    while (g_atomic_int_get(&n_threads_finished) < N_THREADS) {
+        queue.handle_toggle(counting_handler);
+        g_main_context_iteration(NULL, false);
+    }
+    for (unsigned i = 0; i < N_THREADS; i++)
+        g_thread_join(threads[i]);
+
+    while (queue.handle_toggle(counting_handler))
+        ;
+    while (g_main_context_iteration(NULL, false))
+        ;
+
+    for (unsigned i = 0; i < N_THREADS; i++) {
+        for (unsigned j = 0; j < N_OBJECTS_PER_THREAD; j++) {
+            GObject *gobj = thread_data[i].objects[j];
+            int net = GPOINTER_TO_INT(g_hash_table_lookup(net_toggles, gobj));
+            bool down, up;
+
+            g_assert_cmpint(net, ==, j % 2 == 1 ? 0 : -1);
+            std::tie(down, up) = queue.is_queued(gobj);
+            g_assert_false(down);
+            g_assert_false(up);
+        }
+        free_objects(thread_data[i].objects, N_OBJECTS_PER_THREAD);
+    }
+    teardown();
+}
+
+void
+gjs_test_add_tests_for_toggle_queue(void)
+{
+    g_test_add_func("/toggle-queue/down-then-up-coalesces",
+                    test_toggle_queue_down_then_up_coalesces);
+    g_test_add_func("/toggle-queue/cancel", test_toggle_queue_cancel);
+    g_test_add_func("/toggle-queue/idle-drains-in-batches",
+                    test_toggle_queue_idle_drains_in_batches);
+    g_test_add_func("/toggle-queue/stress-many-threads",
+                    test_toggle_queue_stress_many_threads);
+}
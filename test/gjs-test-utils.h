@@ -22,6 +22,7 @@
 
 #include "gjs/context.h"
 #include "gjs/jsapi-wrapper.h"
+#include "gjs-test-tmp-dir.h"
 
 typedef struct _GjsUnitTestFixture GjsUnitTestFixture;
 struct _GjsUnitTestFixture {
@@ -48,4 +49,8 @@ void gjs_test_add_tests_for_parse_call_args(void);
 
 void gjs_test_add_tests_for_rooting(void);
 
+void gjs_test_add_tests_for_perf(void);
+
+void gjs_test_add_tests_for_toggle_queue(void);
+
 #endif
@@ -23,6 +23,7 @@
 
 #include <config.h>
 
+#include <string.h>
 #include <string>
 
 #include <glib.h>
@@ -32,6 +33,7 @@
 #include <gjs/context.h>
 #include "gjs/jsapi-util.h"
 #include "gjs/jsapi-wrapper.h"
+#include "gjs/mem.h"
 #include "gjs-test-utils.h"
 #include "util/error.h"
 
@@ -65,6 +67,122 @@ gjstest_test_func_gjs_context_construct_eval(void)
     g_object_unref (context);
 }
 
+static void
+gjstest_test_func_gjs_context_construct_gc_tuning(void)
+{
+    GjsContext *context;
+    unsigned nursery_size, slice_budget, growth;
+    int estatus;
+    GError *error = NULL;
+
+    context = GJS_CONTEXT(g_object_new(GJS_TYPE_CONTEXT,
+                                       "gc-nursery-size", 4 * 1024 * 1024,
+                                       "gc-slice-budget", 3,
+                                       "gc-low-frequency-heap-growth", 200,
+                                       "gc-malloc-trigger", 16 * 1024 * 1024,
+                                       NULL));
+    g_object_get(context,
+                 "gc-nursery-size", &nursery_size,
+                 "gc-slice-budget", &slice_budget,
+                 "gc-low-frequency-heap-growth", &growth,
+                 NULL);
+    g_assert_cmpuint(nursery_size, ==, 4 * 1024 * 1024);
+    g_assert_cmpuint(slice_budget, ==, 3);
+    g_assert_cmpuint(growth, ==, 200);
+
+    if (!gjs_context_eval(context,
+                          "let a = [];"
+                          "for (let i = 0; i < 100000; i++) a.push({i});"
+                          "imports.system.gc();",
+                          -1, "<input>", &estatus, &error))
+        g_error("%s", error->message);
+    g_object_unref(context);
+}
+
+static void
+gjstest_test_func_gjs_context_job_drain_budget(void)
+{
+    GjsContext *context = GJS_CONTEXT(g_object_new(GJS_TYPE_CONTEXT,
+                                                   "job-drain-budget", 1,
+                                                   "job-drain-priority",
+                                                   G_PRIORITY_HIGH,
+                                                   NULL));
+    GError *error = NULL;
+    int done;
+
+    /* Queue 200 jobs of 0.1 ms each from the main loop, like an async
+     * callback resolving many promises at once would */
+    if (!gjs_context_eval(context,
+                          "const GLib = imports.gi.GLib;\n"
+                          "var done = 0;\n"
+                          "GLib.idle_add(GLib.PRIORITY_HIGH, () => {\n"
+                          "    for (let i = 0; i < 200; i++) {\n"
+                          "        Promise.resolve().then(() => {\n"
+                          "            let start = GLib.get_monotonic_time();\n"
+                          "            while (GLib.get_monotonic_time() - start < 100);\n"
+                          "            done++;\n"
+                          "        });\n"
+                          "    }\n"
+                          "    return GLib.SOURCE_REMOVE;\n"
+                          "});\n",
+                          -1, "<input>", &done, &error))
+        g_error("%s", error->message);
+
+    g_assert_true(g_main_context_iteration(NULL, false));  /* queues jobs */
+    g_assert_true(g_main_context_iteration(NULL, false));  /* runs ~1 ms */
+    /* Evaluating runs the whole queue, but only after reading the count */
+    if (!gjs_context_eval(context, "done;", -1, "<input>", &done, &error))
+        g_error("%s", error->message);
+    g_assert_cmpint(done, >, 0);
+    g_assert_cmpint(done, <, 200);
+
+    if (!gjs_context_eval(context, "done;", -1, "<input>", &done, &error))
+        g_error("%s", error->message);
+    g_assert_cmpint(done, ==, 200);
+
+    g_object_unref(context);
+}
+
+static void
+gjstest_test_func_gjs_context_job_drain_nested(void)
+{
+    GjsContext *context = gjs_context_new();
+    GError *error = NULL;
+    int status;
+
+    /* A job that runs a main loop while the queue is being drained must not
+     * make the drain idle handler spin; if it did, the low-priority idle
+     * would never run and the timeout would fire first */
+    if (!gjs_context_eval(context,
+                          "const GLib = imports.gi.GLib;\n"
+                          "var starved = false;\n"
+                          "Promise.resolve().then(() => {\n"
+                          "    let loop = new GLib.MainLoop(null, false);\n"
+                          "    Promise.resolve().then(() => {});\n"
+                          "    GLib.idle_add(GLib.PRIORITY_LOW, () => {\n"
+                          "        loop.quit();\n"
+                          "        return GLib.SOURCE_REMOVE;\n"
+                          "    });\n"
+                          "    let id = GLib.timeout_add(GLib.PRIORITY_DEFAULT, 5000, () => {\n"
+                          "        starved = true;\n"
+                          "        loop.quit();\n"
+                          "        return GLib.SOURCE_REMOVE;\n"
+                          "    });\n"
+                          "    loop.run();\n"
+                          "    if (!starved)\n"
+                          "        GLib.source_remove(id);\n"
+                          "});\n",
+                          -1, "<input>", &status, &error))
+        g_error("%s", error->message);
+
+    if (!gjs_context_eval(context, "starved ? 1 : 0;", -1, "<input>",
+                          &status, &error))
+        g_error("%s", error->message);
+    g_assert_cmpint(status, ==, 0);
+
+    g_object_unref(context);
+}
+
 static void
 gjstest_test_func_gjs_context_exit(void)
 {
@@ -120,6 +238,463 @@ gjstest_test_func_gjs_gobject_js_defined_type(void)
     g_object_unref(context);
 }
 
+#define CLASS_CACHE_SCRIPT \
+    "const Gio = imports.gi.Gio;\n" \
+    "const System = imports.system;\n" \
+    "for (let i = 0; i < 2; i++) {\n" \
+    "    let action = Gio.SimpleAction.new('foo', null);\n" \
+    "    if (Object.getPrototypeOf(action) !== Gio.SimpleAction.prototype)\n" \
+    "        throw new Error('Wrong prototype for wrapped object');\n" \
+    "    action = null;\n" \
+    "    System.gc();\n" \
+    "}\n"
+
+static void
+gjstest_test_func_gjs_gobject_class_cache(void)
+{
+    /* The second wrapper comes from the cache, across a GC that may move the
+     * prototype. The second context must not see classes cached by the first
+     * one, so it misses again. */
+    for (int i = 0; i < 2; i++) {
+        GjsContext *context = gjs_context_new();
+        GError *error = NULL;
+        int status;
+        guint64 hits = GJS_GET_STAT(class_cache_hit);
+        guint64 misses = GJS_GET_STAT(class_cache_miss);
+        bool ok = gjs_context_eval(context, CLASS_CACHE_SCRIPT, -1, "<input>",
+                                   &status, &error);
+        g_assert_no_error(error);
+        g_assert_true(ok);
+        g_assert_cmpuint(GJS_GET_STAT(class_cache_miss), >, misses);
+        g_assert_cmpuint(GJS_GET_STAT(class_cache_hit), >, hits);
+        g_object_unref(context);
+    }
+}
+
+static void
+gjstest_test_func_gi_snapshot_record(void)
+{
+    GjsContext *context = gjs_context_new();
+    GError *error = NULL;
+    int status;
+    bool ok = gjs_context_eval(context, "imports.gi.GLib.get_home_dir();", -1,
+                               "<input>", &status, &error);
+    g_assert_no_error(error);
+    g_assert_true(ok);
+    g_object_unref(context);
+}
+
+static void
+gjstest_test_func_gi_snapshot_replay(void)
+{
+    GjsContext *context = gjs_context_new();
+    GError *error = NULL;
+    int status;
+    bool ok = gjs_context_eval(context, "imports.gi.GLib;", -1, "<input>",
+                               &status, &error);
+    g_assert_no_error(error);
+    g_assert_true(ok);
+
+    while (g_main_context_iteration(NULL, false))
+        ;
+
+    ok = gjs_context_eval(context,
+        "if (!Object.getOwnPropertyNames(imports.gi.GLib).includes('get_home_dir'))\n"
+        "    throw new Error('get_home_dir was not predefined');\n",
+        -1, "<input>", &status, &error);
+    g_assert_no_error(error);
+    g_assert_true(ok);
+    g_object_unref(context);
+}
+
+static void
+gjstest_test_func_gi_snapshot(void)
+{
+    GError *error = NULL;
+    char *dir = g_dir_make_tmp("gjs-test-gi-snapshot-XXXXXX", &error);
+    g_assert_no_error(error);
+    char *path = g_build_filename(dir, "snapshot", NULL);
+    g_setenv("GJS_GI_SNAPSHOT", path, true);
+
+    g_test_trap_subprocess("/gi/snapshot/subprocess/record", 0,
+                           G_TEST_SUBPROCESS_INHERIT_STDERR);
+    g_test_trap_assert_passed();
+
+    GKeyFile *snapshot = g_key_file_new();
+    g_key_file_load_from_file(snapshot, path, G_KEY_FILE_NONE, &error);
+    g_assert_no_error(error);
+    char **infos = g_key_file_get_string_list(snapshot, "GLib", "Infos", NULL,
+                                              &error);
+    g_assert_no_error(error);
+    g_assert_true(g_strv_contains(infos, "get_home_dir"));
+    g_strfreev(infos);
+    g_key_file_free(snapshot);
+
+    g_test_trap_subprocess("/gi/snapshot/subprocess/replay", 0,
+                           G_TEST_SUBPROCESS_INHERIT_STDERR);
+    g_test_trap_assert_passed();
+
+    g_unsetenv("GJS_GI_SNAPSHOT");
+    gjs_test_remove_tmp_dir(dir);
+    g_free(path);
+    g_free(dir);
+}
+
+/* Writes cachedModule.js into @dir, with a source that sets value to @value */
+static void
+write_cached_module(const char *dir,
+                    int         value)
+{
+    GError *error = NULL;
+    char *path = g_build_filename(dir, "cachedModule.js", NULL);
+    char *source = g_strdup_printf("var value = %d;\n", value);
+    g_file_set_contents(path, source, -1, &error);
+    g_assert_no_error(error);
+    g_free(source);
+    g_free(path);
+}
+
+/* Imports cachedModule.js from @dir in a new context, and returns its value */
+static int
+import_cached_module(const char *dir)
+{
+    GjsContext *context = gjs_context_new();
+    GError *error = NULL;
+    int status;
+    char *script = g_strdup_printf("imports.searchPath.unshift('%s');\n"
+                                   "imports.cachedModule.value;\n", dir);
+    bool ok = gjs_context_eval(context, script, -1, "<input>", &status,
+                               &error);
+    g_assert_no_error(error);
+    g_assert_true(ok);
+    g_free(script);
+    g_object_unref(context);
+    return status;
+}
+
+typedef struct {
+    char *modules_dir;
+    char *cache_dir;
+    char *old_cache_dir;
+    char *cache_path;  /* where cachedModule.js is cached */
+} ModuleCacheFixture;
+
+static void
+module_cache_fixture_setup(ModuleCacheFixture *fx,
+                           gconstpointer       unused)
+{
+    GError *error = NULL;
+    fx->modules_dir = g_dir_make_tmp("gjs-test-modules-XXXXXX", &error);
+    g_assert_no_error(error);
+    fx->cache_dir = g_dir_make_tmp("gjs-test-module-cache-XXXXXX", &error);
+    g_assert_no_error(error);
+    fx->old_cache_dir = g_strdup(g_getenv("GJS_MODULE_CACHE_DIR"));
+    g_setenv("GJS_MODULE_CACHE_DIR", fx->cache_dir, true);
+
+    char *module_path = g_build_filename(fx->modules_dir, "cachedModule.js",
+                                         NULL);
+    char *name = g_compute_checksum_for_string(G_CHECKSUM_SHA256,
+                                               module_path, -1);
+    char *basename = g_strconcat(name, ".xdr", NULL);
+    fx->cache_path = g_build_filename(fx->cache_dir, basename, NULL);
+    g_free(basename);
+    g_free(name);
+    g_free(module_path);
+}
+
+static void
+module_cache_fixture_teardown(ModuleCacheFixture *fx,
+                              gconstpointer       unused)
+{
+    if (fx->old_cache_dir)
+        g_setenv("GJS_MODULE_CACHE_DIR", fx->old_cache_dir, true);
+    else
+        g_unsetenv("GJS_MODULE_CACHE_DIR");
+    gjs_test_remove_tmp_dir(fx->cache_dir);
+    gjs_test_remove_tmp_dir(fx->modules_dir);
+    g_free(fx->old_cache_dir);
+    g_free(fx->cache_path);
+    g_free(fx->cache_dir);
+    g_free(fx->modules_dir);
+}
+
+static void
+gjstest_test_func_module_cache_edit(ModuleCacheFixture *fx,
+                                    gconstpointer       unused)
+{
+    write_cached_module(fx->modules_dir, 1);
+    g_assert_cmpint(import_cached_module(fx->modules_dir), ==, 1);
+    g_assert_true(g_file_test(fx->cache_path, G_FILE_TEST_IS_REGULAR));
+    g_assert_cmpint(import_cached_module(fx->modules_dir), ==, 1);
+
+    /* The modification time may not have changed, but the source has */
+    write_cached_module(fx->modules_dir, 2);
+    g_assert_cmpint(import_cached_module(fx->modules_dir), ==, 2);
+}
+
+/* Damages the bytecode after the key at the start of the cache file, by
+ * cutting it in half if @truncate, or else overwriting it */
+static void
+damage_module_cache(const char *cache_path,
+                    bool        truncate)
+{
+    char *data;
+    size_t len;
+    GError *error = NULL;
+    g_file_get_contents(cache_path, &data, &len, &error);
+    g_assert_no_error(error);
+
+    /* The key has six lines */
+    char *bytecode = data;
+    for (int i = 0; i < 6; i++) {
+        bytecode = static_cast<char *>(memchr(bytecode, '\n',
+                                              len - (bytecode - data)));
+        g_assert_nonnull(bytecode);
+        bytecode++;
+    }
+    size_t bytecode_len = len - (bytecode - data);
+    g_assert_cmpuint(bytecode_len, >, 1);
+
+    if (truncate)
+        len -= bytecode_len / 2;
+    else
+        memset(bytecode, 0xa5, bytecode_len);
+
+    g_file_set_contents(cache_path, data, len, &error);
+    g_assert_no_error(error);
+    g_free(data);
+}
+
+static void
+gjstest_test_func_module_cache_truncated(ModuleCacheFixture *fx,
+                                         gconstpointer       unused)
+{
+    write_cached_module(fx->modules_dir, 3);
+    g_assert_cmpint(import_cached_module(fx->modules_dir), ==, 3);
+
+    damage_module_cache(fx->cache_path, true);
+    g_assert_cmpint(import_cached_module(fx->modules_dir), ==, 3);
+    /* The damaged file was replaced with a good one */
+    g_assert_cmpint(import_cached_module(fx->modules_dir), ==, 3);
+}
+
+static void
+gjstest_test_func_module_cache_corrupt(ModuleCacheFixture *fx,
+                                       gconstpointer       unused)
+{
+    write_cached_module(fx->modules_dir, 4);
+    g_assert_cmpint(import_cached_module(fx->modules_dir), ==, 4);
+
+    damage_module_cache(fx->cache_path, false);
+    g_assert_cmpint(import_cached_module(fx->modules_dir), ==, 4);
+    g_assert_cmpint(import_cached_module(fx->modules_dir), ==, 4);
+}
+
+typedef struct {
+    char *modules_dir;
+    GjsContext *context;
+} PrefetchFixture;
+
+static void
+prefetch_fixture_setup(PrefetchFixture *fx,
+                       gconstpointer    unused)
+{
+    GError *error = NULL;
+    fx->modules_dir = g_dir_make_tmp("gjs-test-prefetch-XXXXXX", &error);
+    g_assert_no_error(error);
+
+    /* Modules in the cache are never compiled off-thread */
+    g_setenv("GJS_PREFETCH_IMPORTS", "1", true);
+    g_setenv("GJS_DISABLE_MODULE_CACHE", "1", true);
+    fx->context = gjs_context_new();
+}
+
+static void
+prefetch_fixture_teardown(PrefetchFixture *fx,
+                          gconstpointer    unused)
+{
+    g_clear_object(&fx->context);
+    g_unsetenv("GJS_DISABLE_MODULE_CACHE");
+    g_unsetenv("GJS_PREFETCH_IMPORTS");
+    gjs_test_remove_tmp_dir(fx->modules_dir);
+    g_free(fx->modules_dir);
+}
+
+/* Writes @name.js into @dir. It is big enough to be compiled on a helper
+ * thread; its value is @value, or else the value of the module named
+ * @next. */
+static void
+write_prefetch_module(const char *dir,
+                      const char *name,
+                      const char *next,
+                      int         value)
+{
+    GString *source = g_string_new(NULL);
+    for (int i = 0; i < 300; i++)
+        g_string_append_printf(source, "function f%d() { return %d; }\n", i, i);
+    if (next)
+        g_string_append_printf(source, "function value() { return imports.%s.value(); }\n",
+                               next);
+    else
+        g_string_append_printf(source, "function value() { return %d; }\n",
+                               value);
+
+    GError *error = NULL;
+    char *basename = g_strconcat(name, ".js", NULL);
+    char *path = g_build_filename(dir, basename, NULL);
+    g_file_set_contents(path, source->str, -1, &error);
+    g_assert_no_error(error);
+    g_free(path);
+    g_free(basename);
+    g_string_free(source, true);
+}
+
+static int
+prefetch_eval(PrefetchFixture *fx,
+              const char      *script)
+{
+    GError *error = NULL;
+    int status;
+    bool ok = gjs_context_eval(fx->context, script, -1, "<input>", &status,
+                               &error);
+    g_assert_no_error(error);
+    g_assert_true(ok);
+    return status;
+}
+
+/* Imports prefetchRoot, and waits until the worker thread has read
+ * @n_modules of the modules it refers to */
+static void
+prefetch_import_root(PrefetchFixture *fx,
+                     unsigned         n_modules)
+{
+    guint64 n_read = GJS_GET_STAT(module_prefetch_read);
+    char *script = g_strdup_printf("imports.searchPath.unshift('%s');\n"
+                                   "imports.prefetchRoot;\n", fx->modules_dir);
+    prefetch_eval(fx, script);
+    g_free(script);
+
+    while (GJS_GET_STAT(module_prefetch_read) < n_read + n_modules)
+        g_main_context_iteration(NULL, true);
+}
+
+static bool
+prefetch_skip_unless_helper_threads(void)
+{
+    if (g_get_num_processors() > 1)
+        return false;
+    g_test_skip("Off-thread compilation needs more than one CPU");
+    return true;
+}
+
+static void
+gjstest_test_func_module_prefetch_hit(PrefetchFixture *fx,
+                                      gconstpointer    unused)
+{
+    if (prefetch_skip_unless_helper_threads())
+        return;
+
+    write_prefetch_module(fx->modules_dir, "prefetchRoot", "prefetchDep", 0);
+    write_prefetch_module(fx->modules_dir, "prefetchDep", NULL, 1);
+    prefetch_import_root(fx, 1);
+
+    guint64 hits = GJS_GET_STAT(module_prefetch_hit);
+    guint64 misses = GJS_GET_STAT(module_prefetch_miss);
+    g_assert_cmpint(prefetch_eval(fx, "imports.prefetchRoot.value();"), ==, 1);
+    g_assert_cmpuint(GJS_GET_STAT(module_prefetch_hit), ==, hits + 1);
+    g_assert_cmpuint(GJS_GET_STAT(module_prefetch_miss), ==, misses);
+}
+
+static void
+gjstest_test_func_module_prefetch_miss(PrefetchFixture *fx,
+                                       gconstpointer    unused)
+{
+    if (prefetch_skip_unless_helper_threads())
+        return;
+
+    write_prefetch_module(fx->modules_dir, "prefetchRoot", "prefetchDep", 0);
+    write_prefetch_module(fx->modules_dir, "prefetchDep", NULL, 1);
+    prefetch_import_root(fx, 1);
+
+    /* Edited after it was prefetched; the prefetched copy is stale */
+    write_prefetch_module(fx->modules_dir, "prefetchDep", NULL, 2);
+
+    guint64 hits = GJS_GET_STAT(module_prefetch_hit);
+    guint64 misses = GJS_GET_STAT(module_prefetch_miss);
+    g_assert_cmpint(prefetch_eval(fx, "imports.prefetchRoot.value();"), ==, 2);
+    g_assert_cmpuint(GJS_GET_STAT(module_prefetch_hit), ==, hits);
+    g_assert_cmpuint(GJS_GET_STAT(module_prefetch_miss), ==, misses + 1);
+}
+
+static void
+gjstest_test_func_module_prefetch_search_path(PrefetchFixture *fx,
+                                              gconstpointer    unused)
+{
+    if (prefetch_skip_unless_helper_threads())
+        return;
+
+    /* The copy of prefetchShadowed in the second directory is never
+     * imported, so it mustn't be prefetched */
+    GError *error = NULL;
+    char *other_dir = g_dir_make_tmp("gjs-test-prefetch-XXXXXX", &error);
+    g_assert_no_error(error);
+    write_prefetch_module(other_dir, "prefetchShadowed", NULL, 100);
+    write_prefetch_module(fx->modules_dir, "prefetchShadowed", NULL, 1);
+    write_prefetch_module(fx->modules_dir, "prefetchDep", NULL, 2);
+
+    char *path = g_build_filename(fx->modules_dir, "prefetchRoot.js", NULL);
+    g_file_set_contents(path,
+                        "function value() {\n"
+                        "    return imports.prefetchShadowed.value() +\n"
+                        "        imports.prefetchDep.value();\n"
+                        "}\n", -1, &error);
+    g_assert_no_error(error);
+    g_free(path);
+
+    char *script = g_strdup_printf("imports.searchPath.push('%s');\n",
+                                   other_dir);
+    prefetch_eval(fx, script);
+    g_free(script);
+
+    /* Modules are read in order, so a read of the other copy would come
+     * before prefetchDep */
+    prefetch_import_root(fx, 2);
+
+    guint64 hits = GJS_GET_STAT(module_prefetch_hit);
+    g_assert_cmpint(prefetch_eval(fx, "imports.prefetchRoot.value();"), ==, 3);
+    g_assert_cmpuint(GJS_GET_STAT(module_prefetch_hit), ==, hits + 2);
+
+    gjs_test_remove_tmp_dir(other_dir);
+    g_free(other_dir);
+}
+
+static void
+gjstest_test_func_module_prefetch_cancelled(PrefetchFixture *fx,
+                                            gconstpointer    unused)
+{
+    /* A long chain, so that the worker is still reading when the context
+     * goes away, with the first modules compiling off-thread */
+    write_prefetch_module(fx->modules_dir, "prefetchRoot", "prefetch0", 0);
+    for (int i = 0; i < 50; i++) {
+        char *name = g_strdup_printf("prefetch%d", i);
+        char *next = g_strdup_printf("prefetch%d", i + 1);
+        write_prefetch_module(fx->modules_dir, name, i < 49 ? next : NULL, i);
+        g_free(next);
+        g_free(name);
+    }
+    prefetch_import_root(fx, 1);
+    g_clear_object(&fx->context);
+
+    /* Nothing read after the context is gone gets picked up */
+    guint64 n_read = GJS_GET_STAT(module_prefetch_read);
+    for (int i = 0; i < 10; i++) {
+        g_usleep(G_USEC_PER_SEC / 100);
+        while (g_main_context_iteration(NULL, false))
+            ;
+    }
+    g_assert_cmpuint(GJS_GET_STAT(module_prefetch_read), ==, n_read);
+}
+
 static void
 gjstest_test_func_gjs_jsapi_util_string_js_string_utf8(GjsUnitTestFixture *fx,
                                                        gconstpointer       unused)
@@ -133,6 +708,35 @@ gjstest_test_func_gjs_jsapi_util_string_js_string_utf8(GjsUnitTestFixture *fx,
     g_assert_cmpstr(VALID_UTF8_STRING, ==, utf8_result);
 }
 
+static void
+test_jsapi_util_string_latin1_utf8(GjsUnitTestFixture *fx,
+                                   gconstpointer       unused)
+{
+    GjsAutoJSChar utf8_result(fx->cx);
+    JS::RootedValue js_string(fx->cx);
+    char16_t *chars;
+    size_t len;
+
+    /* Only Latin-1 characters, stored without transcoding to UTF-16 */
+    g_assert_true(gjs_string_from_utf8(fx->cx, "Caf\303\251 \302\261", -1,
+                                       &js_string));
+    g_assert_true(gjs_string_get_char16_data(fx->cx, js_string, &chars, &len));
+    std::u16string result(chars, len);
+    g_assert_true(result == u"Caf\xe9 \xb1");
+    g_free(chars);
+    g_assert_true(gjs_string_to_utf8(fx->cx, js_string, &utf8_result));
+    g_assert_cmpstr(utf8_result, ==, "Caf\303\251 \302\261");
+
+    /* Conversion stops at a NUL byte within n_bytes */
+    g_assert_true(gjs_string_from_utf8(fx->cx, "abc\0def", 7, &js_string));
+    g_assert_cmpuint(JS_GetStringLength(js_string.toString()), ==, 3);
+
+    /* A truncated sequence is still an error */
+    g_assert_false(gjs_string_from_utf8(fx->cx, "Caf\303", -1, &js_string));
+    g_assert_true(JS_IsExceptionPending(fx->cx));
+    JS_ClearPendingException(fx->cx);
+}
+
 static void
 gjstest_test_func_gjs_jsapi_util_error_throw(GjsUnitTestFixture *fx,
                                              gconstpointer       unused)
@@ -386,10 +990,52 @@ main(int    argc,
 
     g_test_init(&argc, &argv, NULL);
 
+    /* Keep compiled modules out of the user's cache directory */
+    char *module_cache_dir = NULL;
+    if (!g_getenv("GJS_MODULE_CACHE_DIR")) {
+        GError *error = NULL;
+        module_cache_dir = g_dir_make_tmp("gjs-tests-module-cache-XXXXXX",
+                                          &error);
+        g_assert_no_error(error);
+        g_setenv("GJS_MODULE_CACHE_DIR", module_cache_dir, true);
+    }
+
     g_test_add_func("/gjs/context/construct/destroy", gjstest_test_func_gjs_context_construct_destroy);
     g_test_add_func("/gjs/context/construct/eval", gjstest_test_func_gjs_context_construct_eval);
+    g_test_add_func("/gjs/context/construct/gc-tuning", gjstest_test_func_gjs_context_construct_gc_tuning);
+    g_test_add_func("/gjs/context/job-drain-budget", gjstest_test_func_gjs_context_job_drain_budget);
+    g_test_add_func("/gjs/context/job-drain-nested", gjstest_test_func_gjs_context_job_drain_nested);
     g_test_add_func("/gjs/context/exit", gjstest_test_func_gjs_context_exit);
     g_test_add_func("/gjs/gobject/js_defined_type", gjstest_test_func_gjs_gobject_js_defined_type);
+    g_test_add_func("/gjs/gobject/class-cache", gjstest_test_func_gjs_gobject_class_cache);
+    g_test_add("/gjs/module/cache/edit", ModuleCacheFixture, NULL,
+               module_cache_fixture_setup, gjstest_test_func_module_cache_edit,
+               module_cache_fixture_teardown);
+    g_test_add("/gjs/module/cache/truncated", ModuleCacheFixture, NULL,
+               module_cache_fixture_setup,
+               gjstest_test_func_module_cache_truncated,
+               module_cache_fixture_teardown);
+    g_test_add("/gjs/module/cache/corrupt", ModuleCacheFixture, NULL,
+               module_cache_fixture_setup,
+               gjstest_test_func_module_cache_corrupt,
+               module_cache_fixture_teardown);
+    g_test_add("/gjs/module/prefetch/hit", PrefetchFixture, NULL,
+               prefetch_fixture_setup, gjstest_test_func_module_prefetch_hit,
+               prefetch_fixture_teardown);
+    g_test_add("/gjs/module/prefetch/miss", PrefetchFixture, NULL,
+               prefetch_fixture_setup, gjstest_test_func_module_prefetch_miss,
+               prefetch_fixture_teardown);
+    g_test_add("/gjs/module/prefetch/search-path", PrefetchFixture, NULL,
+               prefetch_fixture_setup,
+               gjstest_test_func_module_prefetch_search_path,
+               prefetch_fixture_teardown);
+    g_test_add("/gjs/module/prefetch/cancelled", PrefetchFixture, NULL,
+               prefetch_fixture_setup,
+               gjstest_test_func_module_prefetch_cancelled,
+               prefetch_fixture_teardown);
+    g_test_add_func("/gi/snapshot", gjstest_test_func_gi_snapshot);
+    g_test_add_func("/gi/snapshot/subprocess/record", gjstest_test_func_gi_snapshot_record);
+    g_test_add_func("/gi/snapshot/subprocess/replay", gjstest_test_func_gi_snapshot_replay);
     g_test_add_func("/gjs/jsutil/strip_shebang/no_shebang", gjstest_test_strip_shebang_no_advance_for_no_shebang);
     g_test_add_func("/gjs/jsutil/strip_shebang/have_shebang", gjstest_test_strip_shebang_advance_for_shebang);
     g_test_add_func("/gjs/jsutil/strip_shebang/only_shebang", gjstest_test_strip_shebang_return_null_for_just_shebang);
@@ -405,6 +1051,8 @@ main(int    argc,
                         gjstest_test_func_gjs_jsapi_util_error_throw);
     ADD_JSAPI_UTIL_TEST("string/js/string/utf8",
                         gjstest_test_func_gjs_jsapi_util_string_js_string_utf8);
+    ADD_JSAPI_UTIL_TEST("string/latin1/utf8",
+                        test_jsapi_util_string_latin1_utf8);
     ADD_JSAPI_UTIL_TEST("string/char16_data",
                         test_jsapi_util_string_char16_data);
     ADD_JSAPI_UTIL_TEST("string/to_ucs4",
@@ -421,8 +1069,15 @@ main(int    argc,
     gjs_test_add_tests_for_coverage ();
     gjs_test_add_tests_for_parse_call_args();
     gjs_test_add_tests_for_rooting();
+    gjs_test_add_tests_for_perf();
+    gjs_test_add_tests_for_toggle_queue();
 
     g_test_run();
 
+    if (module_cache_dir) {
+        gjs_test_remove_tmp_dir(module_cache_dir);
+        g_free(module_cache_dir);
+    }
+
     return 0;
 }